@@ -0,0 +1,872 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  big.c
+
+  Whole numbers of any size, for BIG mode. A number is an array of limbs,
+  each holding nine decimal digits, so that printing one -- which, for a
+  number of a million digits, would otherwise take longer than working
+  it out -- is just a matter of printing the limbs in turn. Products of
+  long numbers are found by Karatsuba's method, which does three
+  multiplications of half the size where the schoolbook method does
+  four, and division by Knuth's algorithm D.
+
+  Factorials and permutations are products of a range of numbers, which
+  are packed as many as will fit into a word, and then multiplied in a
+  balanced tree ("binary splitting"), so that the long multiplications,
+  the ones that Karatsuba's method speeds up, are of numbers of about
+  the same size. Combinations are worked out the same way, from the
+  power of each prime that divides them (by Legendre's formula), so
+  there is nothing to divide.
+
+  This needs a 64-bit integer type, and more memory than CP/M has, so it
+  is only built on Linux.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "math.h"
+#include "setjmp.h"
+#include "tinyexpr.h"
+#include "funcs.h"
+#include "config.h"
+#include "big.h"
+
+#ifdef LINUX
+
+#include <stdlib.h>
+#include <string.h>
+
+extern jmp_buf err_jump;
+
+int big_mode = 0;
+
+/* The largest product of factors that is packed into a leaf, which is
+   then at most two limbs */
+#define BIG_WMAX 999999999999999999ULL
+
+/* The largest number that a combination is worked out from the primes
+   up to, which needs that many bytes for a sieve */
+#define BIG_SIEVE 100000000L
+
+/* The numbers that big_release() frees */
+static big_num live = {&live, &live, 0, 0, 0};
+
+/* The leaves of a product tree (see bprod()) */
+static big_num **leaf = 0;
+static int nleaf = 0, maxleaf = 0;
+static big_wide acc = 1;
+
+/*
+  lalloc -- space for n limbs
+*/
+static big_limb *lalloc (n)
+int n;
+  {
+  big_limb *p = malloc ((n ? n : 1) * sizeof (big_limb));
+  if (!p) longjmp (err_jump, E_NOMEM);
+  return p;
+  }
+
+/*
+  bnew -- a number of n limbs, whose value is to be filled in
+*/
+static big_num *bnew (n)
+int n;
+  {
+  big_num *a = malloc (sizeof (big_num) + (n ? n : 1) * sizeof (big_limb));
+  if (!a) longjmp (err_jump, E_NOMEM);
+  a->d = (big_limb *)(a + 1);
+  a->n = n;
+  a->neg = 0;
+  a->prev = &live;
+  a->next = live.next;
+  live.next->prev = a;
+  live.next = a;
+  return a;
+  }
+
+/*
+  trim -- drop leading zero limbs, and the sign of zero
+*/
+static big_num *trim (a)
+big_num *a;
+  {
+  while (a->n && a->d[a->n - 1] == 0) a->n--;
+  if (!a->n) a->neg = 0;
+  return a;
+  }
+
+/*
+  bdup -- a copy of a, with the sign neg
+*/
+static big_num *bdup (a, neg)
+big_num *a;
+int neg;
+  {
+  big_num *r = bnew (a->n);
+  memcpy (r->d, a->d, a->n * sizeof (big_limb));
+  r->neg = a->n && neg;
+  return r;
+  }
+
+/*
+  bfromw -- the number u, negative if neg
+*/
+static big_num *bfromw (u, neg)
+big_wide u;
+int neg;
+  {
+  big_num *a = bnew (3);
+  a->n = 0;
+  while (u)
+    {
+    a->d[a->n++] = (big_limb)(u % BIG_BASE);
+    u /= BIG_BASE;
+    }
+  a->neg = a->n && neg;
+  return a;
+  }
+
+/*
+  bsize -- check that a result of about 10^lg won't have too many digits
+*/
+static void bsize (lg)
+double lg;
+  {
+  if (!(lg <= BIG_DIGITS)) longjmp (err_jump, E_NOMEM);
+  }
+
+/*
+  bword -- a as a number of no more than 18 digits; E_WHOLE if it is
+  negative, and E_NOMEM (as a result of any interest would have too many
+  digits) if it is too big
+*/
+static big_wide bword (a)
+big_num *a;
+  {
+  if (a->neg) longjmp (err_jump, E_WHOLE);
+  if (a->n > 2) longjmp (err_jump, E_NOMEM);
+  return a->n == 0 ? 0 : a->n == 1 ? a->d[0]
+    : (big_wide)a->d[1] * BIG_BASE + a->d[0];
+  }
+
+void big_keep (a)
+big_num *a;
+  {
+  a->prev->next = a->next;
+  a->next->prev = a->prev;
+  a->prev = a->next = a;
+  }
+
+void big_free (a)
+big_num *a;
+  {
+  if (!a) return;
+  big_keep (a);
+  free (a);
+  }
+
+void big_release ()
+  {
+  while (live.next != &live) big_free (live.next);
+  }
+
+big_num *big_fromd (x)
+double x;
+  {
+  double m;
+  int e;
+  big_num *t, *r;
+  if (x != x || x - x != 0) longjmp (err_jump, E_WHOLE);
+  if (fabs (x) < 9007199254740992.0)
+    return bfromw ((big_wide)fabs (x), x < 0);
+  /* Bigger than 2^53: a 53-bit whole number times a power of two */
+  m = frexp (x, &e);
+  t = bfromw ((big_wide)fabs (ldexp (m, 53)), x < 0);
+  r = bfromw ((big_wide)2, 0);
+  r = big_pow (r, bfromw ((big_wide)(e - 53), 0));
+  return big_mul (t, r);
+  }
+
+big_num *big_atoi (s, end)
+char *s;
+char *end;
+  {
+  big_num *a;
+  big_limb x;
+  char *p;
+  int i;
+  while (s < end && *s == '0') s++;
+  bsize ((double)(end - s));
+  a = bnew ((int)((end - s + BIG_LDIG - 1) / BIG_LDIG));
+  /* Nine digits at a time, from the end */
+  for (i = 0; i < a->n; i++)
+    {
+    p = end - s > BIG_LDIG ? end - BIG_LDIG : s;
+    for (x = 0; p < end; p++) x = x * 10 + *p - '0';
+    a->d[i] = x;
+    end -= end - s > BIG_LDIG ? BIG_LDIG : end - s;
+    }
+  return a;
+  }
+
+double big_dbl (a)
+big_num *a;
+  {
+  double r = 0;
+  int i;
+  for (i = a->n - 1; i >= 0 && i >= a->n - 3; i--) r = r * BIG_BASE + a->d[i];
+  if (a->n > 3) r *= pow ((double)BIG_BASE, (double)(a->n - 3));
+  return a->neg ? -r : r;
+  }
+
+/*
+  Arithmetic on arrays of limbs, which the numbers are built from
+*/
+
+/* r[0..na] = a + b, where na >= nb */
+static void ladd (r, a, na, b, nb)
+big_limb *r;
+big_limb *a;
+int na;
+big_limb *b;
+int nb;
+  {
+  big_limb t, c = 0;
+  int i;
+  for (i = 0; i < na; i++)
+    {
+    t = a[i] + (i < nb ? b[i] : 0) + c;
+    c = t >= BIG_BASE;
+    r[i] = c ? t - BIG_BASE : t;
+    }
+  r[na] = c;
+  }
+
+/* r[0..nr) += a[0..na), where the sum fits */
+static void laddin (r, nr, a, na)
+big_limb *r;
+int nr;
+big_limb *a;
+int na;
+  {
+  big_limb t, c = 0;
+  int i;
+  for (i = 0; i < nr && (i < na || c); i++)
+    {
+    t = r[i] + (i < na ? a[i] : 0) + c;
+    c = t >= BIG_BASE;
+    r[i] = c ? t - BIG_BASE : t;
+    }
+  }
+
+/* r[0..nr) -= a[0..na), where r >= a */
+static void lsubin (r, nr, a, na)
+big_limb *r;
+int nr;
+big_limb *a;
+int na;
+  {
+  big_limb s, b = 0;
+  int i;
+  for (i = 0; i < nr && (i < na || b); i++)
+    {
+    s = (i < na ? a[i] : 0) + b;
+    b = r[i] < s;
+    r[i] = b ? r[i] + BIG_BASE - s : r[i] - s;
+    }
+  }
+
+/* r[0..n] = a * f, where f < BIG_BASE */
+static void lmulw (r, a, n, f)
+big_limb *r;
+big_limb *a;
+int n;
+big_wide f;
+  {
+  big_wide p, c = 0;
+  int i;
+  for (i = 0; i < n; i++)
+    {
+    p = a[i] * f + c;
+    r[i] = (big_limb)(p % BIG_BASE);
+    c = p / BIG_BASE;
+    }
+  r[n] = (big_limb)c;
+  }
+
+/* r[0..na+nb) = a * b, digit by digit */
+static void lsch (r, a, na, b, nb)
+big_limb *r;
+big_limb *a;
+int na;
+big_limb *b;
+int nb;
+  {
+  big_wide c, ai;
+  int i, j;
+  memset (r, 0, (na + nb) * sizeof (big_limb));
+  for (i = 0; i < na; i++)
+    {
+    if ((ai = a[i]) == 0) continue;
+    c = 0;
+    for (j = 0; j < nb; j++)
+      {
+      c += ai * b[j] + r[i + j];
+      r[i + j] = (big_limb)(c % BIG_BASE);
+      c /= BIG_BASE;
+      }
+    r[i + nb] = (big_limb)c;
+    }
+  }
+
+/* r[0..na+nb) = a * b, by Karatsuba's method: with a = a1 B^m + a0 and
+   b = b1 B^m + b0, a * b = a1 b1 B^2m + a0 b0 +
+   ((a0 + a1) (b0 + b1) - a1 b1 - a0 b0) B^m */
+static void lmul (r, a, na, b, nb)
+big_limb *r;
+big_limb *a;
+int na;
+big_limb *b;
+int nb;
+  {
+  big_limb *t, *sa, *sb, *z;
+  int m, nz;
+  if (na < nb)
+    {
+    t = a; a = b; b = t;
+    m = na; na = nb; nb = m;
+    }
+  if (nb < BIG_KARA)
+    {
+    lsch (r, a, na, b, nb);
+    return;
+    }
+  m = (na + 1) / 2;
+  if (nb <= m)
+    {
+    /* b is the shorter by far: a0 b + a1 b B^m */
+    t = lalloc (na - m + nb);
+    lmul (r, a, m, b, nb);
+    memset (r + m + nb, 0, (na - m) * sizeof (big_limb));
+    lmul (t, a + m, na - m, b, nb);
+    laddin (r + m, na + nb - m, t, na - m + nb);
+    free (t);
+    return;
+    }
+  t = lalloc (4 * m + 4);
+  sa = t;
+  sb = t + m + 1;
+  z = t + 2 * m + 2;
+  ladd (sa, a, m, a + m, na - m);
+  ladd (sb, b, m, b + m, nb - m);
+  lmul (z, sa, m + 1, sb, m + 1);
+  lmul (r, a, m, b, m);
+  lmul (r + 2 * m, a + m, na - m, b + m, nb - m);
+  lsubin (z, 2 * m + 2, r, 2 * m);
+  lsubin (z, 2 * m + 2, r + 2 * m, na + nb - 2 * m);
+  for (nz = 2 * m + 2; nz && z[nz - 1] == 0; nz--)
+    ;
+  laddin (r + m, na + nb - m, z, nz);
+  free (t);
+  }
+
+/*
+  ucmp -- compare |a| and |b|
+*/
+static int ucmp (a, b)
+big_num *a;
+big_num *b;
+  {
+  int i;
+  if (a->n != b->n) return a->n < b->n ? -1 : 1;
+  for (i = a->n - 1; i >= 0; i--)
+    if (a->d[i] != b->d[i]) return a->d[i] < b->d[i] ? -1 : 1;
+  return 0;
+  }
+
+/*
+  bsum -- a + b, with b negated if bneg
+*/
+static big_num *bsum (a, b, bneg)
+big_num *a;
+big_num *b;
+int bneg;
+  {
+  big_num *r, *t;
+  int neg = b->neg != bneg;
+  if (a->neg == neg)
+    {
+    if (a->n < b->n)
+      {
+      t = a; a = b; b = t;
+      }
+    r = bnew (a->n + 1);
+    ladd (r->d, a->d, a->n, b->d, b->n);
+    r->neg = neg;
+    return trim (r);
+    }
+  if (ucmp (a, b) >= 0)
+    {
+    r = bdup (a, a->neg);
+    lsubin (r->d, r->n, b->d, b->n);
+    }
+  else
+    {
+    r = bdup (b, neg);
+    lsubin (r->d, r->n, a->d, a->n);
+    }
+  return trim (r);
+  }
+
+big_num *big_add (a, b)
+big_num *a;
+big_num *b;
+  {
+  return bsum (a, b, 0);
+  }
+
+big_num *big_sub (a, b)
+big_num *a;
+big_num *b;
+  {
+  return bsum (a, b, 1);
+  }
+
+big_num *big_mul (a, b)
+big_num *a;
+big_num *b;
+  {
+  big_num *r;
+  if (!a->n || !b->n) return bnew (0);
+  bsize ((double)(a->n + b->n - 1) * BIG_LDIG);
+  r = bnew (a->n + b->n);
+  lmul (r->d, a->d, a->n, b->d, b->n);
+  r->neg = a->neg != b->neg;
+  return trim (r);
+  }
+
+/*
+  bdiv -- a / b and its remainder, either of which may be left out
+*/
+static void bdiv (a, b, q, rem)
+big_num *a;
+big_num *b;
+big_num **q;
+big_num **rem;
+  {
+  big_num *qq, *rr;
+  big_limb *u, *v;
+  big_wide f, num, qh, rh, p, c, w;
+  long long s, br;
+  int na = a->n, nb = b->n, i, j;
+
+  if (!nb) longjmp (err_jump, E_DIVZ);
+  if (ucmp (a, b) < 0)
+    {
+    if (q) *q = bnew (0);
+    if (rem) *rem = bdup (a, a->neg);
+    return;
+    }
+  qq = bnew (na - nb + 1);
+  if (nb == 1)
+    {
+    for (w = 0, i = na - 1; i >= 0; i--)
+      {
+      num = w * BIG_BASE + a->d[i];
+      qq->d[i] = (big_limb)(num / b->d[0]);
+      w = num % b->d[0];
+      }
+    rr = bfromw (w, a->neg);
+    }
+  else
+    {
+    /* Scale both so that b's top limb is at least half the base, which
+       makes each guess at a limb of the quotient no more than two too
+       big; the guess is then checked against b's next limb */
+    f = BIG_BASE / ((big_wide)b->d[nb - 1] + 1);
+    u = lalloc (na + 1);
+    v = lalloc (nb + 1);
+    lmulw (u, a->d, na, f);
+    lmulw (v, b->d, nb, f);
+    for (j = na - nb; j >= 0; j--)
+      {
+      num = (big_wide)u[j + nb] * BIG_BASE + u[j + nb - 1];
+      qh = num / v[nb - 1];
+      rh = num % v[nb - 1];
+      while (qh >= BIG_BASE
+           || qh * v[nb - 2] > rh * BIG_BASE + u[j + nb - 2])
+        {
+        qh--;
+        rh += v[nb - 1];
+        if (rh >= BIG_BASE) break;
+        }
+      /* u[j..j+nb] -= qh * v */
+      for (c = 0, br = 0, i = 0; i < nb; i++)
+        {
+        p = qh * v[i] + c;
+        c = p / BIG_BASE;
+        s = (long long)u[i + j] - (long long)(p % BIG_BASE) - br;
+        br = s < 0;
+        u[i + j] = (big_limb)(s < 0 ? s + BIG_BASE : s);
+        }
+      s = (long long)u[j + nb] - (long long)c - br;
+      if (s < 0)
+        {
+        /* Still one too big: add v back */
+        qh--;
+        u[j + nb] = (big_limb)(s + BIG_BASE);
+        for (c = 0, i = 0; i < nb; i++)
+          {
+          w = u[i + j] + v[i] + c;
+          c = w >= BIG_BASE;
+          u[i + j] = (big_limb)(c ? w - BIG_BASE : w);
+          }
+        u[j + nb] = (big_limb)((u[j + nb] + c) % BIG_BASE);
+        }
+      else
+        u[j + nb] = (big_limb)s;
+      qq->d[j] = (big_limb)qh;
+      }
+    /* The remainder is what is left of u, scaled back */
+    rr = bnew (nb);
+    for (w = 0, i = nb - 1; i >= 0; i--)
+      {
+      num = w * BIG_BASE + u[i];
+      rr->d[i] = (big_limb)(num / f);
+      w = num % f;
+      }
+    rr->neg = a->neg;
+    trim (rr);
+    free (u);
+    free (v);
+    }
+  qq->neg = a->neg != b->neg;
+  trim (qq);
+  if (q) *q = qq; else big_free (qq);
+  if (rem) *rem = rr; else big_free (rr);
+  }
+
+big_num *big_div (a, b)
+big_num *a;
+big_num *b;
+  {
+  big_num *q;
+  bdiv (a, b, &q, (big_num **)0);
+  return q;
+  }
+
+big_num *big_mod (a, b)
+big_num *a;
+big_num *b;
+  {
+  big_num *r;
+  bdiv (a, b, (big_num **)0, &r);
+  return r;
+  }
+
+big_num *big_dup (a)
+big_num *a;
+  {
+  return bdup (a, a->neg);
+  }
+
+big_num *big_neg (a)
+big_num *a;
+  {
+  return bdup (a, !a->neg);
+  }
+
+big_num *big_abs (a)
+big_num *a;
+  {
+  return bdup (a, 0);
+  }
+
+/*
+  big_same -- floor() and ceil() of a whole number
+*/
+static big_num *big_same (a)
+big_num *a;
+  {
+  return a;
+  }
+
+big_num *big_pow (a, b)
+big_num *a;
+big_num *b;
+  {
+  big_num *r, *t;
+  big_wide e, bit;
+  int odd = b->n && (b->d[0] & 1);
+  if (a->n == 0 && b->neg) longjmp (err_jump, E_DIVZ);
+  if (a->n == 1 && a->d[0] == 1) return bfromw ((big_wide)1, a->neg && odd);
+  if (b->neg) return bnew (0);
+  if (a->n == 0) return bfromw ((big_wide)(b->n == 0), 0);
+  /* The result has about e log10 |a| digits */
+  bsize (big_dbl (b) * ((a->n - 1) * BIG_LDIG + log10 ((double)a->d[a->n - 1])));
+  e = bword (b);
+  for (bit = 1; bit <= e / 2; bit <<= 1)
+    ;
+  r = bfromw ((big_wide)1, 0);
+  for (; bit; bit >>= 1)
+    {
+    t = big_mul (r, r);
+    big_free (r);
+    r = t;
+    if (e & bit)
+      {
+      t = big_mul (r, a);
+      big_free (r);
+      r = t;
+      }
+    }
+  return r;
+  }
+
+/*
+  Products of many factors. bpush() adds a factor, packing it in with
+  the last if their product fits in a word, and bprod() multiplies them
+  all, in a tree, and starts again.
+*/
+static void bleaf ()
+  {
+  if (nleaf >= maxleaf)
+    {
+    maxleaf = maxleaf ? 2 * maxleaf : 64;
+    if ((leaf = realloc (leaf, maxleaf * sizeof (big_num *))) == 0)
+      {
+      nleaf = maxleaf = 0;
+      longjmp (err_jump, E_NOMEM);
+      }
+    }
+  leaf[nleaf++] = bfromw (acc, 0);
+  acc = 1;
+  }
+
+static void bpush (x)
+big_wide x;
+  {
+  if (acc <= BIG_WMAX / x)
+    {
+    acc *= x;
+    return;
+    }
+  bleaf ();
+  acc = x;
+  }
+
+static big_num *btree (i, j)
+int i;
+int j;
+  {
+  big_num *x, *y, *r;
+  if (j - i == 1) return leaf[i];
+  x = btree (i, (i + j) / 2);
+  y = btree ((i + j) / 2, j);
+  r = big_mul (x, y);
+  big_free (x);
+  big_free (y);
+  return r;
+  }
+
+static big_num *bprod ()
+  {
+  big_num *r;
+  bleaf ();
+  r = btree (0, nleaf);
+  nleaf = 0;
+  return r;
+  }
+
+/*
+  brange -- lo * (lo + 1) * ... * hi, where lo > 0
+*/
+static big_num *brange (lo, hi)
+big_wide lo;
+big_wide hi;
+  {
+  nleaf = 0;
+  acc = 1;
+  for (; lo <= hi; lo++) bpush (lo);
+  return bprod ();
+  }
+
+/*
+  lgf -- log10 (n!)
+*/
+static double lgf (n)
+big_wide n;
+  {
+  return lgamma ((double)n + 1.0) / log (10.0);
+  }
+
+big_num *big_fac (a)
+big_num *a;
+  {
+  big_wide n = bword (a);
+  bsize (lgf (n));
+  return brange ((big_wide)2, n);
+  }
+
+/*
+  bnk -- n and k, for NPR and NCR: E_WHOLE if either is negative, and
+  non-zero if k > n, when the result is 0
+*/
+static int bnk (a, b, n, k)
+big_num *a;
+big_num *b;
+big_wide *n;
+big_wide *k;
+  {
+  if (a->neg || b->neg) longjmp (err_jump, E_WHOLE);
+  if (ucmp (b, a) > 0) return 1;
+  *n = bword (a);
+  *k = bword (b);
+  return 0;
+  }
+
+big_num *big_npr (a, b)
+big_num *a;
+big_num *b;
+  {
+  big_wide n, k;
+  if (bnk (a, b, &n, &k)) return bnew (0);
+  bsize (lgf (n) - lgf (n - k));
+  return brange (n - k + 1, n);
+  }
+
+/*
+  legendre -- the power of the prime p that divides n!
+*/
+static big_wide legendre (n, p)
+big_wide n;
+big_wide p;
+  {
+  big_wide e = 0;
+  while (n)
+    {
+    n /= p;
+    e += n;
+    }
+  return e;
+  }
+
+big_num *big_ncr (a, b)
+big_num *a;
+big_num *b;
+  {
+  big_wide n, k, p, q, e;
+  big_num *x, *y, *r;
+  char *sieve;
+  if (bnk (a, b, &n, &k)) return bnew (0);
+  if (k > n - k) k = n - k;
+  bsize (lgf (n) - lgf (k) - lgf (n - k));
+  if (n > BIG_SIEVE)
+    {
+    /* Few enough factors that dividing costs little */
+    x = brange (n - k + 1, n);
+    y = brange ((big_wide)2, k);
+    r = big_div (x, y);
+    big_free (x);
+    big_free (y);
+    return r;
+    }
+  if ((sieve = calloc (n + 1, 1)) == 0) longjmp (err_jump, E_NOMEM);
+  nleaf = 0;
+  acc = 1;
+  for (p = 2; p <= n; p++)
+    {
+    if (sieve[p]) continue;
+    for (q = p * p; q <= n; q += p) sieve[q] = 1;
+    e = legendre (n, p) - legendre (k, p) - legendre (n - k, p);
+    while (e--) bpush (p);
+    }
+  free (sieve);
+  return bprod ();
+  }
+
+big_num *big_gcd (a, b)
+big_num *a;
+big_num *b;
+  {
+  big_num *x = big_abs (a), *y = big_abs (b), *t;
+  while (y->n)
+    {
+    t = big_mod (x, y);
+    big_free (x);
+    x = y;
+    y = t;
+    }
+  big_free (y);
+  return x;
+  }
+
+big_num *big_lcm (a, b)
+big_num *a;
+big_num *b;
+  {
+  big_num *g, *q, *r;
+  if (!a->n || !b->n) return bnew (0);
+  g = big_gcd (a, b);
+  q = big_div (a, g);
+  r = big_mul (q, b);
+  r->neg = 0;
+  big_free (g);
+  big_free (q);
+  return r;
+  }
+
+/* The functions that have big versions */
+static struct
+  {
+  double (*f)();
+  big_fun k;
+  } big_kerns[] =
+  {
+  {fabs, big_abs}, {ceil, big_same}, {floor, big_same}, {_pow, big_pow},
+  {_fac, big_fac}, {_gcd, big_gcd}, {_lcm, big_lcm}, {_ncr, big_ncr},
+  {_npr, big_npr}, {0, 0}
+  };
+
+big_fun big_kern (f)
+void *f;
+  {
+  int i;
+  for (i = 0; big_kerns[i].f; i++)
+    if ((void *)big_kerns[i].f == f) return big_kerns[i].k;
+  return 0;
+  }
+
+long big_len (a)
+big_num *a;
+  {
+  long len = a->neg;
+  big_limb t;
+  if (!a->n) return 1;
+  for (t = a->d[a->n - 1]; t; t /= 10) len++;
+  return len + (long)(a->n - 1) * BIG_LDIG;
+  }
+
+void big_fmt (a, buff)
+big_num *a;
+char *buff;
+  {
+  int i;
+  if (!a->n)
+    {
+    strcpy (buff, "0");
+    return;
+    }
+  if (a->neg) *buff++ = '-';
+  buff += sprintf (buff, "%u", a->d[a->n - 1]);
+  for (i = a->n - 2; i >= 0; i--)
+    buff += sprintf (buff, "%09u", a->d[i]);
+  }
+
+#endif
+
@@ -0,0 +1,112 @@
+/*===========================================================================
+
+  big.h
+
+  Whole numbers of any size, for BIG mode (Linux only): a number is held
+  as an array of base-10^9 digits, so that it can be shown in decimal
+  without any conversion. Include tinyexpr.h first, for te_int.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __BIG_H
+#define __BIG_H
+
+#ifdef LINUX
+
+typedef unsigned int big_limb;
+typedef unsigned long long big_wide;
+
+/* The base of a limb, and the decimal digits in one */
+#define BIG_BASE 1000000000U
+#define BIG_LDIG 9
+
+/* A number: n limbs, least significant first, and a sign. Zero has no
+   limbs. Numbers made since the last big_release() are on a list, so
+   that an error part of the way through a calculation leaves nothing
+   behind */
+typedef struct big_num
+  {
+  struct big_num *prev;
+  struct big_num *next;
+  int n;
+  int neg;
+  big_limb *d;
+  } big_num;
+
+/* A function of one or two big arguments (the second is ignored by
+   functions of one). args: big_num *a, big_num *b. ret: the result,
+   which may be a itself */
+typedef big_num *(*big_fun)();
+
+/* Non-zero if expressions are evaluated in big integers */
+extern int big_mode;
+
+/* A double, truncated towards zero. E_WHOLE if it is infinite or NaN.
+   args: double x. ret: the number */
+big_num *big_fromd ();
+
+/* Convert the decimal digits from s up to end. args: char *s,
+   char *end. ret: the number */
+big_num *big_atoi ();
+
+/* The nearest double (infinite if the number is too big for one), the
+   same each time for the same number. args: big_num *a */
+double big_dbl ();
+
+/* a + b, a - b, a * b. Multiplication is by Karatsuba's method, once
+   both numbers are more than BIG_KARA limbs. args: big_num *a,
+   big_num *b. ret: a new number */
+big_num *big_add ();
+big_num *big_sub ();
+big_num *big_mul ();
+
+/* a / b, truncated towards zero, and its remainder, which has the sign
+   of a, as the / and % operators do in INT mode. E_DIVZ if b is zero.
+   args as for big_add() */
+big_num *big_div ();
+big_num *big_mod ();
+
+/* A copy of a, -a, |a|. args: big_num *a. ret: a new number */
+big_num *big_dup ();
+big_num *big_neg ();
+big_num *big_abs ();
+
+/* a to the power b. A negative power is truncated, as it is in INT
+   mode, to 0 (or 1 or -1, if a is 1 or -1). args as for big_add() */
+big_num *big_pow ();
+
+/* Factorial, permutations and combinations of n things taken k at a
+   time, greatest common divisor, and least common multiple. E_WHOLE for
+   a negative argument to FAC, NPR or NCR. args: big_num *a[, big_num *b].
+   ret: a new number */
+big_num *big_fac ();
+big_num *big_npr ();
+big_num *big_ncr ();
+big_num *big_gcd ();
+big_num *big_lcm ();
+
+/* Find the big version of one of kcalc's functions, like _fac or _pow.
+   args: void *f. ret: the function, or 0 if there isn't one */
+big_fun big_kern ();
+
+/* Keep a number when big_release() is called, and free it, whether it
+   is kept or not. args: big_num *a */
+void big_keep ();
+void big_free ();
+
+/* Free every number made since the last call that hasn't been kept */
+void big_release ();
+
+/* The number of characters that big_fmt() writes, not counting the
+   terminating zero. args: big_num *a */
+long big_len ();
+
+/* Write a number in decimal. args: big_num *a, char *buff -- at least
+   big_len (a) + 1 characters */
+void big_fmt ();
+
+#endif
+
+#endif
+
@@ -0,0 +1,1430 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  bulk.c
+
+  Commands that evaluate expressions many times over. The expressions
+  are compiled once, and the variables they depend on are updated in
+  place, so the cost of each evaluation is just the arithmetic. 
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "ctype.h"
+#include "math.h"
+#include "tinyexpr.h"
+#include "config.h"
+#include "compat.h"
+#include "strutil.h"
+#include "kcalc.h"
+#include "stats.h"
+#include "term.h"
+#include "bulk.h"
+#include "funcs.h"
+#ifdef LINUX
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*===========================================================================
+
+  bulk_trim
+
+  Remove the padding that kc_fmts() puts in front of short numbers (after
+  the sign, if there is one), which just gets in the way in columns of 
+  figures.
+
+===========================================================================*/
+static char *bulk_trim (s)
+char *s;
+  {
+  char *p;
+  if (*s != '-')
+    {
+    while (*s == ' ') s++;
+    return s;
+    }
+  p = s + 1;
+  while (*p == ' ') p++;
+  if (p > s + 1) _memmove (s + 1, p, strlen (p) + 1);
+  return s;
+  }
+
+/*===========================================================================
+
+  bulk_err
+
+  Display an error code from the parser, with a position if there is one
+
+===========================================================================*/
+static void bulk_err (code, error_pos)
+int code;
+int error_pos;
+  {
+  printf ("%s", kc_strerror (code));
+  if (error_pos > 0) printf (" at position %d", error_pos);
+  printf ("\r\n");
+  }
+
+/*===========================================================================
+
+  bulk_defs
+
+  Returns non-zero if any variable is defined by a formula. If none is,
+  there is no need to track what depends on the variables that a
+  command updates, which saves a scan of the symbol table for every
+  value.
+
+===========================================================================*/
+static int bulk_defs ()
+  {
+  int i;
+  for (i = 0; i < nsyms; i++)
+    if (symtab[i].name && (symtab[i].type & TE_FLAG_DEFN)) return 1;
+  return 0;
+  }
+
+/*===========================================================================
+
+  bulk_num
+
+  Evaluate an expression that is an argument to a command, like the
+  limits of a range. Returns non-zero, having displayed an error, if
+  it can't be evaluated.
+
+===========================================================================*/
+static int bulk_num (expr, result)
+char *expr;
+double *result;
+  {
+  int error_pos = 0;
+  int rt_error = 0;
+  if (expr[0] == 0)
+    {
+    bulk_err (E_NOEXPR, 0);
+    return 1;
+    }
+  *result = te_interp (expr, &error_pos, &rt_error, symtab, nsyms);
+  if (rt_error) 
+    {
+    bulk_err (rt_error, error_pos);
+    return 1;
+    }
+  return 0;
+  }
+
+/*===========================================================================
+
+  bulk_name
+
+  Check that a command argument is a variable name. Returns 0, having 
+  displayed an error, if it is not.
+
+===========================================================================*/
+static int bulk_name (name)
+char *name;
+  {
+  char *p = name;
+  if (!isalpha (*p))
+    {
+    bulk_err (E_NOIDENT, 0);
+    return 0;
+    }
+  while (isalpha (*p) || isdigit (*p) || *p == '_') 
+    p++;
+  if (*p)
+    {
+    bulk_err (E_NOIDENT, 0);
+    return 0;
+    }
+  return 1;
+  }
+
+/*===========================================================================
+
+  bulk_var
+
+  Check that a command argument is a variable name, and bind the variable.
+  Returns 0, having displayed an error, if it can't be used.
+
+===========================================================================*/
+static te_variable *bulk_var (name, value)
+char *name;
+double value;
+  {
+  if (!bulk_name (name)) return 0;
+  return kc_bind (name, value);
+  }
+
+/*===========================================================================
+
+  bulk_table
+
+  TABLE expr[, expr...], var, from, to, step
+
+  Print one row for each value of the variable, with a column for each
+  expression. The value of each row's variable is worked out from the
+  start of the range, rather than by adding up steps, so rounding errors
+  don't accumulate over a long table. An error in one expression
+  is shown in its column, and does not stop the table.
+
+===========================================================================*/
+void bulk_table (args)
+char *args;
+  {
+  char *fields[TABLE_COLS + 4];
+  te_expr *cols[TABLE_COLS];
+  char buff[MAX_NUM_STR];
+  int nf, ncols, i, err, error_pos, defs;
+  double from, to, step, v;
+  long row, nrows;
+  te_variable *var;
+
+  nf = strsplit (args, fields, TABLE_COLS + 4);
+  if (nf < 5 || nf > TABLE_COLS + 4)
+    {
+    fprintf (stderr, 
+      "Usage: \"table expr, var, from, to, step\", with up to %d exprs\n",
+      TABLE_COLS);
+    return;
+    }
+  ncols = nf - 4;
+
+  if (bulk_num (fields[nf - 3], &from)) return;
+  if (bulk_num (fields[nf - 2], &to)) return;
+  if (bulk_num (fields[nf - 1], &step)) return;
+  /* The rows must be counted in a long, and a NaN fails every test */
+  if (step == 0 || !((to - from) / step >= 0) 
+      || !((to - from) / step < 2147483647.0))
+    {
+    bulk_err (E_RANGE, 0);
+    return;
+    }
+  /* Allow a little slack, so that a range like 0, 1, 0.1 includes its 
+     end point in spite of rounding. */
+  nrows = (long)((to - from) / step + 1e-9) + 1;
+
+  var = bulk_var (fields[nf - 4], from);
+  if (!var) return;
+
+  for (i = 0; i < ncols; i++)
+    {
+    cols[i] = te_build (fields[i], &error_pos, &err, symtab, nsyms);
+    if (!cols[i])
+      {
+      bulk_err (err, error_pos);
+      while (--i >= 0) te_free (cols[i]);
+      return;
+      }
+    }
+
+  defs = bulk_defs ();
+  for (row = 0; row < nrows; row++)
+    {
+    v = from + row * step;
+    *(double *)var->address = v;
+    if (defs) te_touch (symtab, nsyms, var);
+    kc_fmts (v, buff);
+    printf ("%s", bulk_trim (buff));
+    for (i = 0; i < ncols; i++)
+      {
+      err = te_try (cols[i], symtab, defs ? nsyms : 0, &v);
+      if (err)
+        printf ("\t%s", kc_strerror (err));
+      else
+        {
+        kc_fmts (v, buff);
+        printf ("\t%s", bulk_trim (buff));
+        }
+      }
+    printf ("\n");
+    }
+
+  for (i = 0; i < ncols; i++)
+    te_free (cols[i]);
+  }
+
+/*===========================================================================
+
+  bulk_show
+
+  Display one line of a summary
+
+===========================================================================*/
+static void bulk_show (label, x)
+char *label;
+double x;
+  {
+  char buff[MAX_NUM_STR];
+  kc_fmts (x, buff);
+  printf ("%-10s%s\r\n", label, bulk_trim (buff));
+  }
+
+/*===========================================================================
+
+  bulk_stats
+
+  STATS expr, var
+
+  Read numbers from the console, one per line, until a blank line or
+  the end of the input. Each number is assigned to the variable, and the
+  value of the expression is added to the statistics. Values are 
+  collected into blocks of STAT_BLOCK before being added, which is both 
+  quicker and more accurate than adding them one at a time. Only one 
+  block is held in memory, so there is no limit to the number of rows.
+
+===========================================================================*/
+void bulk_stats (args)
+char *args;
+  {
+  char *fields[2];
+  char line[128];
+  double block[STAT_BLOCK];
+  stat_acc acc;
+  te_expr *n;
+  te_variable *var;
+  char *p, *end;
+  double x, v;
+  int nb = 0;
+  int err, error_pos, defs;
+  long row = 0, bad = 0;
+
+  if (strsplit (args, fields, 2) != 2 || fields[0][0] == 0)
+    {
+    fprintf (stderr, "Usage: \"stats expr, var\"\n");
+    return;
+    }
+  var = bulk_var (fields[1], 0.0);
+  if (!var) return;
+  n = te_build (fields[0], &error_pos, &err, symtab, nsyms);
+  if (!n)
+    {
+    bulk_err (err, error_pos);
+    return;
+    }
+
+  defs = bulk_defs ();
+  stat_init (&acc);
+  printf ("Enter values, one per line, and a blank line to finish.\r\n");
+  fflush (stdout);
+  while (term_g_line (line, sizeof (line) - 1) == 0)
+    {
+    p = line;
+    while (isspace (*p)) p++;
+    if (*p == 0) break;
+    row++;
+    x = _strtod (p, &end);
+    while (isspace (*end)) end++;
+    if (end == p || *end)
+      {
+      printf ("Row %ld: not a number\r\n", row);
+      bad++;
+      continue;
+      }
+    *(double *)var->address = x;
+    if (defs) te_touch (symtab, nsyms, var);
+    err = te_try (n, symtab, defs ? nsyms : 0, &v);
+    if (err)
+      {
+      printf ("Row %ld: %s\r\n", row, kc_strerror (err));
+      bad++;
+      continue;
+      }
+    block[nb++] = v;
+    if (nb == STAT_BLOCK)
+      {
+      stat_block (&acc, block, nb);
+      nb = 0;
+      }
+    }
+  stat_block (&acc, block, nb);
+  te_free (n);
+
+  printf ("count     %ld\r\n", acc.n);
+  if (bad) printf ("skipped   %ld\r\n", bad);
+  if (acc.n == 0) return;
+  bulk_show ("sum", stat_sum (&acc));
+  bulk_show ("mean", acc.mean);
+  bulk_show ("variance", stat_var (&acc));
+  bulk_show ("std dev", sqrt (stat_var (&acc)));
+  bulk_show ("min", acc.min);
+  bulk_show ("max", acc.max);
+  }
+
+/*===========================================================================
+
+  bulk_unq
+
+  Remove the double quotes from a file name, if it has them
+
+===========================================================================*/
+static char *bulk_unq (name)
+char *name;
+  {
+  char *e;
+  if (*name == '"') name++;
+  e = name + strlen (name);
+  if (e > name && e[-1] == '"') e[-1] = 0;
+  return name;
+  }
+
+#ifdef LINUX
+/*===========================================================================
+
+  bulk_map
+
+  Map a whole file into memory, read-only. Returns 0, having displayed an
+  error, if it can't be mapped; an empty file can't be.
+
+===========================================================================*/
+static char *bulk_map (name, size)
+char *name;
+long *size;
+  {
+  int fd;
+  struct stat sb;
+  char *data;
+
+  fd = open (name, O_RDONLY);
+  if (fd < 0 || fstat (fd, &sb) < 0)
+    {
+    printf ("Can't open %s\r\n", name);
+    if (fd >= 0) close (fd);
+    return 0;
+    }
+  if (sb.st_size == 0)
+    {
+    printf ("%s is empty\r\n", name);
+    close (fd);
+    return 0;
+    }
+  data = mmap (0, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    {
+    printf ("Can't read %s\r\n", name);
+    return 0;
+    }
+  madvise (data, sb.st_size, MADV_SEQUENTIAL);
+  *size = sb.st_size;
+  return data;
+  }
+
+/*===========================================================================
+
+  bulk_rate
+
+  Report how quickly a command got through its input, on stderr so as not
+  to get mixed up with its output.
+
+===========================================================================*/
+static void bulk_rate (start, rows, bytes)
+clock_t start;
+long rows;
+long bytes;
+  {
+  double secs = (double)(clock () - start) / CLOCKS_PER_SEC;
+  fprintf (stderr, "%ld rows, %ld bytes", rows, bytes);
+  if (secs > 0) 
+    fprintf (stderr, ", %.1f MB/s, %.0f rows/s", bytes / secs / 1e6, 
+      rows / secs);
+  fprintf (stderr, "\n");
+  }
+#endif
+
+/* The state of a CSV command, shared by the functions that handle each
+   line. */
+typedef struct csv_job
+  {
+  te_variable *vars[CSV_COLS]; /* Variable for each input column, or 0 */
+  int nin;
+  te_expr *exprs[TABLE_COLS];
+  int nout;
+  char uses[TABLE_COLS][CSV_COLS]; /* Whether each expr uses each column */
+  int defs;
+  long rows;
+  long bad;
+  } csv_job;
+
+/*===========================================================================
+
+  bulk_fend
+
+  Find the end of the CSV field that starts at p, allowing for commas
+  in double quotes.
+
+===========================================================================*/
+static char *bulk_fend (p, end)
+char *p;
+char *end;
+  {
+  int quoted = 0;
+  while (p < end && (quoted || *p != ','))
+    {
+    if (*p == '"') quoted = !quoted;
+    p++;
+    }
+  return p;
+  }
+
+#ifndef LINUX
+/*===========================================================================
+
+  bulk_eol
+
+  Find the end of a line read by fgets(), excluding the terminator
+
+===========================================================================*/
+static char *bulk_eol (line)
+char *line;
+  {
+  char *e = line + strlen (line);
+  while (e > line && (e[-1] == '\n' || e[-1] == '\r')) e--;
+  return e;
+  }
+#endif
+
+/*===========================================================================
+
+  bulk_head
+
+  Process the header line of a CSV file: bind a variable to each column 
+  whose heading is a valid name, and echo the line with a heading 
+  for each new column. end is the end of the line, excluding the 
+  line terminator.
+
+===========================================================================*/
+static int bulk_head (job, p, end, names)
+csv_job *job;
+char *p;
+char *end;
+char **names;
+  {
+  char name[CSV_NAME];
+  char *q, *fend;
+  int i, l;
+
+  fwrite (p, 1, end - p, stdout);
+  for (i = 0; i < job->nout; i++)
+    {
+    if (_strchr (names[i], ','))
+      printf (",\"%s\"", names[i]);
+    else
+      printf (",%s", names[i]);
+    }
+  printf ("\n");
+
+  job->nin = 0;
+  while (p <= end && job->nin < CSV_COLS)
+    {
+    fend = bulk_fend (p, end);
+    while (p < fend && (*p == ' ' || *p == '"')) p++;
+    q = fend;
+    while (q > p && (q[-1] == ' ' || q[-1] == '"')) q--;
+    l = q - p;
+    job->vars[job->nin] = 0;
+    if (l > 0 && l < CSV_NAME && isalpha (*p))
+      {
+      _memcpy (name, p, l);
+      name[l] = 0;
+      kc_toupper (name);
+      for (q = name; isalpha (*q) || isdigit (*q) || *q == '_'; q++)
+        ;
+      if (*q == 0)
+        {
+        job->vars[job->nin] = kc_bind (name, 0.0);
+        if (!job->vars[job->nin]) return 1;
+        }
+      }
+    job->nin++;
+    p = fend + 1;
+    }
+  return 0;
+  }
+
+/*===========================================================================
+
+  bulk_row
+
+  Process one data line of a CSV file. The fields are converted where
+  they lie, without being copied or terminated, and the line itself is
+  written out unchanged, followed by the new columns. A value that can't
+  be calculated, because a field that it uses is not a number or because
+  of an error in the expression, is left empty. end is the end of the line, 
+  excluding the line terminator.
+
+===========================================================================*/
+static void bulk_row (job, p, end)
+csv_job *job;
+char *p;
+char *end;
+  {
+  char buff[MAX_NUM_STR];
+  char failed[CSV_COLS];
+  char *line = p, *fend, *q;
+  int col, i, ok, nfail = 0, err = 0;
+  double x;
+
+  if (end > p && end[-1] == '\r') end--;
+  if (end == p) return;
+
+  for (col = 0; col < job->nin; col++)
+    {
+    failed[col] = 0;
+    if (!job->vars[col]) 
+      {
+      if (p <= end) p = bulk_fend (p, end) + 1;
+      continue;
+      }
+    fend = p <= end ? bulk_fend (p, end) : p;
+    x = strtodn (p, fend, &q);
+    while (q < fend && *q == ' ') q++;
+    if (p > end || q == p || q != fend)
+      {
+      failed[col] = 1;
+      nfail++;
+      }
+    else
+      {
+      *(double *)job->vars[col]->address = x;
+      if (job->defs) te_touch (symtab, nsyms, job->vars[col]);
+      }
+    p = fend + 1;
+    }
+
+  fwrite (line, 1, end - line, stdout);
+  for (i = 0; i < job->nout; i++)
+    {
+    putchar (',');
+    ok = 1;
+    for (col = 0; nfail && col < job->nin; col++)
+      if (failed[col] && job->uses[i][col]) ok = 0;
+    if (ok && te_try (job->exprs[i], symtab, job->defs ? nsyms : 0, &x) == 0)
+      {
+      kc_fmts (x, buff);
+      fputs (bulk_trim (buff), stdout);
+      }
+    else
+      err = 1;
+    }
+  putchar ('\n');
+  job->rows++;
+  if (err) job->bad++;
+  }
+
+/*===========================================================================
+
+  bulk_csv
+
+  CSV "file", expr[, expr...]
+
+  Add columns to a CSV file, computed from the columns it has. The first
+  line of the file must be column headings; each heading that is a valid
+  name becomes a variable that can be used in the expressions. The 
+  result is written to the console (which can be redirected). 
+
+  On Linux the file is mapped into memory, and processed where it lies;
+  on CP/M it is read a line at a time, and lines must be shorter than
+  CSV_LINE.
+
+===========================================================================*/
+void bulk_csv (args)
+char *args;
+  {
+  char *fields[TABLE_COLS + 1];
+  csv_job job;
+  char *name, *p, *e;
+  int nf, nc, i, err, error_pos;
+#ifdef LINUX
+  long size;
+  char *data, *end;
+  clock_t start;
+#else
+  FILE *f;
+  char line[CSV_LINE];
+#endif
+
+  nf = strsplit (args, fields, TABLE_COLS + 1);
+  if (nf < 2 || nf > TABLE_COLS + 1)
+    {
+    fprintf (stderr, 
+      "Usage: \"csv \"file\", expr\", with up to %d exprs\n", TABLE_COLS);
+    return;
+    }
+  name = bulk_unq (fields[0]);
+
+  _memset (&job, 0, sizeof (job));
+  job.nout = nf - 1;
+
+#ifdef LINUX
+  data = bulk_map (name, &size);
+  if (!data) return;
+  end = data + size;
+  start = clock ();
+
+  p = data;
+  e = memchr (p, '\n', end - p);
+  if (!e) e = end;
+  if (bulk_head (&job, p, (e > p && e[-1] == '\r') ? e - 1 : e, 
+       fields + 1) == 0)
+#else
+  f = fopen (name, "r");
+  if (!f)
+    {
+    printf ("Can't open %s\r\n", name);
+    return;
+    }
+  if (fgets (line, sizeof (line), f) 
+       && bulk_head (&job, line, bulk_eol (line), fields + 1) == 0)
+#endif
+    {
+    /* The headings are variables now, so the expressions can be 
+       compiled. */
+    for (nc = 0; nc < job.nout; nc++)
+      {
+      job.exprs[nc] = te_build (fields[nc + 1], &error_pos, &err, 
+        symtab, nsyms);
+      if (!job.exprs[nc])
+        {
+        bulk_err (err, error_pos);
+        break;
+        }
+      }
+    job.defs = bulk_defs ();
+
+    /* Columns that no expression uses need not be converted at all */
+    for (i = 0; i < job.nin; i++)
+      {
+      int j, used = 0;
+      for (j = 0; j < nc; j++)
+        {
+        job.uses[j][i] = job.vars[i] 
+          && te_deps (symtab, nsyms, job.exprs[j], job.vars[i]);
+        used |= job.uses[j][i];
+        }
+      if (!used) job.vars[i] = 0;
+      }
+
+    if (nc == job.nout)
+      {
+#ifdef LINUX
+      for (p = e + 1; p < end; p = e + 1)
+        {
+        e = memchr (p, '\n', end - p);
+        if (!e) e = end;
+        bulk_row (&job, p, e);
+        }
+#else
+      while (fgets (line, sizeof (line), f))
+        bulk_row (&job, line, bulk_eol (line));
+#endif
+      }
+    for (i = 0; i < nc; i++) 
+      te_free (job.exprs[i]);
+    }
+  fflush (stdout);
+
+#ifdef LINUX
+  munmap (data, size);
+  bulk_rate (start, job.rows, size);
+#else
+  fclose (f);
+#endif
+  if (job.bad) printf ("%ld rows could not be calculated\r\n", job.bad);
+  }
+
+/*===========================================================================
+
+  bulk_nums
+
+  Read the numbers in a file, storing them in v if it is not 0. Returns
+  the number of numbers, or -1, having displayed an error, if there is 
+  something in the file that is not a number.
+
+===========================================================================*/
+static int bulk_nums (f, v)
+FILE *f;
+te_vec *v;
+  {
+  char line[CSV_LINE];
+  char *p, *e;
+  long ln = 0;
+  int n = 0;
+  double x;
+
+  while (fgets (line, sizeof (line), f))
+    {
+    ln++;
+    for (p = line; ; p = e)
+      {
+      while (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r' 
+           || *p == '\n')
+        p++;
+      if (*p == 0) break;
+      x = _strtod (p, &e);
+      if (e == p)
+        {
+        printf ("Not a number at line %ld\r\n", ln);
+        return -1;
+        }
+      if (v && n < v->n) v->v[n] = x;
+      /* Stop counting when there are too many; te_vnew() will fail */
+      if (n <= VEC_MAX) n++;
+      }
+    }
+  return n;
+  }
+
+/*===========================================================================
+
+  bulk_load
+
+  LOAD "file", var
+
+  Read the numbers in a file into a vector variable. The numbers may be 
+  separated by spaces, tabs, commas, or line breaks. The file is read 
+  twice, first to count the numbers, so that the vector can be allocated
+  in one piece.
+
+===========================================================================*/
+void bulk_load (args)
+char *args;
+  {
+  char *fields[2];
+  char *name;
+  te_vec *v;
+  FILE *f;
+  int n;
+
+  if (strsplit (args, fields, 2) != 2)
+    {
+    fprintf (stderr, "Usage: \"load \"file\", var\"\n");
+    return;
+    }
+  if (!bulk_name (fields[1])) return;
+  name = bulk_unq (fields[0]);
+
+  f = fopen (name, "r");
+  if (!f)
+    {
+    printf ("Can't open %s\r\n", name);
+    return;
+    }
+  n = bulk_nums (f, 0);
+  fclose (f);
+  if (n < 0) return;
+  if (n == 0)
+    {
+    printf ("No numbers in %s\r\n", name);
+    return;
+    }
+  if ((v = te_vnew (n)) == 0)
+    {
+    bulk_err (E_NOMEM, 0);
+    return;
+    }
+
+  f = fopen (name, "r");
+  if (!f || bulk_nums (f, v) != n)
+    {
+    /* The file has changed under us */
+    if (f) fclose (f);
+    te_vfree (v);
+    printf ("Can't read %s\r\n", name);
+    return;
+    }
+  fclose (f);
+  kc_set_vec (fields[1], v);
+  }
+
+/*===========================================================================
+
+  bulk_range
+
+  Parse a SWEEP range, var = from:to:count, leaving the variable's name
+  in *name. Returns non-zero, having displayed an error, if it can't be
+  used.
+
+===========================================================================*/
+static int bulk_range (spec, name, from, to, cnt)
+char *spec;
+char **name;
+double *from;
+double *to;
+int *cnt;
+  {
+  char *p, *q;
+  double n;
+  if ((p = _strchr (spec, '=')) == 0 || (q = _strchr (p + 1, ':')) == 0)
+    {
+    fprintf (stderr, "Usage: \"var = from:to:count\"\n");
+    return 1;
+    }
+  *p++ = 0;
+  *q++ = 0;
+  kc_trim_right (spec);
+  *name = spec;
+  if (!bulk_name (spec) || bulk_num (p, from)) return 1;
+  if ((p = _strchr (q, ':')) == 0)
+    {
+    fprintf (stderr, "Usage: \"var = from:to:count\"\n");
+    return 1;
+    }
+  *p++ = 0;
+  if (bulk_num (q, to) || bulk_num (p, &n)) return 1;
+  if (n < 1 || n > VEC_MAX || n != floor (n))
+    {
+    bulk_err (E_RANGE, 0);
+    return 1;
+    }
+  *cnt = n;
+  return 0;
+  }
+
+/*===========================================================================
+
+  bulk_at
+
+  Display one line of a SWEEP summary, with the point it refers to
+
+===========================================================================*/
+static void bulk_at (label, x, names, at, nv)
+char *label;
+double x;
+char **names;
+double *at;
+int nv;
+  {
+  char buff[MAX_NUM_STR];
+  int i;
+  if (label)
+    {
+    kc_fmts (x, buff);
+    printf ("%-10s%s", label, bulk_trim (buff));
+    }
+  printf (" at ");
+  for (i = 0; i < nv; i++)
+    {
+    kc_fmts (at[i], buff);
+    printf ("%s%s = %s", i ? ", " : "", names[i], bulk_trim (buff));
+    }
+  printf ("\r\n");
+  }
+
+/*===========================================================================
+
+  bulk_fdeps
+
+  Returns non-zero if a compiled expression uses a formula that depends
+  on a variable. Formulas are worked out as numbers (see refresh() in 
+  tinyexpr.c), so such an expression can't be evaluated with the 
+  variable as a vector.
+
+===========================================================================*/
+static int bulk_fdeps (n, var)
+te_expr *n;
+te_variable *var;
+  {
+  int i;
+  for (i = 0; i < nsyms; i++)
+    {
+    te_variable *v = &symtab[i];
+    if (v != var && v->name && (v->type & TE_FLAG_DEFN) 
+        && te_deps (symtab, nsyms, n, v) 
+        && te_deps (symtab, nsyms, v->context, var))
+      return 1;
+    }
+  return 0;
+  }
+
+/*===========================================================================
+
+  bulk_each
+
+  Evaluate an expression for each value in a vector, one at a time, with
+  the variable set to that value, as TABLE does. The results are left in
+  a new vector in *row, and the errors, as for te_vtry(), in *errs, 
+  which is 0 if there were none. Returns an error code if there isn't 
+  the memory, and 0 otherwise.
+
+===========================================================================*/
+static int bulk_each (n, var, grid, row, errs)
+te_expr *n;
+te_variable *var;
+te_vec *grid;
+te_vec **row;
+char **errs;
+  {
+  int i, err;
+  *errs = 0;
+  if ((*row = te_vnew (grid->n)) == 0) return E_NOMEM;
+  for (i = 0; i < grid->n; i++)
+    {
+    *(double *)var->address = grid->v[i];
+    te_touch (symtab, nsyms, var);
+    err = te_try (n, symtab, nsyms, &(*row)->v[i]);
+    if (!err) continue;
+    if (!*errs)
+      {
+      if ((*errs = malloc (grid->n)) == 0)
+        {
+        te_vfree (*row);
+        *row = 0;
+        return E_NOMEM;
+        }
+      _memset (*errs, 0, grid->n);
+      }
+    (*errs)[i] = err;
+    }
+  return 0;
+  }
+
+/*===========================================================================
+
+  bulk_sweep
+
+  SWEEP expr, var = from:to:count[, var = from:to:count...]
+
+  Evaluate an expression over every point of a grid, and show the 
+  statistics of its values: where it is smallest and largest, its mean, 
+  and how many points it is positive at (so a condition like "inside a
+  circle" can be counted as 1 - x^2 - y^2). The values are not kept, so 
+  the grid can have any number of points. The first variable is made a
+  vector of its values, and the expression is evaluated for one line of
+  the grid at a time, as a vector; the other variables step through 
+  their values like the digits of a counter. A point that can't be 
+  calculated is counted, and the first such is shown, but doesn't stop
+  the sweep. If the expression uses a formula in the first variable, the
+  line is evaluated one point at a time instead (see bulk_each()).
+
+===========================================================================*/
+void bulk_sweep (args)
+char *args;
+  {
+  char *fields[SWEEP_VARS + 1];
+  char *names[SWEEP_VARS];
+  te_variable *vars[SWEEP_VARS];
+  double from[SWEEP_VARS], to[SWEEP_VARS];
+  double at[SWEEP_VARS], minat[SWEEP_VARS], maxat[SWEEP_VARS];
+  double errat[SWEEP_VARS];
+  int cnt[SWEEP_VARS], idx[SWEEP_VARS];
+  double min = 0, max = 0, x;
+  long points = 0, bad = 0, pos = 0;
+  stat_acc acc;
+  te_vec *grid, *row;
+  te_expr *n = 0;
+  char *errs;
+  int nf, nv, i, k, err, error_pos, defs, each, first = 0;
+
+  nf = strsplit (args, fields, SWEEP_VARS + 1);
+  if (nf < 2 || fields[0][0] == 0)
+    {
+    fprintf (stderr, "Usage: \"sweep expr, var = from:to:count...\", "
+      "with up to %d vars\n", SWEEP_VARS);
+    return;
+    }
+  for (nv = 0; nv < nf - 1; nv++)
+    {
+    if (bulk_range (fields[nv + 1], &names[nv], &from[nv], &to[nv], 
+        &cnt[nv])) 
+      return;
+    if ((vars[nv] = bulk_var (names[nv], from[nv])) == 0) return;
+    idx[nv] = 0;
+    }
+
+  n = te_build (fields[0], &error_pos, &err, symtab, nsyms);
+  if (!n)
+    {
+    bulk_err (err, error_pos);
+    return;
+    }
+  defs = bulk_defs ();
+  each = defs && bulk_fdeps (n, vars[0]);
+
+  /* The first variable holds a whole line of the grid, unless the line
+     has to be evaluated a point at a time */
+  if ((grid = te_vnew (cnt[0])) == 0)
+    {
+    te_free (n);
+    bulk_err (E_NOMEM, 0);
+    return;
+    }
+  for (i = 0; i < cnt[0]; i++)
+    grid->v[i] = cnt[0] == 1 ? from[0] 
+      : from[0] + (to[0] - from[0]) * i / (cnt[0] - 1);
+  if (!each)
+    {
+    te_free (n);
+    kc_set_vec (names[0], grid);
+    if (!(vars[0]->type & TE_FLAG_VEC)) return;
+    n = te_build (fields[0], &error_pos, &err, symtab, nsyms);
+    if (!n) bulk_err (err, error_pos);
+    }
+  err = !n;
+  stat_init (&acc);
+  while (n)
+    {
+    for (k = 1; k < nv; k++)
+      {
+      at[k] = cnt[k] == 1 ? from[k] 
+        : from[k] + (to[k] - from[k]) * idx[k] / (cnt[k] - 1);
+      *(double *)vars[k]->address = at[k];
+      if (defs) te_touch (symtab, nsyms, vars[k]);
+      }
+    if (each)
+      err = bulk_each (n, vars[0], grid, &row, &errs);
+    else
+      err = te_vtry (n, symtab, defs ? nsyms : 0, &x, &row, &errs);
+    if (err)
+      {
+      bulk_err (err, 0);
+      break;
+      }
+    if (row && row->n != cnt[0])
+      {
+      /* A vector of its own, which doesn't line up with the grid */
+      te_vfree (row);
+      if (errs) free (errs);
+      bulk_err (err = E_VLEN, 0);
+      break;
+      }
+    if (!row)
+      {
+      /* The expression doesn't depend on the first variable */
+      if ((row = te_vnew (cnt[0])) == 0)
+        {
+        bulk_err (err = E_NOMEM, 0);
+        break;
+        }
+      for (i = 0; i < cnt[0]; i++) row->v[i] = x;
+      }
+
+    for (i = 0, k = 0; i < cnt[0]; i++)
+      {
+      x = row->v[i];
+      if (errs && errs[i])
+        {
+        if (!bad++)
+          {
+          first = errs[i];
+          _memcpy (errat, at, sizeof (at));
+          errat[0] = grid->v[i];
+          }
+        continue;
+        }
+      if (!points++ || x < min)
+        {
+        min = x;
+        _memcpy (minat, at, sizeof (at));
+        minat[0] = grid->v[i];
+        }
+      if (points == 1 || x > max)
+        {
+        max = x;
+        _memcpy (maxat, at, sizeof (at));
+        maxat[0] = grid->v[i];
+        }
+      if (x > 0) pos++;
+      row->v[k++] = x;
+      }
+    stat_block (&acc, row->v, k);
+    te_vfree (row);
+    if (errs) free (errs);
+
+    /* Step the other variables, the second fastest */
+    for (k = 1; k < nv && ++idx[k] == cnt[k]; k++)
+      idx[k] = 0;
+    if (k == nv) break;
+    }
+
+  if (n) te_free (n);
+  if (each) te_vfree (grid);
+  /* Leave the first variable a number, like the others */
+  kc_bind (names[0], to[0]);
+  if (err) return;
+  printf ("points    %ld\r\n", points);
+  if (bad) 
+    {
+    printf ("skipped   %ld, first %s", bad, kc_strerror (first));
+    bulk_at (0, 0.0, names, errat, nv);
+    }
+  if (points == 0) return;
+  bulk_at ("min", min, names, minat, nv);
+  bulk_at ("max", max, names, maxat, nv);
+  bulk_show ("mean", acc.mean);
+  printf ("positive  %ld\r\n", pos);
+  }
+
+/*===========================================================================
+
+  bulk_shake
+
+  Mark every formula that uses random numbers as out of date, with 
+  everything that depends on it, so that it is worked out again for 
+  each sample. Returns the number of such formulas.
+
+===========================================================================*/
+static int bulk_shake ()
+  {
+  int i, k = 0;
+  for (i = 0; i < nsyms; i++)
+    {
+    te_variable *v = &symtab[i];
+    if (v->name && (v->type & TE_FLAG_DEFN) && te_random (v->context))
+      {
+      v->type |= TE_FLAG_DIRTY;
+      te_touch (symtab, nsyms, v);
+      k++;
+      }
+    }
+  return k;
+  }
+
+/*===========================================================================
+
+  bulk_mc
+
+  MONTECARLO expr, count[, seed]
+
+  Evaluate an expression that uses random numbers (UNIFORM, NORMAL) 
+  count times, and show the statistics of its values. Before each 
+  evaluation, the random numbers are started for that sample (see 
+  rn_start()), and any formulas that use them are worked out again, so
+  the same seed always gives the same results. Samples
+  that can't be calculated are counted, and the first is shown, but 
+  don't stop the others.
+
+===========================================================================*/
+void bulk_mc (args)
+char *args;
+  {
+  char *fields[3];
+  double block[STAT_BLOCK];
+  stat_acc acc;
+  te_expr *n;
+  double count, seed = 1, v;
+  long i, bad = 0, firstat = 0;
+  int nf, nb = 0, err, error_pos, defs, rands, first = 0;
+
+  nf = strsplit (args, fields, 3);
+  if (nf < 2 || fields[0][0] == 0)
+    {
+    fprintf (stderr, "Usage: \"montecarlo expr, count[, seed]\"\n");
+    return;
+    }
+  if (bulk_num (fields[1], &count)) return;
+  if (nf == 3 && bulk_num (fields[2], &seed)) return;
+  if (count < 1 || count > 2147483647.0 || count != floor (count)
+      || seed != floor (seed))
+    {
+    bulk_err (E_RANGE, 0);
+    return;
+    }
+  n = te_build (fields[0], &error_pos, &err, symtab, nsyms);
+  if (!n)
+    {
+    bulk_err (err, error_pos);
+    return;
+    }
+
+  defs = bulk_defs ();
+  rands = defs;
+  stat_init (&acc);
+  for (i = 0; i < (long)count; i++)
+    {
+    rn_start ((long)seed, i);
+    if (rands) rands = bulk_shake ();
+    err = te_try (n, symtab, defs ? nsyms : 0, &v);
+    if (err)
+      {
+      if (!bad++)
+        {
+        first = err;
+        firstat = i + 1;
+        }
+      continue;
+      }
+    block[nb++] = v;
+    if (nb == STAT_BLOCK)
+      {
+      stat_block (&acc, block, nb);
+      nb = 0;
+      }
+    }
+  stat_block (&acc, block, nb);
+  te_free (n);
+
+  printf ("samples   %ld\r\n", acc.n);
+  if (bad) 
+    printf ("skipped   %ld, first %s at sample %ld\r\n", bad, 
+      kc_strerror (first), firstat);
+  if (acc.n == 0) return;
+  bulk_show ("mean", acc.mean);
+  bulk_show ("std dev", sqrt (stat_var (&acc)));
+  bulk_show ("std error", sqrt (stat_var (&acc) / acc.n));
+  bulk_show ("min", acc.min);
+  bulk_show ("max", acc.max);
+  }
+
+#ifdef LINUX
+/*===========================================================================
+
+  bulk_swap
+
+  Reverse the bytes of a double, on a machine that is not little-endian
+
+===========================================================================*/
+static double bulk_swap (x)
+double x;
+  {
+  unsigned char *p = (unsigned char *)&x, t;
+  int i;
+  for (i = 0; i < 4; i++)
+    {
+    t = p[i];
+    p[i] = p[7 - i];
+    p[7 - i] = t;
+    }
+  return x;
+  }
+
+/*===========================================================================
+
+  bulk_binary
+
+  BINARY "out", expr, var = "file"[, var = "file"...]
+
+  Evaluate an expression over columns of numbers held as raw little-endian
+  IEEE double-precision values, one file per variable, and write the 
+  results in the same format. The input files are mapped into memory and
+  used directly, and the results are written in blocks, so nothing
+  is converted to or from text. The number of rows is the length of the
+  shortest input, each of which must be a whole number of doubles. A row
+  that can't be calculated gives a NaN, and is counted on stderr. The 
+  output file may be "-", for the console, but not one of the inputs.
+
+  This command is only available on Linux: the Aztec floating-point 
+  format is not IEEE.
+
+===========================================================================*/
+void bulk_binary (args)
+char *args;
+  {
+  char *fields[BIN_VARS + 2];
+  te_variable *vars[BIN_VARS];
+  double *data[BIN_VARS];
+  long sizes[BIN_VARS];
+  struct stat ins[BIN_VARS], sb;
+  double block[BIN_BLOCK];
+  double one = 1.0;
+  te_expr *n = 0;
+  FILE *out = 0;
+  char *name, *eq;
+  int nf, nv, i, k, swap, err, error_pos;
+  long row, rows = -1, bad = 0;
+  clock_t start;
+
+  nf = strsplit (args, fields, BIN_VARS + 2);
+  if (nf < 3 || nf > BIN_VARS + 2)
+    {
+    fprintf (stderr, "Usage: \"binary \"out\", expr, var = \"in\"...\", "
+      "with up to %d vars\n", BIN_VARS);
+    return;
+    }
+  swap = ((unsigned char *)&one)[7] != 0x3f;
+
+  for (nv = 0; nv < nf - 2; nv++)
+    {
+    eq = _strchr (fields[nv + 2], '=');
+    if (!eq)
+      {
+      bulk_err (E_NOEXPR, 0);
+      break;
+      }
+    name = eq + 1;
+    while (*name == ' ') name++;
+    name = bulk_unq (name);
+    *eq = 0;
+    kc_trim_right (fields[nv + 2]);
+    vars[nv] = bulk_var (fields[nv + 2], 0.0);
+    if (!vars[nv]) break;
+    data[nv] = (double *)bulk_map (name, &sizes[nv]);
+    if (!data[nv]) break;
+    if (sizes[nv] % (long)sizeof (double) != 0)
+      {
+      /* Probably not doubles at all, or cut short */
+      printf ("%s is not a whole number of doubles\r\n", name);
+      munmap (data[nv], sizes[nv]);
+      break;
+      }
+    if (stat (name, &ins[nv]) < 0) ins[nv].st_ino = 0;
+    if (rows < 0 || sizes[nv] / (long)sizeof (double) < rows)
+      rows = sizes[nv] / (long)sizeof (double);
+    }
+
+  if (nv == nf - 2)
+    {
+    n = te_build (fields[1], &error_pos, &err, symtab, nsyms);
+    if (!n) bulk_err (err, error_pos);
+    }
+  if (n)
+    {
+    name = bulk_unq (fields[0]);
+    /* Opening an input for output would empty it, under its mapping */
+    i = nv;
+    if (strcmp (name, "-") != 0 && stat (name, &sb) == 0)
+      for (i = 0; i < nv; i++)
+        if (ins[i].st_ino == sb.st_ino && ins[i].st_dev == sb.st_dev) break;
+    if (i < nv)
+      printf ("%s is also an input\r\n", name);
+    else
+      {
+      out = strcmp (name, "-") == 0 ? stdout : fopen (name, "wb");
+      if (!out) printf ("Can't open %s\r\n", name);
+      }
+    }
+
+  if (n && out)
+    {
+    int defs = bulk_defs ();
+    start = clock ();
+    for (row = 0, k = 0; row < rows; row++)
+      {
+      for (i = 0; i < nv; i++)
+        {
+        *(double *)vars[i]->address = 
+          swap ? bulk_swap (data[i][row]) : data[i][row];
+        if (defs) te_touch (symtab, nsyms, vars[i]);
+        }
+      if (te_try (n, symtab, defs ? nsyms : 0, &block[k]))
+        {
+        block[k] = NAN;
+        bad++;
+        }
+      if (swap) block[k] = bulk_swap (block[k]);
+      if (++k == BIN_BLOCK || row == rows - 1)
+        {
+        fwrite (block, sizeof (double), k, out);
+        k = 0;
+        }
+      }
+    fflush (out);
+    bulk_rate (start, rows, rows * (long)sizeof (double) * (nv + 1));
+    /* On stderr, like the rate, since the output may be the console */
+    if (bad) fprintf (stderr, "%ld rows could not be calculated\n", bad);
+    }
+
+  if (out && out != stdout) fclose (out);
+  if (n) te_free (n);
+  for (i = 0; i < nv; i++)
+    munmap (data[i], sizes[i]);
+  }
+#endif
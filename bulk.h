@@ -0,0 +1,44 @@
+/*===========================================================================
+
+  bulk.h
+
+  Commands that evaluate expressions many times over. 
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __BULK_H
+#define __BULK_H
+
+/* TABLE expr[, expr...], var, from, to, step. 
+   args: char *args -- the command line after the command name */
+void bulk_table ();
+
+/* STATS expr, var -- statistics of expr over values read from the console.
+   args: char *args -- the command line after the command name */
+void bulk_stats ();
+
+/* CSV "file", expr[, expr...] -- add calculated columns to a CSV file.
+   args: char *args -- the command line after the command name */
+void bulk_csv ();
+
+/* LOAD "file", var -- read the numbers in a file into a vector.
+   args: char *args -- the command line after the command name */
+void bulk_load ();
+
+/* SWEEP expr, var = from:to:count... -- statistics of expr over a grid.
+   args: char *args -- the command line after the command name */
+void bulk_sweep ();
+
+/* MONTECARLO expr, count[, seed] -- statistics of an expression that 
+   uses random numbers. args: char *args -- the command line after the 
+   command name */
+void bulk_mc ();
+
+#ifdef LINUX
+/* BINARY "out", expr, var = "in"... -- evaluate over raw binary doubles.
+   args: char *args -- the command line after the command name */
+void bulk_binary ();
+#endif
+
+#endif
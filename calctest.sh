@@ -0,0 +1,99 @@
+#!/bin/sh
+# Check the answers that kcalc gives where they are known, mostly where 
+# formulas (:=) meet the commands that evaluate an expression many times
+# over. Each case gives kcalc some lines, and compares what it shows, 
+# without the banner, prompts and blank lines, with what it should show.
+# Run from the directory that kcalc was built in.
+
+bad=0
+check ()
+  {
+  got=$(printf '%s\n' "$2" | ./kcalc 2>&1 | tr '\r' '\n' \
+    | grep -v '^kcalc> *$' | grep -v '^$' | tail -n +3)
+  if [ "$got" = "$3" ]; then
+    echo "  $1: ok"
+  else
+    echo "  $1: FAILED, shows"
+    echo "$got" | sed 's/^/    /'
+    bad=1
+  fi
+  }
+
+# A formula in the first variable of a sweep, which is evaluated a point
+# at a time, and in the second
+check "sweep, formula in the first variable" \
+"x=1
+y := x^2
+sweep y, x=0:2:3
+y" \
+"points    3
+min       0 at X = 0
+max       4 at X = 2
+mean      1.6667
+positive  2
+    4"
+
+check "sweep, formula in the second variable" \
+"x=1
+y := x^2
+sweep y+z, z=0:1:2, x=0:2:3" \
+"points    6
+min       0 at Z = 0, X = 0
+max       5 at Z = 1, X = 2
+mean      2.1667
+positive  5"
+
+# Formulas that use random numbers, which are worked out again for each
+# sample, and so give the same results as the expression itself
+check "montecarlo, formulas with random numbers" \
+"r := uniform(0,1)
+s := 2*r + normal(0,1)
+montecarlo r, 100
+montecarlo s, 100" \
+"samples   100
+mean      0.47027
+std dev   0.3227
+std error 0.03227
+min       0.0065382
+max       0.99592
+samples   100
+mean      0.97959
+std dev   1.1855
+std error 0.11855
+min       -2.7356
+max       3.4536"
+
+# Fractions, and numbers in FRAC mode that aren't, which are shown as
+# such even when they have been rounded to a whole number
+check "frac, exact and not" \
+"frac
+0.1 + 0.2
+0.333333333333333333333 * 3
+(2^62)/(2^62+1)*3
+x = sqrt(2)
+x^2
+dec
+y = 1/3
+frac
+y*3" \
+"3/10
+~1
+~3
+~2
+1"
+
+# A formula can't be evaluated over the variable of a function like SUM,
+# which is the call's own, but can be used with another
+check "sum, formula in the loop variable" \
+"x=2
+y := x^2
+sum(y,x,1,3)
+solve(y-4,x,1)
+sum(x^2,x,1,3)
+sum(y*i,i,1,3)" \
+"Formula uses the loop variable 
+Formula uses the loop variable 
+   14
+   24"
+
+exit $bad
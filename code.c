@@ -0,0 +1,210 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  code.c
+
+  The CODE command, which writes an expression out as a C function, so
+  that a program that needs a formula that is known when it is built can
+  have it compiled along with the rest of its code, rather than parsing
+  it each time it runs. The expression goes through the same parser as
+  any other, so the function behaves as kcalc does: constant parts are
+  already worked out, polynomials are evaluated by Horner's rule, and
+  the built-in functions are the ones in funcs.c, reached through the
+  macros in kcode.h.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "ctype.h"
+#include "math.h"
+#include "tinyexpr.h"
+#include "config.h"
+#include "compat.h"
+#include "strutil.h"
+#include "kcalc.h"
+#include "code.h"
+#ifdef LINUX
+#include <string.h>
+#include <stdlib.h>
+#endif
+
+/*===========================================================================
+
+  code_err
+
+  Display an error code from the parser, with a position if there is one
+
+===========================================================================*/
+static void code_err (code, error_pos)
+int code;
+int error_pos;
+  {
+  printf ("%s", kc_strerror (code));
+  if (error_pos > 0) printf (" at position %d", error_pos);
+  printf ("\r\n");
+  }
+
+/*===========================================================================
+
+  code_name
+
+  Returns the end of the name at the start of s, or s itself if there
+  is no name there
+
+===========================================================================*/
+static char *code_name (s)
+char *s;
+  {
+  if (!isalpha (*s)) return s;
+  while (isalpha (*s) || isdigit (*s) || *s == '_')
+    s++;
+  return s;
+  }
+
+/*===========================================================================
+
+  code_lower
+
+  Display a name in lower case
+
+===========================================================================*/
+static void code_lower (s)
+char *s;
+  {
+  while (*s) putchar (tolower (*s++));
+  }
+
+/*===========================================================================
+
+  code_func
+
+  CODE name(param[, param...]) = expr
+
+  The parameters are looked up before the symbol table, so they hide any
+  variables of the same names while the expression is compiled. The
+  function is written in both ANSI and K&R form, chosen by KC_ANSI, so
+  that it can be compiled by the same compilers as kcalc itself, and by
+  C++ compilers.
+
+===========================================================================*/
+void code_func (args)
+char *args;
+  {
+  char *fields[CODE_ARGS + 1];
+  char *name, *end, *expr;
+  te_variable *vars;
+  te_expr *n;
+  int nf, i, err, error_pos;
+
+  while (isspace (*args)) args++;
+  name = args;
+  end = code_name (name);
+  args = end;
+  while (isspace (*args)) args++;
+  if (end == name || *args != '(' || (expr = _strchr (args, ')')) == 0)
+    {
+    fprintf (stderr, "Usage: \"code name(param, ...) = expr\"\n");
+    return;
+    }
+  *end = 0;
+  *expr++ = 0;
+  while (isspace (*expr)) expr++;
+  if (*expr++ != '=')
+    {
+    fprintf (stderr, "Usage: \"code name(param, ...) = expr\"\n");
+    return;
+    }
+  while (isspace (*expr)) expr++;
+  kc_trim_right (expr);
+  if (*expr == 0)
+    {
+    code_err (E_NOEXPR, 0);
+    return;
+    }
+
+  args++;
+  while (isspace (*args)) args++;
+  nf = *args ? strsplit (args, fields, CODE_ARGS) : 0;
+  if (nf > CODE_ARGS)
+    {
+    fprintf (stderr, "A function can have at most %d parameters\n",
+      CODE_ARGS);
+    return;
+    }
+
+  if ((vars = malloc ((nf + nsyms) * sizeof (te_variable))) == 0)
+    {
+    code_err (E_NOMEM, 0);
+    return;
+    }
+  for (i = 0; i < nf; i++)
+    {
+    end = code_name (fields[i]);
+    if (end == fields[i] || *end)
+      {
+      code_err (E_NOIDENT, 0);
+      free (vars);
+      return;
+      }
+    vars[i].name = fields[i];
+    vars[i].address = &vars[i].num;
+    vars[i].type = TE_VARIABLE;
+    vars[i].context = 0;
+    vars[i].num = 0.0;
+    }
+  for (i = 0; i < nsyms; i++)
+    {
+    vars[nf + i] = symtab[i];
+#ifdef LINUX
+    /* The symbol table's copy is the one that gets freed */
+    vars[nf + i].big = 0;
+#endif
+    }
+
+  n = te_build (expr, &error_pos, &err, vars, nf + nsyms);
+  if (n)
+    {
+    err = te_code (n, symtab, nsyms, vars, nf, 0);
+    error_pos = -1;
+    }
+  if (err)
+    code_err (err, error_pos);
+  else
+    {
+    printf ("/* %s(", name);
+    for (i = 0; i < nf; i++) printf (i ? ", %s" : "%s", fields[i]);
+    printf (") = %s, written by KCalc; see kcode.h */\n", expr);
+    printf ("#ifdef KC_ANSI\ndouble ");
+    code_lower (name);
+    printf (nf ? " (" : " (void");
+    for (i = 0; i < nf; i++)
+      {
+      printf (i ? ", double " : "double ");
+      code_lower (fields[i]);
+      }
+    printf (")\n#else\ndouble ");
+    code_lower (name);
+    printf (" (");
+    for (i = 0; i < nf; i++)
+      {
+      if (i) printf (", ");
+      code_lower (fields[i]);
+      }
+    printf (")\n");
+    for (i = 0; i < nf; i++)
+      {
+      printf ("double ");
+      code_lower (fields[i]);
+      printf (";\n");
+      }
+    printf ("#endif\n  {\n  return ");
+    te_code (n, symtab, nsyms, vars, nf, 1);
+    printf (";\n  }\n");
+    }
+  te_free (n);
+  free (vars);
+  }
+
@@ -0,0 +1,17 @@
+/*===========================================================================
+
+  code.h
+
+  The CODE command, which writes an expression as a C function.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __CODE_H
+#define __CODE_H
+
+/* CODE name(param[, param...]) = expr -- write expr as a C function.
+   args: char *args -- the command line after the command name */
+void code_func ();
+
+#endif
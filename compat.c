@@ -119,6 +119,27 @@ CONST char *str;
   }
 
 
+/*
+  span_atof
+  _atof() of the number from str up to end. A number of a sensible 
+  length is copied first, because sscanf() in some C libraries finds
+  the length of the whole string it is given, which would make reading
+  a long expression, number by number, take time proportional to the
+  square of its length.
+*/
+static double span_atof (str, end)
+CONST char *str;
+CONST char *end;
+  {
+  char buff[64];
+  int n = end - str;
+  if (n >= (int)sizeof (buff)) return _atof (str);
+  _memcpy (buff, str, n);
+  buff[n] = 0;
+  return _atof (buff);
+  }
+
+
 /*
   _stdtod
   Can't use "strtod" for the name, as a broken version already exists
@@ -161,11 +182,11 @@ char **ptr;
              while (isdigit (p[i]))
                 ++i;
              *ptr = p + i;
-             return _atof (str);
+             return span_atof (str, *ptr);
             }
         }
       *ptr = p;
-      return _atof (str);
+      return span_atof (str, p);
     }
   /* Didn't find any digits.  Doesn't look like a number.  */
   *ptr = str;
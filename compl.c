@@ -0,0 +1,138 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  compl.c
+
+  Completion of identifiers in the line editor. The names are kept in a 
+  prefix tree, one node per character, with the number of names below 
+  each node. Completing a prefix takes one step for each character of 
+  the prefix and of the completion, however many names there are.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "ctype.h"
+#include "compl.h"
+#include "config.h"
+#ifdef LINUX
+#include <string.h>
+#endif
+
+/* Flags for a node that ends a name */
+#define CP_WORD 1
+#define CP_FUNC 2
+
+/* The tree is stored in a fixed array of nodes. Each node links to its
+   first child, and to its next sibling, by index; index 0 is the root, 
+   so it doubles as "no node". */
+typedef struct
+  {
+  char ch;
+  char flags;
+  int kid;
+  int sib;
+  int count; /* Number of names that pass through this node */
+  } cp_node;
+
+static cp_node cp_tree[CP_NODES];
+static int cp_used = 1;
+
+/*===========================================================================
+
+  cp_child
+
+  Find the child of node n for character c, or 0 if there is none.
+
+===========================================================================*/
+static int cp_child (n, c)
+int n;
+int c;
+  {
+  for (n = cp_tree[n].kid; n; n = cp_tree[n].sib)
+    if (cp_tree[n].ch == c) return n;
+  return 0;
+  }
+
+/*===========================================================================
+
+  cp_add
+
+  Names are case-insensitive, and stored in upper case. A name that will
+  not fit in the tree is ignored -- it just can't be completed.
+
+===========================================================================*/
+void cp_add (name, func)
+char *name;
+int func;
+  {
+  int n, k, c, need = 0;
+  char *s;
+
+  /* Check there is room before changing anything */
+  for (n = 0, s = name; *s; s++)
+    {
+    if ((k = cp_child (n, toupper (*s))) == 0)
+      {
+      need = strlen (s);
+      break;
+      }
+    n = k;
+    }
+  /* Nothing to do for an empty name, or one that is there already */
+  if (need == 0 && (n == 0 || (cp_tree[n].flags & CP_WORD))) return;
+  if (cp_used + need > CP_NODES) return;
+
+  for (n = 0, s = name; *s; s++)
+    {
+    c = toupper (*s);
+    k = cp_child (n, c);
+    if (!k)
+      {
+      k = cp_used++;
+      cp_tree[k].ch = c;
+      cp_tree[k].flags = 0;
+      cp_tree[k].kid = 0;
+      cp_tree[k].count = 0;
+      cp_tree[k].sib = cp_tree[n].kid;
+      cp_tree[n].kid = k;
+      }
+    cp_tree[k].count++;
+    n = k;
+    }
+  cp_tree[n].flags = CP_WORD | (func ? CP_FUNC : 0);
+  }
+
+/*===========================================================================
+
+  cp_find
+
+===========================================================================*/
+int cp_find (prefix, len, ext, max)
+char *prefix;
+int len;
+char *ext;
+int max;
+  {
+  int n = 0, i;
+
+  *ext = 0;
+  for (i = 0; i < len; i++)
+    if ((n = cp_child (n, toupper (prefix[i]))) == 0) return 0;
+  if (n == 0) return 0; /* Empty prefix */
+
+  /* Follow the tree while there is only one way to go */
+  i = 0;
+  while (i < max - 2 && !(cp_tree[n].flags & CP_WORD) 
+       && cp_tree[n].kid && cp_tree[cp_tree[n].kid].sib == 0)
+    {
+    n = cp_tree[n].kid;
+    ext[i++] = cp_tree[n].ch;
+    }
+  if (cp_tree[n].count == 1 && (cp_tree[n].flags & CP_FUNC)) 
+    ext[i++] = '(';
+  ext[i] = 0;
+  return cp_tree[n].count;
+  }
@@ -0,0 +1,25 @@
+/*===========================================================================
+
+  compl.h
+
+  Completion of identifiers in the line editor
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __COMPL_H
+#define __COMPL_H
+
+/* Add a name to the set that can be completed. func is non-zero if the
+   name is a function, so that completing it adds a "(". 
+   args: char *name, int func */
+void cp_add ();
+
+/* Find the names that begin with the first len characters of prefix. 
+   Writes the characters that all of them have in common after the 
+   prefix into ext, which has room for max characters including the
+   terminating zero, and returns the number of names found.
+   args: char *prefix, int len, char *ext, int max */
+int cp_find ();
+
+#endif
@@ -8,7 +8,7 @@
 
 ===========================================================================*/
 #ifndef __CONFIG_H
-#define __CONFIG_H_
+#define __CONFIG_H
 
 /* Character sent by terminal for an interrupt (usually ctrl+c) */
 #define I_INTR  3
@@ -22,6 +22,174 @@
 /* Character to send to the terminal get non-destructive backspace */
 #define O_BS 8
 
+/* Sequences that the line editor can use, if the terminal supports them,
+ * to insert or delete a character at the cursor, and a printf() format for
+ * moving the cursor left several places. With these, editing the middle
+ * of a long line needs a few characters of output, rather than a redraw of
+ * the rest of the line. The values here are for ANSI/VT100 terminals; 
+ * leave them undefined for a terminal that only understands O_BS.
+ * Terminals on Linux are all ANSI, more or less.
+ */
+#ifdef LINUX
+#define O_ICH "\033[@"
+#define O_DCH "\033[P"
+#define O_CUB "\033[%dD"
+#else
+/* #define O_ICH "\033[@" */
+/* #define O_DCH "\033[P" */
+/* #define O_CUB "\033[%dD" */
+#endif
+
+/* Bytes of memory for the line editor's history. Lines are stored end to
+ * end, so this many bytes hold about HIST_SIZE / 20 typical expressions;
+ * the oldest are discarded to make room. Search patterns longer than
+ * HIST_PAT characters are ignored. */
+#ifdef LINUX
+#define HIST_SIZE 8192
+#else
+#define HIST_SIZE 512
+#endif
+#define HIST_PAT 32
+
+/* Number of characters that the completion tree (see compl.c) can hold,
+ * counting a prefix shared by several names only once. Each takes 8 bytes
+ * on CP/M. */
+#ifdef LINUX
+#define CP_NODES 16384
+#else
+#define CP_NODES 160
+#endif
+
+/* Size of the console output buffer (see obuf.c). Output is sent when
+ * the buffer fills, and at the end of each line. */
+#define OB_SIZE 128
+
+/* Number of entries in the symbol table, including the 36 built-in 
+ * functions and constants; one is kept free. Each takes 24 bytes on 
+ * CP/M. */
+#ifdef LINUX
+#define SYMTAB_MAX 256
+#else
+#define SYMTAB_MAX 48
+#endif
+
+/* Number of entries in the function result cache (see memo.c). Each
+ * entry takes about 30 bytes on CP/M. */
+#ifdef LINUX
+#define MEMO_SIZE 4096
+#else
+#define MEMO_SIZE 32
+#endif
+
+/* Largest number of expressions (columns) in a TABLE command */
+#define TABLE_COLS 8
+
+/* Largest number of columns that CSV will read from a file, the longest
+ * column heading that can be used as a variable name and, on CP/M, the 
+ * longest line */
+#define CSV_COLS 32
+#define CSV_NAME 32
+#define CSV_LINE 256
+
+/* Largest number of input files for BINARY (Linux only), and the number 
+ * of results it writes at a time */
+#define BIN_VARS 8
+#define BIN_BLOCK 4096
+
+/* Largest number of variables that SWEEP can vary */
+#define SWEEP_VARS 5
+
+/* Number of values that STATS collects before adding them to its totals */
+#ifdef LINUX
+#define STAT_BLOCK 1024
+#else
+#define STAT_BLOCK 32
+#endif
+
+/* Vectors: the number of elements that are computed at a time (every
+ * level of an expression needs a buffer of this many on the stack), the
+ * largest vector that can be made, and the number of elements that are
+ * displayed when a vector is the result of an expression. */
+#ifdef LINUX
+#define VEC_BLOCK 256
+#define VEC_MAX 16000000
+#else
+#define VEC_BLOCK 8
+#define VEC_MAX 2000
+#endif
+#define VEC_SHOW 8
+
+/* How deeply an expression may be nested, counting each operator and
+ * function call. The parser doesn't recurse, but evaluation does, and
+ * each level of evaluating a vector needs a buffer of VEC_BLOCK numbers
+ * on the stack. Long chains like a+b+c+... don't count, being evaluated
+ * a link at a time. On Linux, where a level of a vector takes several
+ * kilobytes, depending on the compiler, the stack that evaluating one
+ * uses is also limited to VEC_STACK bytes, half the usual 8 MB. */
+#ifdef LINUX
+#define EXPR_DEPTH 2000
+#define VEC_STACK 4000000L
+#else
+#define EXPR_DEPTH 64
+#endif
+
+/* The highest power in a polynomial that is evaluated as one (see
+ * ppoly() in tinyexpr.c); the parser needs a few arrays of this many
+ * numbers on the stack. */
+#ifdef LINUX
+#define POLY_DEG 32
+#else
+#define POLY_DEG 10
+#endif
+
+/* With SIGFIG set to n, an expression's SIN, COS, TAN, LOG and LOG10 
+ * need only be good to n + FN_GUARD significant digits, and are worked
+ * out by short polynomials when FN_DIGITS (see funcs.h) is enough; a 
+ * result that comes within 10^-(n+2), relatively, of changing the 
+ * digits shown is then worked out again in full. */
+#define FN_GUARD 4
+
+/* The most significant digits that SIGFIG can ask for in DD mode */
+#define DD_SIGFIG 31
+
+/* The largest denominator that a number worked out in floating point, 
+ * like a variable set outside FRAC mode, is taken to be a fraction with.
+ * Its square must be well short of the precision of a double. */
+#define FRAC_QMAX 100000L
+
+/* The fraction bits of a number in FIXED mode, unless FIXED is given 
+ * another number: 16.16 on CP/M, in a long, and 32.32 on Linux, which 
+ * can also be set to 16 to check the accuracy of the CP/M version. */
+#ifdef LINUX
+#define FIX_BITS 32
+#else
+#define FIX_BITS 16
+#endif
+
+/* In BIG mode, the most decimal digits a result may have, and the size,
+ * in limbs of nine digits, above which numbers are multiplied by
+ * Karatsuba's method rather than digit by digit */
+#define BIG_DIGITS 10000000L
+#define BIG_KARA 40
+
+/* The most parameters that a function written by CODE can have */
+#define CODE_ARGS 8
+
+/* Accuracy of INTEGRATE, relative to the size of the result, and the 
+ * number of times it may halve the interval. Each level of halving takes
+ * about 100 bytes of stack, and on CP/M there isn't much. */
+#define INTEG_EPS 1e-10
+#ifdef LINUX
+#define INTEG_DEPTH 40
+#else
+#define INTEG_DEPTH 16
+#endif
+
+/* Accuracy of SOLVE, relative to the size of the result, and the number
+ * of attempts it may make before giving up */
+#define SOLVE_EPS 1e-10
+#define SOLVE_ITER 100
+
 #endif
 
 
@@ -0,0 +1,955 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  dd.c
+
+  Double-double arithmetic, for DD mode. A number is the unevaluated sum
+  of two doubles, hi + lo, which gives a 106-bit mantissa -- about 32
+  significant digits -- at a small multiple of the cost of a double. The
+  sums and products are built on the exact transformations of Knuth and
+  Dekker, and the functions follow the QD library of Hida, Li and Bailey:
+  Taylor series after the argument is reduced, and a Newton step from
+  the C library's result where the inverse is easier to work out.
+
+  This relies on IEEE doubles rounded to nearest, with no extra precision
+  in intermediate results, so it is only built on Linux (on x86-64,
+  where doubles are done in SSE registers). The Aztec C library has
+  neither.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "math.h"
+#include "setjmp.h"
+#include "tinyexpr.h"
+#include "funcs.h"
+#include "dd.h"
+
+#ifdef LINUX
+
+#include <string.h>
+
+extern jmp_buf err_jump;
+
+int dd_mode = 0;
+
+/* 2^27 + 1, for splitting a double into two halves of 26 bits */
+#define SPLITTER 134217729.0
+#define SPLIT_MAX 6.69692879491417e+299
+
+/* A term of a series smaller than this, relative to the sum, makes no
+   difference to it */
+#define DD_EPS 1e-33
+
+static dd_real dd_pi = {3.14159265358979311600e+00, 1.22464679914735320717e-16};
+static dd_real dd_2pi = {6.28318530717958623200e+00, 2.44929359829470641435e-16};
+static dd_real dd_pio2 = {1.57079632679489655800e+00, 6.12323399573676603587e-17};
+static dd_real dd_d2r = {1.74532925199432954744e-02, 2.94865227087016868684e-19};
+static dd_real dd_ln2 = {6.93147180559945286227e-01, 2.31904681384629955842e-17};
+static dd_real dd_ln10 = {2.30258509299404590109e+00, -2.17075622338224935076e-16};
+static dd_real dd_one = {1.0, 0.0};
+
+/*
+  two_sum -- r = a + b exactly
+*/
+static void two_sum (a, b, r)
+double a;
+double b;
+dd_real *r;
+  {
+  double s = a + b;
+  double bb = s - a;
+  r->lo = (a - (s - bb)) + (b - bb);
+  r->hi = s;
+  }
+
+/*
+  fast_sum -- r = a + b exactly, if |a| >= |b|
+*/
+static void fast_sum (a, b, r)
+double a;
+double b;
+dd_real *r;
+  {
+  double s = a + b;
+  r->lo = b - (s - a);
+  r->hi = s;
+  }
+
+/*
+  split -- a = r->hi + r->lo, each with no more than 26 bits. Numbers
+  so large that multiplying by SPLITTER would overflow are scaled down
+  by 2^28 first
+*/
+static void split (a, r)
+double a;
+dd_real *r;
+  {
+  double t;
+  if (a > SPLIT_MAX || a < -SPLIT_MAX)
+    {
+    a = ldexp (a, -28);
+    t = SPLITTER * a;
+    r->hi = t - (t - a);
+    r->lo = a - r->hi;
+    r->hi = ldexp (r->hi, 28);
+    r->lo = ldexp (r->lo, 28);
+    return;
+    }
+  t = SPLITTER * a;
+  r->hi = t - (t - a);
+  r->lo = a - r->hi;
+  }
+
+/*
+  two_prod -- r = a * b exactly
+*/
+static void two_prod (a, b, r)
+double a;
+double b;
+dd_real *r;
+  {
+  double p = a * b;
+  dd_real x, y;
+  split (a, &x);
+  split (b, &y);
+  r->lo = ((x.hi * y.hi - p) + x.hi * y.lo + x.lo * y.hi) + x.lo * y.lo;
+  r->hi = p;
+  }
+
+void dd_add (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real s, t;
+  two_sum (a->hi, b->hi, &s);
+  if (s.hi - s.hi != 0)
+    {
+    r->hi = s.hi;
+    r->lo = 0.0;
+    return;
+    }
+  two_sum (a->lo, b->lo, &t);
+  s.lo += t.hi;
+  fast_sum (s.hi, s.lo, &s);
+  s.lo += t.lo;
+  fast_sum (s.hi, s.lo, r);
+  }
+
+void dd_sub (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real nb;
+  nb.hi = -b->hi;
+  nb.lo = -b->lo;
+  dd_add (a, &nb, r);
+  }
+
+void dd_mul (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real p;
+  two_prod (a->hi, b->hi, &p);
+  if (p.hi - p.hi != 0)
+    {
+    r->hi = p.hi;
+    r->lo = 0.0;
+    return;
+    }
+  p.lo += a->hi * b->lo + a->lo * b->hi;
+  fast_sum (p.hi, p.lo, r);
+  }
+
+/*
+  Long division: each quotient digit is worked out in double, and its
+  product with b taken off the remainder exactly
+*/
+void dd_div (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real rem, p, q;
+  double q1, q2, q3;
+  q1 = a->hi / b->hi;
+  if (q1 - q1 != 0)
+    {
+    r->hi = q1;
+    r->lo = 0.0;
+    return;
+    }
+  p.hi = q1; p.lo = 0.0;
+  dd_mul (&p, b, &p);
+  dd_sub (a, &p, &rem);
+  q2 = rem.hi / b->hi;
+  p.hi = q2; p.lo = 0.0;
+  dd_mul (&p, b, &p);
+  dd_sub (&rem, &p, &rem);
+  q3 = rem.hi / b->hi;
+  fast_sum (q1, q2, &q);
+  p.hi = q3; p.lo = 0.0;
+  dd_add (&q, &p, r);
+  }
+
+/*
+  dd_dbl -- r = a * x, for a double x
+*/
+static void dd_dbl (a, x, r)
+dd_real *a;
+double x;
+dd_real *r;
+  {
+  dd_real b;
+  b.hi = x;
+  b.lo = 0.0;
+  dd_mul (a, &b, r);
+  }
+
+/*
+  dd_ldexp -- r = a * 2^k, which is exact
+*/
+static void dd_ldexp (a, k, r)
+dd_real *a;
+int k;
+dd_real *r;
+  {
+  r->hi = ldexp (a->hi, k);
+  r->lo = ldexp (a->lo, k);
+  }
+
+static void dd_neg (a, r)
+dd_real *a;
+dd_real *r;
+  {
+  r->hi = -a->hi;
+  r->lo = -a->lo;
+  }
+
+/*
+  dd_ipow -- r = a^k, by repeated squaring
+*/
+static void dd_ipow (a, k, r)
+dd_real *a;
+long k;
+dd_real *r;
+  {
+  dd_real s, p;
+  long n = k < 0 ? -k : k;
+  s = *a;
+  p = dd_one;
+  while (n)
+    {
+    if (n & 1) dd_mul (&p, &s, &p);
+    n >>= 1;
+    if (n) dd_mul (&s, &s, &s);
+    }
+  if (k < 0) dd_div (&dd_one, &p, &p);
+  *r = p;
+  }
+
+static void dd_floor (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  double hi = floor (a->hi), lo = 0.0;
+  (void)b;
+  if (hi == a->hi) lo = floor (a->lo);
+  fast_sum (hi, lo, r);
+  }
+
+static void dd_ceil (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  double hi = ceil (a->hi), lo = 0.0;
+  (void)b;
+  if (hi == a->hi) lo = ceil (a->lo);
+  fast_sum (hi, lo, r);
+  }
+
+static void dd_abs (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  (void)b;
+  if (a->hi < 0) dd_neg (a, r); else *r = *a;
+  }
+
+void dd_mod (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real q;
+  if (b->hi == 0)
+    {
+    r->hi = fmod (a->hi, 0.0);
+    r->lo = 0.0;
+    return;
+    }
+  dd_div (a, b, &q);
+  if (q.hi < 0) dd_ceil (&q, 0, &q); else dd_floor (&q, 0, &q);
+  dd_mul (&q, b, &q);
+  dd_sub (a, &q, r);
+  }
+
+static void dd_sqrt (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real sq, d;
+  double x, ax;
+  (void)b;
+  if (a->hi < 0) longjmp (err_jump, E_NEGSQRT);
+  if (a->hi == 0 || a->hi - a->hi != 0)
+    {
+    r->hi = sqrt (a->hi);
+    r->lo = 0.0;
+    return;
+    }
+  x = 1.0 / sqrt (a->hi);
+  ax = a->hi * x;
+  two_prod (ax, ax, &sq);
+  dd_sub (a, &sq, &d);
+  two_sum (ax, d.hi * (x * 0.5), r);
+  }
+
+/*
+  e^a = 2^k e^r, where r = a - k log 2 is less than log 2 / 2; r is
+  divided by 512 for the series, and the result squared nine times
+*/
+static void dd_exp (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real x, s, t, p;
+  double k;
+  int i;
+  (void)b;
+  if (a->hi > 709.8 || a->hi < -745.2 || a->hi - a->hi != 0)
+    {
+    r->hi = exp (a->hi);
+    r->lo = 0.0;
+    return;
+    }
+  k = floor (a->hi / dd_ln2.hi + 0.5);
+  dd_dbl (&dd_ln2, k, &p);
+  dd_sub (a, &p, &x);
+  dd_ldexp (&x, -9, &x);
+  /* s = e^x - 1 */
+  s = x;
+  t = x;
+  for (i = 2; ; i++)
+    {
+    dd_mul (&t, &x, &t);
+    p.hi = i; p.lo = 0.0;
+    dd_div (&t, &p, &t);
+    dd_add (&s, &t, &s);
+    if (fabs (t.hi) <= DD_EPS * fabs (s.hi)) break;
+    }
+  /* e^2x - 1 = (e^x - 1)(e^x - 1 + 2) */
+  t.hi = 2.0;
+  t.lo = 0.0;
+  for (i = 0; i < 9; i++)
+    {
+    dd_add (&s, &t, &p);
+    dd_mul (&s, &p, &s);
+    }
+  dd_add (&s, &dd_one, &s);
+  dd_ldexp (&s, (int)k, r);
+  }
+
+/*
+  One Newton step from the C library's log: x + a e^-x - 1
+*/
+static void dd_log (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real x, t;
+  (void)b;
+  if (a->hi < 0) longjmp (err_jump, E_NEGLOG);
+  if (a->hi == 0 || a->hi - a->hi != 0)
+    {
+    r->hi = log (a->hi);
+    r->lo = 0.0;
+    return;
+    }
+  x.hi = log (a->hi);
+  x.lo = 0.0;
+  dd_neg (&x, &t);
+  dd_exp (&t, 0, &t);
+  dd_mul (a, &t, &t);
+  dd_sub (&t, &dd_one, &t);
+  dd_add (&x, &t, r);
+  }
+
+static void dd_log10 (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_log (a, b, r);
+  dd_div (r, &dd_ln10, r);
+  }
+
+/*
+  dd_sc -- sin and cos of a in radians. a is reduced to r within pi/4
+  of a multiple of pi/2, and the series for both worked out for r
+*/
+static void dd_sc (a, s, c)
+dd_real *a;
+dd_real *s;
+dd_real *c;
+  {
+  dd_real x, r2, t, p, ss, cc;
+  double z;
+  int i, j;
+  if (a->hi - a->hi != 0)
+    {
+    s->hi = c->hi = a->hi - a->hi;
+    s->lo = c->lo = 0.0;
+    return;
+    }
+  z = floor (a->hi / dd_2pi.hi + 0.5);
+  dd_dbl (&dd_2pi, z, &p);
+  dd_sub (a, &p, &x);
+  z = floor (x.hi / dd_pio2.hi + 0.5);
+  dd_dbl (&dd_pio2, z, &p);
+  dd_sub (&x, &p, &x);
+  j = ((int)z + 4) & 3;
+
+  dd_mul (&x, &x, &r2);
+  ss = x;
+  t = x;
+  for (i = 3; ; i += 2)
+    {
+    dd_mul (&t, &r2, &t);
+    p.hi = -(double)i * (i - 1); p.lo = 0.0;
+    dd_div (&t, &p, &t);
+    dd_add (&ss, &t, &ss);
+    if (fabs (t.hi) <= DD_EPS * fabs (ss.hi)) break;
+    }
+  cc = dd_one;
+  t = dd_one;
+  for (i = 2; ; i += 2)
+    {
+    dd_mul (&t, &r2, &t);
+    p.hi = -(double)i * (i - 1); p.lo = 0.0;
+    dd_div (&t, &p, &t);
+    dd_add (&cc, &t, &cc);
+    if (fabs (t.hi) <= DD_EPS) break;
+    }
+
+  if (j == 0) { *s = ss; *c = cc; }
+  else if (j == 1) { *s = cc; dd_neg (&ss, c); }
+  else if (j == 2) { dd_neg (&ss, s); dd_neg (&cc, c); }
+  else { dd_neg (&cc, s); *c = ss; }
+  }
+
+/*
+  rad -- an angle in the current angle mode, in radians
+*/
+static void rad (a, r)
+dd_real *a;
+dd_real *r;
+  {
+  if (angle_mode == AM_DEG) dd_mul (a, &dd_d2r, r); else *r = *a;
+  }
+
+/*
+  unrad -- an angle in radians, in the current angle mode
+*/
+static void unrad (a, r)
+dd_real *a;
+dd_real *r;
+  {
+  if (angle_mode == AM_DEG) dd_div (a, &dd_d2r, r); else *r = *a;
+  }
+
+static void dd_sin (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real x, c;
+  (void)b;
+  rad (a, &x);
+  dd_sc (&x, r, &c);
+  }
+
+static void dd_cos (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real x, s;
+  (void)b;
+  rad (a, &x);
+  dd_sc (&x, &s, r);
+  }
+
+static void dd_tan (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real x, s, c;
+  (void)b;
+  rad (a, &x);
+  dd_sc (&x, &s, &c);
+  dd_div (&s, &c, r);
+  }
+
+/*
+  atn -- atan in radians. Arguments larger than 1 use
+  atan(a) = pi/2 - atan(1/a); the rest get one Newton step from the
+  C library's atan: x + cos x (a cos x - sin x)
+*/
+static void atn (a, r)
+dd_real *a;
+dd_real *r;
+  {
+  dd_real x, s, c, t;
+  if (a->hi == 0 || a->hi - a->hi != 0)
+    {
+    r->hi = atan (a->hi);
+    r->lo = 0.0;
+    return;
+    }
+  if (fabs (a->hi) > 1.0)
+    {
+    dd_div (&dd_one, a, &t);
+    atn (&t, &t);
+    if (a->hi > 0) dd_sub (&dd_pio2, &t, r);
+    else
+      {
+      dd_neg (&dd_pio2, &x);
+      dd_sub (&x, &t, r);
+      }
+    return;
+    }
+  x.hi = atan (a->hi);
+  x.lo = 0.0;
+  dd_sc (&x, &s, &c);
+  dd_mul (a, &c, &t);
+  dd_sub (&t, &s, &t);
+  dd_mul (&c, &t, &t);
+  dd_add (&x, &t, r);
+  }
+
+static void dd_atan (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  (void)b;
+  atn (a, r);
+  unrad (r, r);
+  }
+
+/*
+  As _atan2() does, this takes a zero x to be division by zero
+*/
+static void dd_atan2 (y, x, r)
+dd_real *y;
+dd_real *x;
+dd_real *r;
+  {
+  dd_real t;
+  if (x->hi == 0) longjmp (err_jump, E_DIVZ);
+  dd_div (y, x, &t);
+  atn (&t, &t);
+  if (x->hi < 0)
+    {
+    if (y->hi >= 0) dd_add (&t, &dd_pi, &t);
+    else dd_sub (&t, &dd_pi, &t);
+    }
+  unrad (&t, r);
+  }
+
+/*
+  asin a = atan (a / sqrt ((1 - a)(1 + a)))
+*/
+static void dd_asin (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real p, q;
+  (void)b;
+  if (a->hi < -1 || a->hi > 1) longjmp (err_jump, E_TRGRNG);
+  dd_sub (&dd_one, a, &p);
+  dd_add (&dd_one, a, &q);
+  if (p.hi == 0 || q.hi == 0)
+    {
+    if (a->hi > 0) *r = dd_pio2; else dd_neg (&dd_pio2, r);
+    }
+  else
+    {
+    dd_mul (&p, &q, &p);
+    dd_sqrt (&p, 0, &p);
+    dd_div (a, &p, &p);
+    atn (&p, r);
+    }
+  unrad (r, r);
+  }
+
+/*
+  acos a = 2 atan (sqrt ((1 - a) / (1 + a)))
+*/
+static void dd_acos (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real p, q;
+  (void)b;
+  if (a->hi < -1 || a->hi > 1) longjmp (err_jump, E_TRGRNG);
+  dd_sub (&dd_one, a, &p);
+  dd_add (&dd_one, a, &q);
+  if (q.hi == 0)
+    *r = dd_pi;
+  else
+    {
+    dd_div (&p, &q, &p);
+    dd_sqrt (&p, 0, &p);
+    atn (&p, &p);
+    dd_ldexp (&p, 1, r);
+    }
+  unrad (r, r);
+  }
+
+/*
+  shc -- sinh and cosh. Small arguments use the series for sinh, which
+  would otherwise be lost in e^a - e^-a
+*/
+static void shc (a, s, c)
+dd_real *a;
+dd_real *s;
+dd_real *c;
+  {
+  dd_real e, ie, t, r2, p;
+  int i;
+  if (fabs (a->hi) < 0.5)
+    {
+    dd_mul (a, a, &r2);
+    *s = *a;
+    t = *a;
+    for (i = 3; ; i += 2)
+      {
+      dd_mul (&t, &r2, &t);
+      p.hi = (double)i * (i - 1); p.lo = 0.0;
+      dd_div (&t, &p, &t);
+      dd_add (s, &t, s);
+      if (fabs (t.hi) <= DD_EPS * fabs (s->hi)) break;
+      }
+    dd_mul (s, s, &t);
+    dd_add (&t, &dd_one, &t);
+    dd_sqrt (&t, 0, c);
+    return;
+    }
+  dd_exp (a, 0, &e);
+  dd_div (&dd_one, &e, &ie);
+  dd_sub (&e, &ie, &t);
+  dd_ldexp (&t, -1, s);
+  dd_add (&e, &ie, &t);
+  dd_ldexp (&t, -1, c);
+  }
+
+static void dd_sinh (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real c;
+  (void)b;
+  shc (a, r, &c);
+  }
+
+static void dd_cosh (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real s;
+  (void)b;
+  shc (a, &s, r);
+  }
+
+static void dd_tanh (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real s, c;
+  (void)b;
+  if (fabs (a->hi) > 40.0)
+    {
+    r->hi = a->hi > 0 ? 1.0 : -1.0;
+    r->lo = 0.0;
+    return;
+    }
+  shc (a, &s, &c);
+  dd_div (&s, &c, r);
+  }
+
+/*
+  Whole powers are worked out by repeated squaring, which is exact as far
+  as double-double goes; others as e^(b log a), with the C library's
+  results for the cases that has no logarithm for
+*/
+static void dd_pow (a, b, r)
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  dd_real t;
+  if (b->lo == 0 && b->hi == floor (b->hi) && fabs (b->hi) < 1e9)
+    {
+    dd_ipow (a, (long)b->hi, r);
+    return;
+    }
+  if (a->hi <= 0 || a->hi - a->hi != 0)
+    {
+    r->hi = _pow (a->hi, b->hi);
+    r->lo = 0.0;
+    return;
+    }
+  dd_log (a, 0, &t);
+  dd_mul (&t, b, &t);
+  dd_exp (&t, 0, r);
+  }
+
+/* The functions that have double-double versions */
+static struct
+  {
+  double (*f)();
+  dd_fun k;
+  } dd_kerns[] =
+  {
+  {fabs, dd_abs}, {_acos, dd_acos}, {_asin, dd_asin}, {_atan, dd_atan},
+  {_atan2, dd_atan2}, {ceil, dd_ceil}, {_cos, dd_cos}, {cosh, dd_cosh},
+  {exp, dd_exp}, {floor, dd_floor}, {_log, dd_log}, {_log10, dd_log10},
+  {_pow, dd_pow}, {_sin, dd_sin}, {sinh, dd_sinh}, {_sqrt, dd_sqrt},
+  {_tan, dd_tan}, {tanh, dd_tanh}, {0, 0}
+  };
+
+dd_fun dd_kern (f)
+void *f;
+  {
+  int i;
+  for (i = 0; dd_kerns[i].f; i++)
+    if ((void *)dd_kerns[i].f == f) return dd_kerns[i].k;
+  return 0;
+  }
+
+/*
+  The digits are added up exactly (as far as the first 32 or so go), and
+  the result scaled by the power of ten
+*/
+void dd_atof (s, end, r)
+char *s;
+char *end;
+dd_real *r;
+  {
+  dd_real m, t;
+  int e = 0, nd = 0, point = 0, neg = 0, x;
+  m.hi = m.lo = 0.0;
+  for (; s < end; s++)
+    {
+    if (*s == '.') point = 1;
+    else if (*s >= '0' && *s <= '9')
+      {
+      if (nd < 36)
+        {
+        dd_dbl (&m, 10.0, &m);
+        t.hi = *s - '0'; t.lo = 0.0;
+        dd_add (&m, &t, &m);
+        if (m.hi != 0) nd++;
+        if (point) e--;
+        }
+      else if (!point)
+        e++;
+      }
+    else
+      break;
+    }
+  if (s < end && (*s == 'e' || *s == 'E'))
+    {
+    s++;
+    if (*s == '-') neg = 1;
+    if (*s == '-' || *s == '+') s++;
+    for (x = 0; s < end && *s >= '0' && *s <= '9'; s++)
+      if (x < 10000) x = x * 10 + *s - '0';
+    e += neg ? -x : x;
+    }
+  if (e == 0 || m.hi == 0)
+    {
+    *r = m;
+    return;
+    }
+  t.hi = 10.0; t.lo = 0.0;
+  if (e > 0)
+    {
+    dd_ipow (&t, (long)e, &t);
+    dd_mul (&m, &t, r);
+    }
+  else
+    {
+    /* Dividing by 10^n is more accurate than multiplying by 10^-n, but
+       10^n overflows first */
+    if (e < -300)
+      {
+      dd_ipow (&t, (long)(-e - 300), &t);
+      dd_div (&m, &t, &m);
+      t.hi = 10.0;
+      e = -300;
+      }
+    dd_ipow (&t, (long)-e, &t);
+    dd_div (&m, &t, r);
+    }
+  }
+
+/*
+  The digits are taken off one at a time after the number is scaled
+  to between 1 and 10, and the last one rounded
+*/
+void dd_fmt (a, sig, buff)
+dd_real *a;
+int sig;
+char *buff;
+  {
+  char dig[48];
+  dd_real x, t;
+  int e, i, d;
+  char *p = buff;
+
+  if (a->hi == 0)
+    {
+    strcpy (buff, "0");
+    return;
+    }
+  if (a->hi - a->hi != 0)
+    {
+    sprintf (buff, "%*.*g", sig, sig, a->hi);
+    return;
+    }
+  if (sig > 40) sig = 40;
+  x = *a;
+  if (x.hi < 0)
+    {
+    *p++ = '-';
+    dd_neg (&x, &x);
+    }
+  e = (int)floor (log10 (x.hi));
+  t.hi = 10.0; t.lo = 0.0;
+  if (e > 300)
+    {
+    /* Scaled down, so that the division can't overflow */
+    dd_ipow (&t, (long)e, &t);
+    dd_ldexp (&t, -64, &t);
+    dd_ldexp (&x, -64, &x);
+    dd_div (&x, &t, &x);
+    }
+  else if (e < -300)
+    {
+    dd_ipow (&t, (long)(-e - 20), &t);
+    dd_mul (&x, &t, &x);
+    t.hi = 1e20;
+    t.lo = 0.0;
+    dd_mul (&x, &t, &x);
+    }
+  else if (e)
+    {
+    dd_ipow (&t, (long)e, &t);
+    dd_div (&x, &t, &x);
+    }
+  if (x.hi >= 10.0)
+    {
+    t.hi = 10.0; t.lo = 0.0;
+    dd_div (&x, &t, &x);
+    e++;
+    }
+  else if (x.hi < 1.0)
+    {
+    dd_dbl (&x, 10.0, &x);
+    e--;
+    }
+
+  for (i = 0; i <= sig; i++)
+    {
+    d = (int)x.hi;
+    t.hi = d; t.lo = 0.0;
+    dd_sub (&x, &t, &x);
+    if (x.hi < 0)
+      {
+      d--;
+      dd_add (&x, &dd_one, &x);
+      }
+    if (d > 9) d = 9;
+    if (d < 0) d = 0;
+    dig[i] = d;
+    dd_dbl (&x, 10.0, &x);
+    }
+  if (dig[sig] >= 5)
+    {
+    for (i = sig - 1; i >= 0 && dig[i] == 9; i--) dig[i] = 0;
+    if (i >= 0)
+      dig[i]++;
+    else
+      {
+      dig[0] = 1;
+      e++;
+      }
+    }
+
+  if (e < -4 || e >= sig)
+    {
+    *p++ = '0' + dig[0];
+    if (sig > 1) *p++ = '.';
+    for (i = 1; i < sig; i++) *p++ = '0' + dig[i];
+    sprintf (p, "e%c%02d", e < 0 ? '-' : '+', e < 0 ? -e : e);
+    }
+  else if (e >= 0)
+    {
+    for (i = 0; i < sig; i++)
+      {
+      *p++ = '0' + dig[i];
+      if (i == e && i < sig - 1) *p++ = '.';
+      }
+    *p = 0;
+    }
+  else
+    {
+    *p++ = '0';
+    *p++ = '.';
+    for (i = -1; i > e; i--) *p++ = '0';
+    for (i = 0; i < sig; i++) *p++ = '0' + dig[i];
+    *p = 0;
+    }
+
+  /* Pad to the width, as %*.*g does */
+  d = strlen (buff);
+  if (d < sig)
+    {
+    memmove (buff + sig - d, buff, d + 1);
+    memset (buff, ' ', sig - d);
+    }
+  }
+
+#endif
@@ -0,0 +1,63 @@
+/*===========================================================================
+
+  dd.h
+
+  Double-double arithmetic, for DD mode (Linux only): a number is held as
+  the unevaluated sum of two doubles, giving about 32 significant digits.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __DD_H
+#define __DD_H
+
+#ifdef LINUX
+
+/* A number hi + lo, where lo is no more than half a unit in the last
+   place of hi */
+typedef struct dd_real
+  {
+  double hi;
+  double lo;
+  } dd_real;
+
+/* A function of one or two double-double arguments (the second is
+   ignored by functions of one). args: dd_real *a, dd_real *b,
+   dd_real *r -- r may be the same as a or b */
+typedef void (*dd_fun)();
+
+/* What PI and E need adding to their double values */
+#define DD_PI_LO 1.22464679914735320717e-16
+#define DD_E_LO 1.44564689172925015783e-16
+
+/* Non-zero if expressions are evaluated in double-double arithmetic */
+extern int dd_mode;
+
+/* r = a + b, a - b, a * b, a / b. args: dd_real *a, dd_real *b,
+   dd_real *r. r may be the same as a or b. dd_div does not check for
+   division by zero */
+void dd_add ();
+void dd_sub ();
+void dd_mul ();
+void dd_div ();
+
+/* r = a - trunc (a / b) * b, as fmod() does. args as for dd_add() */
+void dd_mod ();
+
+/* Find the double-double version of one of kcalc's functions, like
+   _sin or _pow. args: void *f. ret: the function, or 0 if there isn't
+   one */
+dd_fun dd_kern ();
+
+/* Convert the decimal number from s up to end, which _strtod() has
+   already accepted. args: char *s, char *end, dd_real *r */
+void dd_atof ();
+
+/* Format a number to sig significant digits, as printf's %*.*g does.
+   args: dd_real *a, int sig, char *buff -- at least sig + 16
+   characters */
+void dd_fmt ();
+
+#endif
+
+#endif
@@ -0,0 +1,950 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  fix.c
+
+  Fixed point, for FIXED mode. A number is a te_int counting units of
+  2^-fix_bits: 16.16 on CP/M and 32.32 on Linux, unless FIXED is given
+  another number of fraction bits. Addition is integer addition, and
+  multiplication and division need one double-length integer product or
+  quotient, which the Z80 does much faster than a floating-point one.
+
+  The functions are worked out by CORDIC and its relatives, which need
+  only shifts, additions and a table of constants: SIN and COS by
+  rotating a vector, ATAN and its kin by rotating one back to the axis,
+  LOG by multiplying by factors of 1 + 2^-i until the result reaches 2,
+  EXP by the reverse, and SQRT digit by digit. They work with FIX_G
+  fraction bits (EXP with FIX_E), and each takes fix_bits + 4 steps, so
+  that the result is good to the last bit or so. The tables are made from the C
+  library's functions when the number of fraction bits is set.
+
+  Overflow is an error, E_FIXBIG, rather than wrapping around, as it
+  does in INT mode.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "math.h"
+#include "setjmp.h"
+#include "tinyexpr.h"
+#include "funcs.h"
+#include "config.h"
+#include "fix.h"
+#ifdef LINUX
+#include <string.h>
+#endif
+
+extern jmp_buf err_jump;
+
+int fix_mode = 0;
+int fix_bits = FIX_BITS;
+
+#ifdef LINUX
+long fix_nadd = 0;
+long fix_nmul = 0;
+long fix_ndiv = 0;
+#define NADD(k) fix_nadd += (k)
+#define NMUL fix_nmul++
+#define NDIV fix_ndiv++
+#else
+#define NADD(k)
+#define NMUL
+#define NDIV
+#endif
+
+/* Half a te_int, for double-length products */
+#define HALF (TE_IBITS / 2)
+#define LOW(x) ((x) & (((te_uint)1 << HALF) - 1))
+
+/* One, with fix_bits, FIX_G and FIX_E fraction bits */
+#define ONE ((te_int)1 << fix_bits)
+#define GONE ((te_int)1 << FIX_G)
+#define EONE ((te_int)1 << FIX_E)
+
+/* x times 2^s, where that is known to fit: shifting a negative te_int 
+   left is undefined in C, so the bits are shifted unsigned */
+#define SHL(x, s) ((te_int)((te_uint)(x) << (s)))
+
+/* 2/PI and 256/360, with all TE_IBITS bits as a fraction: the number of
+   quarter turns in a radian, and of 1/256 turns in a degree */
+#ifdef LINUX
+#define TURN_R 0xa2f9836e4e44152aULL
+#define TURN_D 0xb60b60b60b60b60bULL
+#else
+#define TURN_R ((te_uint)0xa2f9836eL)
+#define TURN_D ((te_uint)0xb60b60b6L)
+#endif
+
+/* atan (2^-i), and ln (1 + 2^-i) (so lnt[0] is ln 2), with FIX_G
+   fraction bits, and ln (1 + 2^-i) again with FIX_E */
+static te_int atn[FIX_G + 1];
+static te_int lnt[FIX_G + 1];
+static te_int lne[FIX_E + 1];
+
+/* The reciprocal of the CORDIC gain, PI/2, 1/ln 2, 1/ln 10, and
+   180/PI, with FIX_G fraction bits */
+static te_int kgain;
+static te_int hpi;
+static te_int il2;
+static te_int il10;
+static te_int r2d;
+
+/* 2^fix_bits and 2^-fix_bits, and the steps each function takes */
+static double unit;
+static double ulp;
+static int steps;
+
+/*
+  ovf -- the result is too big
+*/
+static void ovf ()
+  {
+  longjmp (err_jump, E_FIXBIG);
+  }
+
+/*
+  mag -- the magnitude of a, which can be -TE_IMIN
+*/
+static te_uint mag (a)
+te_int a;
+  {
+  return a < 0 ? 0 - (te_uint)a : (te_uint)a;
+  }
+
+/*
+  asr -- a / 2^s, rounded down, whatever the compiler does with >> on a
+  negative number
+*/
+static te_int asr (a, s)
+te_int a;
+int s;
+  {
+  return a < 0 ? ~(te_int)(~(te_uint)a >> s) : (te_int)((te_uint)a >> s);
+  }
+
+/*
+  rsh -- a / 2^s, rounded to nearest, for s >= 0
+*/
+static te_int rsh (a, s)
+te_int a;
+int s;
+  {
+  if (s == 0) return a;
+  if (s >= TE_IBITS) return 0;
+  a = asr (a, s - 1);
+  return asr (a, 1) + (a & 1);
+  }
+
+/*
+  lsh -- a * 2^s, for s >= 0, or E_FIXBIG
+*/
+static te_int lsh (a, s)
+te_int a;
+int s;
+  {
+  te_int t;
+  if (a == 0) return 0;
+  if (s >= TE_IBITS - 1) ovf ();
+  t = asr (a, TE_IBITS - 1 - s);
+  if (t != 0 && t != -1) ovf ();
+  return (te_int)((te_uint)a << s);
+  }
+
+/*
+  umul -- the double-length product of a and b, in *hi and *lo
+*/
+static void umul (a, b, hi, lo)
+te_uint a;
+te_uint b;
+te_uint *hi;
+te_uint *lo;
+  {
+  te_uint al = LOW (a), ah = a >> HALF, bl = LOW (b), bh = b >> HALF;
+  te_uint ll = al * bl, lh = al * bh, hl = ah * bl, mid;
+  mid = (ll >> HALF) + LOW (lh) + LOW (hl);
+  *lo = (mid << HALF) | LOW (ll);
+  *hi = ah * bh + (lh >> HALF) + (hl >> HALF) + (mid >> HALF);
+  }
+
+/*
+  wshr -- the double-length number hi, lo divided by 2^s, for s less
+  than twice TE_IBITS, as far as it fits in a te_uint
+*/
+static te_uint wshr (hi, lo, s)
+te_uint hi;
+te_uint lo;
+int s;
+  {
+  if (s == 0) return lo;
+  if (s >= TE_IBITS) return hi >> (s - TE_IBITS);
+  return (lo >> s) | (hi << (TE_IBITS - s));
+  }
+
+/*
+  wtry -- *p = a * b / 2^s, rounded, returning zero if that overflows.
+  s may be up to twice TE_IBITS, so that numbers with different fraction
+  bits can be multiplied
+*/
+static int wtry (a, b, s, p)
+te_int a;
+te_int b;
+int s;
+te_int *p;
+  {
+  te_uint hi, lo, r;
+  int neg = (a < 0) != (b < 0);
+  NMUL;
+  umul (mag (a), mag (b), &hi, &lo);
+  if (s > TE_IBITS)
+    hi += (te_uint)1 << (s - 1 - TE_IBITS);
+  else if (s > 0)
+    {
+    r = lo + ((te_uint)1 << (s - 1));
+    if (r < lo) hi++;
+    lo = r;
+    }
+  r = wshr (hi, lo, s);
+  if ((s < TE_IBITS && (hi >> s) != 0) || r > (te_uint)TE_IMAX + neg)
+    return 0;
+  *p = neg ? (te_int)(0 - r) : (te_int)r;
+  return 1;
+  }
+
+/*
+  wmul -- a * b / 2^s, rounded, or E_FIXBIG
+*/
+static te_int wmul (a, b, s)
+te_int a;
+te_int b;
+int s;
+  {
+  te_int r;
+  if (!wtry (a, b, s, &r)) ovf ();
+  return r;
+  }
+
+/*
+  wdiv -- a * 2^s / b, rounded, for s less than TE_IBITS, or E_FIXBIG.
+  When a * 2^s fits in a te_uint, the compiler's division does it;
+  otherwise it is done a bit at a time
+*/
+static te_int wdiv (a, b, s)
+te_int a;
+te_int b;
+int s;
+  {
+  te_uint ua = mag (a), ub = mag (b), hi, lo, q, r;
+  int neg = (a < 0) != (b < 0), i;
+  if (b == 0) longjmp (err_jump, E_DIVZ);
+  NDIV;
+  hi = s ? ua >> (TE_IBITS - s) : 0;
+  lo = ua << s;
+  if (hi >= ub) ovf ();
+  if (hi == 0)
+    {
+    q = lo / ub;
+    r = lo - q * ub;
+    }
+  else
+    {
+    q = 0;
+    r = hi;
+    for (i = TE_IBITS - 1; i >= 0; i--)
+      {
+      /* r < ub, which is no more than half the range of a te_uint */
+      r = (r << 1) | ((lo >> i) & 1);
+      q <<= 1;
+      if (r >= ub)
+        {
+        r -= ub;
+        q |= 1;
+        }
+      }
+    }
+  if (q > (te_uint)TE_IMAX) ovf ();
+  if (r >= ub - r) q++;
+  if (q > (te_uint)TE_IMAX + neg) ovf ();
+  return neg ? (te_int)(0 - q) : (te_int)q;
+  }
+
+/*
+  rsqrt -- the square root of a * 2^s, rounded, for a >= 0 and s less
+  than TE_IBITS - 4, worked out two bits of a at a time
+*/
+static te_int rsqrt (a, s)
+te_int a;
+int s;
+  {
+  te_uint hi, lo, r = 0, m = 0, t;
+  int p;
+  NDIV;
+  hi = s ? (te_uint)a >> (TE_IBITS - s) : 0;
+  lo = (te_uint)a << s;
+  for (p = TE_IBITS - 1; p >= 0; p--)
+    {
+    t = 2 * p >= TE_IBITS ? hi >> (2 * p - TE_IBITS) : lo >> (2 * p);
+    m = (m << 2) | (t & 3);
+    t = (r << 2) | 1;
+    r <<= 1;
+    if (m >= t)
+      {
+      m -= t;
+      r |= 1;
+      }
+    }
+  if (m > r) r++;
+  return (te_int)r;
+  }
+
+/*
+  gtof -- a number with FIX_G fraction bits, rounded to fix_bits
+*/
+static te_int gtof (a)
+te_int a;
+  {
+  return rsh (a, FIX_G - fix_bits);
+  }
+
+/*
+  etof -- a * 2^k, where a has FIX_E fraction bits, with fix_bits
+*/
+static te_int etof (a, k)
+te_int a;
+int k;
+  {
+  k += fix_bits - FIX_E;
+  return k >= 0 ? lsh (a, k) : rsh (a, -k);
+  }
+
+/*
+  cordic -- rotate the vector (*x, *y) by the angle *z, or, if vec,
+  rotate it until *y is zero, adding the angle to *z, in n steps. The
+  vector grows by the CORDIC gain
+*/
+static void cordic (x, y, z, vec, n)
+te_int *x;
+te_int *y;
+te_int *z;
+int vec;
+int n;
+  {
+  te_int a = *x, b = *y, c = *z, t;
+  int i;
+  NADD (3 * n);
+  for (i = 0; i < n; i++)
+    {
+    t = a;
+    if (vec ? b < 0 : c >= 0)
+      {
+      a -= asr (b, i);
+      b += asr (t, i);
+      c -= atn[i];
+      }
+    else
+      {
+      a += asr (b, i);
+      b -= asr (t, i);
+      c += atn[i];
+      }
+    }
+  *x = a;
+  *y = b;
+  *z = c;
+  }
+
+/*
+  reduce -- an angle a, in the current angle mode, as a whole number of
+  quarter turns, mod 4, in *q, and the rest, no more than PI/4 either
+  way, in radians with FIX_G fraction bits. Multiplying by the number of
+  quarter turns in the unit, to more bits than a te_int has, keeps the
+  rest exact to the last bit however big a is.
+*/
+static te_int reduce (a, q)
+te_int a;
+int *q;
+  {
+  te_uint hi, lo, u, four = (te_uint)4 << FIX_G;
+  int deg = angle_mode == AM_DEG;
+  NMUL;
+  umul (mag (a), deg ? TURN_D : TURN_R, &hi, &lo);
+  u = wshr (hi, lo, fix_bits + TE_IBITS + (deg ? 6 : 0) - FIX_G);
+  u &= four - 1;
+  if (a < 0) u = (four - u) & (four - 1);
+  *q = (int)((u + (GONE >> 1)) >> FIX_G);
+  u -= (te_uint)*q << FIX_G;
+  *q &= 3;
+  return wmul ((te_int)u, hpi, FIX_G);
+  }
+
+/*
+  sincos -- the sine and cosine of a, with FIX_G fraction bits, from n 
+  CORDIC steps
+*/
+static void sincos (a, s, c, n)
+te_int a;
+te_int *s;
+te_int *c;
+int n;
+  {
+  int q;
+  te_int x = kgain, y = 0, z = reduce (a, &q);
+  cordic (&x, &y, &z, 0, n);
+  if (q == 0)
+    {
+    *s = y;
+    *c = x;
+    }
+  else if (q == 1)
+    {
+    *s = x;
+    *c = -y;
+    }
+  else if (q == 2)
+    {
+    *s = -y;
+    *c = -x;
+    }
+  else
+    {
+    *s = -x;
+    *c = y;
+    }
+  }
+
+/*
+  angle -- the angle of the vector (x, y), as atan2 (y, x) gives it, in
+  radians with FIX_G fraction bits. x and y may have any number of
+  fraction bits, so long as it is the same. The vector is first scaled
+  to a length of about 1
+*/
+static te_int angle (y, x)
+te_int y;
+te_int x;
+  {
+  te_uint m = mag (x) | mag (y);
+  te_int z = 0;
+  int n = 0;
+  if (m == 0) return 0;
+  /* Degrees are about 2^6 times finer than radians */
+  while ((m >> n) > 1) n++;
+  if (n >= FIX_G)
+    {
+    x = asr (x, n - FIX_G + 1);
+    y = asr (y, n - FIX_G + 1);
+    }
+  else
+    {
+    x = SHL (x, FIX_G - 1 - n);
+    y = SHL (y, FIX_G - 1 - n);
+    }
+  if (x < 0)
+    {
+    z = y < 0 ? -2 * hpi : 2 * hpi;
+    x = -x;
+    y = -y;
+    }
+  n = angle_mode == AM_DEG ? steps + 6 : steps;
+  cordic (&x, &y, &z, 1, n > FIX_G ? FIX_G : n);
+  return z;
+  }
+
+/*
+  unang -- an angle in radians, with FIX_G fraction bits, in the current
+  angle mode, with fix_bits
+*/
+static te_int unang (z)
+te_int z;
+  {
+  if (angle_mode == AM_DEG) return wmul (z, r2d, 2 * FIX_G - fix_bits);
+  return gtof (z);
+  }
+
+/*
+  lng -- ln (a), for a > 0, with FIX_G fraction bits, in s steps. a is
+  shifted to between 1 and 2, and multiplied by factors of 1 + 2^-i, 
+  each taken if it leaves the product less than 2; the sum of their 
+  logarithms is then ln (2 / a)
+*/
+static te_int lng (a, s)
+te_int a;
+int s;
+  {
+  te_int m, t, y = 0;
+  int n = 0, i;
+  while (((te_uint)a >> n) > 1) n++;
+  m = n > FIX_G ? asr (a, n - FIX_G) : a << (FIX_G - n);
+  for (i = 1; i <= s; i++)
+    while ((t = m + asr (m, i)) < 2 * GONE)
+      {
+      NADD (2);
+      m = t;
+      y += lnt[i];
+      }
+  return (te_int)(n - fix_bits + 1) * lnt[0] - y;
+  }
+
+/*
+  expg -- e^a, where a has FIX_G fraction bits and is no more than 64
+  either way, as a number from 1 to 2 with FIX_E fraction bits, times
+  2^*k. The remainder of a after taking out multiples of ln 2 has the
+  logarithms of factors of 1 + 2^-i taken from it, each that it is
+  larger than, and the result is their product. A large result needs
+  more steps, as far as FIX_E allows, to be good to its last bit
+*/
+static te_int expg (a, k)
+te_int a;
+int *k;
+  {
+  te_int y = EONE;
+  int i, n;
+  *k = (int)asr (wmul (a, il2, FIX_G), FIX_G);
+  /* The arithmetic wraps around, but the remainder is small */
+  a = (te_int)(((te_uint)a << (FIX_E - FIX_G)) 
+    - (te_uint)*k * (te_uint)lne[0]);
+  if (a < 0)
+    {
+    a += lne[0];
+    --*k;
+    }
+  if (a >= lne[0])
+    {
+    a -= lne[0];
+    ++*k;
+    }
+  n = *k > 0 ? steps + *k : steps;
+  if (n > FIX_E) n = FIX_E;
+  for (i = 1; i <= n; i++)
+    while (a >= lne[i])
+      {
+      NADD (2);
+      a -= lne[i];
+      y += rsh (y, i);
+      }
+  return y;
+  }
+
+/*
+  The functions, with the same errors as funcs.c's
+*/
+static te_int fx_abs (a, b)
+te_int a;
+te_int b;
+  {
+  (void)b;
+  if (a == TE_IMIN) ovf ();
+  return a < 0 ? -a : a;
+  }
+
+static te_int fx_floor (a, b)
+te_int a;
+te_int b;
+  {
+  (void)b;
+  return (te_int)((te_uint)a & ~(te_uint)(ONE - 1));
+  }
+
+static te_int fx_ceil (a, b)
+te_int a;
+te_int b;
+  {
+  return fx_floor (fix_add (a, ONE - 1), b);
+  }
+
+static te_int fx_sqrt (a, b)
+te_int a;
+te_int b;
+  {
+  (void)b;
+  if (a < 0) longjmp (err_jump, E_NEGSQRT);
+  return rsqrt (a, fix_bits);
+  }
+
+static te_int fx_sin (a, b)
+te_int a;
+te_int b;
+  {
+  te_int s, c;
+  (void)b;
+  sincos (a, &s, &c, steps);
+  return gtof (s);
+  }
+
+static te_int fx_cos (a, b)
+te_int a;
+te_int b;
+  {
+  te_int s, c;
+  (void)b;
+  sincos (a, &s, &c, steps);
+  return gtof (c);
+  }
+
+static te_int fx_tan (a, b)
+te_int a;
+te_int b;
+  {
+  te_int s, c;
+  (void)b;
+  /* The error in s / c is that in the angle over c^2, so it needs all
+     the steps there are */
+  sincos (a, &s, &c, FIX_G);
+  if (c == 0) ovf ();
+  return wdiv (s, c, fix_bits);
+  }
+
+static te_int fx_atan (a, b)
+te_int a;
+te_int b;
+  {
+  (void)b;
+  return unang (angle (a, ONE));
+  }
+
+static te_int fx_atan2 (a, b)
+te_int a;
+te_int b;
+  {
+  if (b == 0) longjmp (err_jump, E_DIVZ);
+  return unang (angle (a, b));
+  }
+
+/*
+  asc -- a, for -1 <= a <= 1, and sqrt (1 - a^2), with FIX_G fraction
+  bits, for ASIN and ACOS
+*/
+static void asc (a, s, c)
+te_int a;
+te_int *s;
+te_int *c;
+  {
+  if (a > ONE || a < -ONE) longjmp (err_jump, E_TRGRNG);
+  *s = SHL (a, FIX_G - fix_bits);
+  *c = rsqrt (GONE - wmul (*s, *s, FIX_G), FIX_G);
+  }
+
+static te_int fx_asin (a, b)
+te_int a;
+te_int b;
+  {
+  te_int s, c;
+  (void)b;
+  asc (a, &s, &c);
+  return unang (angle (s, c));
+  }
+
+static te_int fx_acos (a, b)
+te_int a;
+te_int b;
+  {
+  te_int s, c;
+  (void)b;
+  asc (a, &s, &c);
+  return unang (angle (c, s));
+  }
+
+static te_int fx_log (a, b)
+te_int a;
+te_int b;
+  {
+  (void)b;
+  if (a < 0) longjmp (err_jump, E_NEGLOG);
+  if (a == 0) ovf ();
+  return gtof (lng (a, steps));
+  }
+
+static te_int fx_log10 (a, b)
+te_int a;
+te_int b;
+  {
+  (void)b;
+  if (a < 0) longjmp (err_jump, E_NEGLOG);
+  if (a == 0) ovf ();
+  return wmul (lng (a, steps), il10, 2 * FIX_G - fix_bits);
+  }
+
+static te_int fx_exp (a, b)
+te_int a;
+te_int b;
+  {
+  te_int y;
+  int k;
+  (void)b;
+  if (a > 64 * ONE) ovf ();
+  if (a < -64 * ONE) return 0;
+  y = expg (SHL (a, FIX_G - fix_bits), &k);
+  return etof (y, k);
+  }
+
+/*
+  shc -- e^a / 2 and e^-a / 2, for SINH and COSH
+*/
+static void shc (a, p, m)
+te_int a;
+te_int *p;
+te_int *m;
+  {
+  te_int y;
+  int k;
+  if (a > 64 * ONE || a < -64 * ONE) ovf ();
+  a = SHL (a, FIX_G - fix_bits);
+  y = expg (a, &k);
+  *p = etof (y, k - 1);
+  y = expg (-a, &k);
+  *m = etof (y, k - 1);
+  }
+
+static te_int fx_sinh (a, b)
+te_int a;
+te_int b;
+  {
+  te_int p, m;
+  (void)b;
+  shc (a, &p, &m);
+  return fix_sub (p, m);
+  }
+
+static te_int fx_cosh (a, b)
+te_int a;
+te_int b;
+  {
+  te_int p, m;
+  (void)b;
+  shc (a, &p, &m);
+  return fix_add (p, m);
+  }
+
+/*
+  tanh (|a|) is (1 - e^-2|a|) / (1 + e^-2|a|), which can't overflow
+*/
+static te_int fx_tanh (a, b)
+te_int a;
+te_int b;
+  {
+  te_int y;
+  int k;
+  (void)b;
+  if (a > 32 * ONE) return ONE;
+  if (a < -32 * ONE) return -ONE;
+  y = expg (SHL (-2 * fx_abs (a, b), FIX_G - fix_bits), &k);
+  y = rsh (y, 1 - k);
+  y = wdiv ((EONE >> 1) - y, (EONE >> 1) + y, fix_bits);
+  return a < 0 ? -y : y;
+  }
+
+/*
+  ipow -- a^n, by repeated squaring, with bits fraction bits
+*/
+static te_int ipow (a, n, bits)
+te_int a;
+te_uint n;
+int bits;
+  {
+  te_int r = (te_int)1 << bits;
+  for (;;)
+    {
+    if (n & 1) r = wmul (r, a, bits);
+    if ((n >>= 1) == 0) break;
+    a = wmul (a, a, bits);
+    }
+  return r;
+  }
+
+/*
+  Positive whole powers are worked out by repeated squaring, as are 
+  negative ones of numbers larger than 1, if the result isn't so small 
+  as to be zero. Others are worked out as e^(b ln |a|), the sign of a 
+  whole power of a negative number being put back afterwards
+*/
+static te_int fx_pow (a, b)
+te_int a;
+te_int b;
+  {
+  te_int x, r;
+  te_uint n;
+  int k, neg = 0;
+  if ((b & (ONE - 1)) == 0)
+    {
+    n = mag (b) >> fix_bits;
+    if (b >= 0) return ipow (a, n, fix_bits);
+    if (a == 0) longjmp (err_jump, E_DIVZ);
+    if (a <= -ONE || a >= ONE)
+      {
+      if (lng (fx_abs (a, b), steps) > (te_int)(TE_IBITS - 1 - fix_bits)
+          * lnt[0] / (te_int)n)
+        return 0;
+      return wdiv (ONE, ipow (a, n, fix_bits), fix_bits);
+      }
+    neg = a < 0 && (n & 1);
+    a = fx_abs (a, b);
+    }
+  if (a < 0) longjmp (err_jump, E_NEGPOW);
+  if (a == 0)
+    {
+    if (b < 0) longjmp (err_jump, E_DIVZ);
+    return 0;
+    }
+  /* The error in b ln a is the relative error in the result */
+  x = lng (a, FIX_G);
+  if (!wtry (b, x, fix_bits, &r) || r > 64 * GONE || r < -64 * GONE)
+    {
+    if ((b < 0) != (x < 0)) return 0;
+    ovf ();
+    }
+  x = expg (r, &k);
+  r = etof (x, k);
+  return neg ? -r : r;
+  }
+
+/* The functions that have fixed-point versions */
+static struct
+  {
+  double (*f)();
+  fix_fun k;
+  } fix_kerns[] =
+  {
+  {fabs, fx_abs}, {_acos, fx_acos}, {_asin, fx_asin}, {_atan, fx_atan},
+  {_atan2, fx_atan2}, {ceil, fx_ceil}, {_cos, fx_cos}, {cosh, fx_cosh},
+  {exp, fx_exp}, {floor, fx_floor}, {_log, fx_log}, {_log10, fx_log10},
+  {_pow, fx_pow}, {_sin, fx_sin}, {sinh, fx_sinh}, {_sqrt, fx_sqrt},
+  {_tan, fx_tan}, {tanh, fx_tanh}, {0, 0}
+  };
+
+fix_fun fix_kern (f)
+void *f;
+  {
+  int i;
+  for (i = 0; fix_kerns[i].f; i++)
+    if ((void *)fix_kerns[i].f == f) return fix_kerns[i].k;
+  return 0;
+  }
+
+te_int fix_add (a, b)
+te_int a;
+te_int b;
+  {
+  te_int s = (te_int)((te_uint)a + (te_uint)b);
+  NADD (1);
+  if ((a < 0) == (b < 0) && (s < 0) != (a < 0)) ovf ();
+  return s;
+  }
+
+te_int fix_sub (a, b)
+te_int a;
+te_int b;
+  {
+  te_int s = (te_int)((te_uint)a - (te_uint)b);
+  NADD (1);
+  if ((a < 0) != (b < 0) && (s < 0) != (a < 0)) ovf ();
+  return s;
+  }
+
+te_int fix_mul (a, b)
+te_int a;
+te_int b;
+  {
+  return wmul (a, b, fix_bits);
+  }
+
+te_int fix_div (a, b)
+te_int a;
+te_int b;
+  {
+  return wdiv (a, b, fix_bits);
+  }
+
+te_int fix_mod (a, b)
+te_int a;
+te_int b;
+  {
+  if (b == 0) longjmp (err_jump, E_DIVZ);
+  NDIV;
+  /* a % b is a - trunc (a / b) * b, and TE_IMIN % -1 overflows */
+  return b == -1 ? 0 : a % b;
+  }
+
+int fix_of (d, r)
+double d;
+te_int *r;
+  {
+  d *= unit;
+  if (d != d || d >= (double)TE_IMAX || d <= (double)TE_IMIN) return 0;
+  *r = (te_int)floor (d + 0.5);
+  return 1;
+  }
+
+double fix_dbl (a)
+te_int a;
+  {
+  return (double)a * ulp;
+  }
+
+/*
+  gof -- a double with n fraction bits, for the tables
+*/
+static te_int gof (d, n)
+double d;
+int n;
+  {
+  int i;
+  for (i = 0; i < n; i++) d *= 2.0;
+  return (te_int)floor (d + 0.5);
+  }
+
+void fix_set (bits)
+int bits;
+  {
+  double p = 1.0, k = 1.0;
+  int i;
+  fix_bits = bits;
+  steps = bits + 4;
+  unit = 1.0;
+  for (i = 0; i < bits; i++) unit *= 2.0;
+  ulp = 1.0 / unit;
+  for (i = 0; i <= FIX_G; i++)
+    {
+    atn[i] = gof (atan (p), FIX_G);
+    lnt[i] = gof (log (1.0 + p), FIX_G);
+    k /= sqrt (1.0 + p * p);
+    p *= 0.5;
+    }
+  for (i = 0, p = 1.0; i <= FIX_E; i++, p *= 0.5)
+    lne[i] = gof (log (1.0 + p), FIX_E);
+  kgain = gof (k, FIX_G);
+  hpi = gof (CONST_PI / 2.0, FIX_G);
+  il2 = gof (1.0 / log (2.0), FIX_G);
+  il10 = gof (1.0 / log (10.0), FIX_G);
+  r2d = gof (180.0 / CONST_PI, FIX_G);
+  }
+
+void fix_fmt (a, buff)
+te_int a;
+char *buff;
+  {
+  te_uint u = mag (a), one = (te_uint)1 << fix_bits, w, f;
+  char digs[TE_IBITS];
+  int places = (fix_bits * 3 + 9) / 10, i;
+  w = u >> fix_bits;
+  f = u & (one - 1);
+  for (i = 0; i < places; i++)
+    {
+    f *= 10;
+    digs[i] = (char)(f >> fix_bits);
+    f &= one - 1;
+    }
+  if (f >= one - f)
+    {
+    for (i = places - 1; i >= 0 && ++digs[i] == 10; i--) digs[i] = 0;
+    if (i < 0) w++;
+    }
+  while (places > 0 && digs[places - 1] == 0) places--;
+  if (a < 0 && (w || places)) *buff++ = '-';
+  sprintf (buff, TE_IFMT, (te_int)w);
+  buff += strlen (buff);
+  if (places) *buff++ = '.';
+  for (i = 0; i < places; i++) *buff++ = (char)('0' + digs[i]);
+  *buff = 0;
+  }
+
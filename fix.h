@@ -0,0 +1,88 @@
+/*===========================================================================
+
+  fix.h
+
+  Fixed point, for FIXED mode: a number is held as a te_int counting
+  units of 2^-fix_bits, so that arithmetic is done in integers rather
+  than in the software floating point of CP/M. Include tinyexpr.h first,
+  for te_int.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __FIX_H
+#define __FIX_H
+
+/* The fraction bits that functions like SIN are worked out to, before
+   being rounded to fix_bits; there are always enough whole-number bits
+   left for 64 in magnitude. On Linux, the tables they use are made from
+   doubles, so can't have more bits than a double. */
+#ifdef LINUX
+#define FIX_G 52
+#else
+#define FIX_G (TE_IBITS - 8)
+#endif
+
+/* The fraction bits that EXP works to, as a number from 1 to 2 times a
+   power of 2: more than FIX_G, where there is room for them, so that a
+   large result is good to more places */
+#ifdef LINUX
+#define FIX_E 52
+#else
+#define FIX_E (TE_IBITS - 2)
+#endif
+
+/* The fewest and most fraction bits that FIXED can be given */
+#define FIX_MINB 4
+#define FIX_MAXB (FIX_G - 4)
+
+/* A function of one or two fixed-point arguments (the second is ignored
+   by functions of one). args: te_int a, te_int b. ret: the result */
+typedef te_int (*fix_fun)();
+
+/* Non-zero if expressions are evaluated in fixed point, and the number
+   of fraction bits they have */
+extern int fix_mode;
+extern int fix_bits;
+
+#ifdef LINUX
+/* The additions (and subtractions and shifts), multiplications and
+   divisions done since they were last cleared -- a CORDIC step being
+   three additions */
+extern long fix_nadd;
+extern long fix_nmul;
+extern long fix_ndiv;
+#endif
+
+/* Set the number of fraction bits, and make the tables for it.
+   args: int bits -- FIX_MINB to FIX_MAXB */
+void fix_set ();
+
+/* A double as a fixed-point number, rounded. args: double d, te_int *r.
+   ret: zero if it is too big (or NaN) */
+int fix_of ();
+
+/* The value of a fixed-point number as a double. args: te_int a */
+double fix_dbl ();
+
+/* a + b, a - b, a * b (rounded), a / b (rounded), and the remainder of
+   a / b, as fmod() gives it. E_FIXBIG if the result is too big, and
+   E_DIVZ for division by zero. args: te_int a, te_int b. ret: the
+   result */
+te_int fix_add ();
+te_int fix_sub ();
+te_int fix_mul ();
+te_int fix_div ();
+te_int fix_mod ();
+
+/* Find the fixed-point version of one of kcalc's functions, like _sin
+   or _pow. args: void *f. ret: the function, or 0 if there isn't one */
+fix_fun fix_kern ();
+
+/* Write a number in decimal, with as many places as fix_bits resolve,
+   and no trailing zeros. args: te_int a, char *buff -- at least
+   TE_IBITS + 4 characters */
+void fix_fmt ();
+
+#endif
+
@@ -0,0 +1,129 @@
+/*===========================================================================
+
+  fntest.c
+
+  Expressions for checking that the short kernels of SIN, COS, TAN, LOG
+  and LOG10 (see fn_prec in funcs.h) don't change the digits that are
+  shown: the functions over wide ranges, near multiples of pi/2 and at
+  exact powers of 10 and 2, in sums that cancel, and under rounding,
+  remainders, ASIN and powers that magnify small errors. fntest.sh gives
+  the same expressions to kcalc with FAST OFF and FAST ON, in both angle
+  modes at SIGFIG 1 to 5, and compares the results. Run it with
+
+    make -f Makefile.linux fntest
+
+  The expressions are the same every time for the same seed, which is
+  the first argument (1 if there isn't one); the second is the number of
+  rounds (3000 if there isn't one), which make about 22 expressions each.
+  The whole file is empty unless FNTEST is defined, so it doesn't add
+  to kcalc.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifdef FNTEST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+static unsigned long long ft_seed;
+
+/* A random number in [0, 1), from a 64-bit linear congruential generator,
+   so that it is the same everywhere */
+static double ft_rand ()
+  {
+  ft_seed = ft_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (ft_seed >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+/* A random number in [a, b), and a whole number from a to b */
+static double ft_unif (a, b)
+double a;
+double b;
+  {
+  return a + (b - a) * ft_rand ();
+  }
+
+static int ft_int (a, b)
+int a;
+int b;
+  {
+  return a + (int)((b - a + 1) * ft_rand ());
+  }
+
+/*===========================================================================
+
+  ft_plain
+
+  Functions over their ranges, and in a few compound expressions
+
+===========================================================================*/
+static void ft_plain ()
+  {
+  double x, a, b;
+  int k;
+
+  x = ft_unif (-10.0, 10.0);
+  printf ("SIN(%.17g)\nCOS(%.17g)\nTAN(%.17g)\n", x, x, x);
+  x = ft_unif (-1e5, 1e5);
+  printf ("SIN(%.17g)\nCOS(%.17g)\n", x, x);
+
+  /* Near multiples of pi/2, where the result is small and the reduction
+     has to be good */
+  k = ft_int (-1000, 1000);
+  x = k * 3.14159265358979323846 / 2
+    + pow (10.0, ft_unif (-12.0, -2.0)) * (ft_rand () < 0.5 ? -1 : 1);
+  printf ("SIN(%.17g)\nCOS(%.17g)\nTAN(%.17g)\n", x, x, x);
+
+  x = pow (10.0, ft_unif (-30.0, 30.0));
+  printf ("LOG(%.17g)\nLOG10(%.17g)\n", x, x);
+  x = 1 + ft_unif (-1e-3, 1e-3);
+  printf ("LOG(%.17g)\nLOG10(%.17g)\n", x, x);
+  printf ("LOG10(1E%d)\nLOG(2^%d)\n", ft_int (0, 15), ft_int (0, 50));
+
+  a = ft_unif (0.1, 100.0);
+  b = ft_unif (-3.0, 3.0);
+  printf ("SIN(%.17g)*COS(%.17g)+LOG(%.17g)\n", b, a, a);
+  printf ("%.17g^2*TAN(%.17g)/LOG10(%.17g)\n", b, b, a);
+  printf ("EXP(SIN(%.17g))+SQRT(LOG(%.17g))\n", b, a + 1);
+  }
+
+/*===========================================================================
+
+  ft_hard
+
+  Expressions that would show a short kernel's error, if it weren't
+  worked out again in full
+
+===========================================================================*/
+static void ft_hard ()
+  {
+  int k = ft_int (0, 15);
+  double x = ft_unif (-10.0, 10.0);
+
+  printf ("FLOOR(LOG10(1E%d))\n", k);
+  printf ("LOG10(1E%d)-%d\n", k, k);
+  printf ("(%.17g*LOG10(1E%d))%%1\n", ft_unif (0.0, 3.0), k);
+  printf ("ASIN(SIN(%.17g))\nACOS(COS(%d))\n", x, ft_int (0, 400));
+  printf ("2^LOG10(1E%d)\n(-2)^LOG10(1E%d)\n", k, k);
+  printf ("X=%.17g\nSIN(X)*X\nLOG(ABS(X))+TAN(X)\n", x);
+  printf ("FAC(LOG10(1E%d))\n", ft_int (0, 10));
+  }
+
+int main (argc, argv)
+int argc;
+char **argv;
+  {
+  int i, n;
+  ft_seed = argc > 1 ? atol (argv[1]) : 1;
+  n = argc > 2 ? atoi (argv[2]) : 3000;
+  for (i = 0; i < n; i++)
+    {
+    ft_plain ();
+    if (i % 2 == 0) ft_hard ();
+    }
+  return 0;
+  }
+
+#endif
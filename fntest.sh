@@ -0,0 +1,23 @@
+#!/bin/sh
+# Check that the short kernels of SIN and the like don't change what kcalc
+# shows: give the expressions that fntest writes to kcalc with FAST OFF
+# and with FAST ON, in both angle modes at SIGFIG 1 to 5, and compare. 
+# The arguments, if any, are passed to fntest. Run from the directory 
+# that kcalc and fntest were built in.
+
+./fntest "$@" > fntest.in || exit 1
+echo "$(wc -l < fntest.in) expressions"
+bad=0
+for mode in RAD DEG; do
+  for sig in 1 2 3 4 5; do
+    for fast in OFF ON; do
+      { echo "FAST $fast"; echo "$mode"; echo "SIGFIG $sig"; cat fntest.in; } \
+        | ./kcalc 2>&1 | tr -d '\r' > fntest.$fast
+    done
+    n=$(diff fntest.OFF fntest.ON | grep -c '^<')
+    echo "$mode SIGFIG $sig: $n differ"
+    if [ "$n" -ne 0 ]; then bad=1; fi
+  done
+done
+if [ $bad -eq 0 ]; then rm -f fntest.in fntest.OFF fntest.ON; fi
+exit $bad
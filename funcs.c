@@ -17,6 +17,7 @@
 #include "tinyexpr.h"
 #include "math.h"
 #include "funcs.h"
+#include "config.h"
 
 /* We have to use longjmp to handle errors, as the tinyexpr library provides
    no exception-handling or error reporting method. */
@@ -25,6 +26,132 @@ extern jmp_buf err_jump;
 double DEG_TO_RAD = 2.0 * CONST_PI / 360.0;
 double RAD_TO_DEG = 360.0 / 2.0 / CONST_PI;
 
+int fn_prec = 0;
+int fn_fast = 0;
+
+/*===========================================================================
+
+  Reduced-precision kernels. When only a few digits of a result will be
+  shown, SIN, COS, TAN, LOG and LOG10 are worked out by short minimax
+  polynomials rather than by the C library, whose software floating 
+  point on CP/M is slow. sin (r) and cos (r) are found for r within 
+  pi/4 of a multiple of pi/2, the multiple being taken away in three 
+  parts, the first two with enough trailing zero bits that multiplying 
+  them by it is exact for arguments up to FN_TRIG; larger arguments go
+  to the C library. ln (m) is found for m = (1 + s) / (1 - s) between 
+  sqrt(1/2) and sqrt(2), as 2s + 2s w L(w), with w = s^2, the power of
+  2 taken out by frexp() adding a multiple of ln 2.
+
+  Each polynomial comes in two lengths. Checked against the C library 
+  over their intervals, the relative errors of the short ones are below
+  1.5e-7, and of the long ones below 1e-9, so they are good to 6 and 9
+  significant digits.
+
+===========================================================================*/
+
+#define FN_TRIG 1.0e5
+#define FN_2OPI 6.36619772367581382433e-01
+#define FN_PIO2A 1.57079632673412561417e+00
+#define FN_PIO2B 6.07710050630396597660e-11
+#define FN_PIO2C 2.02226624879595063154e-21
+#define FN_LN2 6.93147180559945309417e-01
+#define FN_IL10 4.34294481903251827651e-01
+#define FN_SQH 7.07106781186547524401e-01
+
+/* (sin (r) / r - 1) / z and (cos (r) - 1) / z, for z = r^2 */
+static double sin6[] = {-1.6666654674256107e-01, 8.332100953132587e-03, 
+  -1.9503963125730876e-04};
+static double sin9[] = {-1.6666666640797176e-01, 8.333329304854122e-03,
+  -1.9839312272699398e-04, 2.718121655326832e-06};
+static double cos6[] = {-4.9999892337330887e-01, 4.165560069594332e-02, 
+  -1.3585843887434367e-03};
+static double cos9[] = {-4.9999999694475983e-01, 4.16666203571323e-02,
+  -1.388668164804594e-03, 2.438356731941965e-05};
+
+/* (ln (m) / 2s - 1) / w */
+static double log6[] = {3.3327811007014696e-01, 2.0600997288426062e-01};
+static double log9[] = {3.333338804272544e-01, 1.9988787009834383e-01,
+  1.4935468576035899e-01};
+
+/*
+  fn_poly -- the polynomial with the n coefficients c, lowest first, at x
+*/
+static double fn_poly (c, n, x)
+double *c;
+int n;
+double x;
+  {
+  double p = c[--n];
+  while (n > 0) p = p * x + c[--n];
+  return p;
+  }
+
+/*
+  fn_red -- r, where a is r plus a whole number of quarter turns, and 
+  return that number, taken modulo 4; or -1, if there is no reduced 
+  kernel for fn_prec digits or a is too big
+*/
+static int fn_red (a, r)
+double a;
+double *r;
+  {
+  double k;
+  if (fn_prec == 0 || fn_prec > FN_DIGITS || !(a < FN_TRIG && a > -FN_TRIG))
+    return -1;
+  k = floor (a * FN_2OPI + 0.5);
+  *r = ((a - k * FN_PIO2A) - k * FN_PIO2B) - k * FN_PIO2C;
+  fn_fast = 1;
+  return (int)((long)k & 3);
+  }
+
+/*
+  fn_s, fn_c -- sin (r) and cos (r), for r no more than pi/4 either way
+*/
+static double fn_s (r)
+double r;
+  {
+  double z = r * r;
+  if (fn_prec <= 6) return r + r * z * fn_poly (sin6, 3, z);
+  return r + r * z * fn_poly (sin9, 4, z);
+  }
+
+static double fn_c (r)
+double r;
+  {
+  double z = r * r;
+  if (fn_prec <= 6) return 1.0 + z * fn_poly (cos6, 3, z);
+  return 1.0 + z * fn_poly (cos9, 4, z);
+  }
+
+/*
+  fn_ln -- ln (a), for a > 0, into l, and return non-zero; or zero, if 
+  there is no reduced kernel for fn_prec digits
+*/
+static int fn_ln (a, l)
+double a;
+double *l;
+  {
+  double m, s, w;
+  int e;
+  if (fn_prec == 0 || fn_prec > FN_DIGITS || a - a != 0.0) return 0;
+  m = frexp (a, &e);
+  if (m < FN_SQH)
+    {
+    m *= 2.0;
+    e--;
+    }
+  s = (m - 1.0) / (m + 1.0);
+  w = s * s;
+  s += s;
+  if (fn_prec <= 6)
+    *l = s + s * w * fn_poly (log6, 2, w);
+  else
+    *l = s + s * w * fn_poly (log9, 3, w);
+  *l += e * FN_LN2;
+  fn_fast = 1;
+  return 1;
+  }
+
 /** atan */
 double _atan (a) 
 double a; 
@@ -35,6 +162,16 @@ double a;
     return atan (a); 
   }
 
+/** pow with error check: C gives a NaN for a negative number to a 
+    power that isn't whole, which FIXED mode can't */
+double _pow (a, b) 
+double a; 
+double b; 
+  {
+  if (a < 0 && b != floor (b)) longjmp (err_jump, E_NEGPOW); 
+  return pow (a, b); 
+  }
+
 /** sqrt with error check */
 double _sqrt (a) 
 double a; 
@@ -80,8 +217,16 @@ double a, b;
 double _cos (a) 
 double a; 
   {
+  double r;
   if (angle_mode == AM_DEG)
     a = a * DEG_TO_RAD;
+  switch (fn_red (a, &r))
+    {
+    case 0: return fn_c (r);
+    case 1: return -fn_s (r);
+    case 2: return -fn_c (r);
+    case 3: return fn_s (r);
+    }
   return cos (a); 
   }
 
@@ -90,7 +235,9 @@ double a;
 double _log (a) 
 double a; 
   {
+  double l;
   if (a < 0) longjmp (err_jump, E_NEGLOG); 
+  if (a > 0 && fn_ln (a, &l)) return l;
   return log (a); 
   }
 
@@ -98,7 +245,9 @@ double a;
 double _log10 (a) 
 double a; 
   {
+  double l;
   if (a < 0) longjmp (err_jump, E_NEGLOG); 
+  if (a > 0 && fn_ln (a, &l)) return l * FN_IL10;
   return log10 (a); 
   }
 
@@ -106,8 +255,16 @@ double a;
 double _sin (a) 
 double a; 
   {
+  double r;
   if (angle_mode == AM_DEG)
     a = a * DEG_TO_RAD;
+  switch (fn_red (a, &r))
+    {
+    case 0: return fn_s (r);
+    case 1: return fn_c (r);
+    case 2: return -fn_s (r);
+    case 3: return -fn_c (r);
+    }
   return sin (a); 
   }
 
@@ -115,10 +272,324 @@ double a;
 double _tan (a) 
 double a; 
   {
+  double r;
+  int q;
   if (angle_mode == AM_DEG)
     a = a * DEG_TO_RAD;
+  if ((q = fn_red (a, &r)) >= 0)
+    return (q & 1) ? -fn_c (r) / fn_s (r) : fn_s (r) / fn_c (r);
   return tan (a); 
   }
 
+/*===========================================================================
+
+  Whole-number functions: factorials, permutations and combinations, and
+  the greatest common divisor and least common multiple. Their arguments
+  must be whole numbers (E_WHOLE otherwise). They are worked out in 
+  doubles, so are exact only as long as the result has no more digits 
+  than a double holds; BIG mode (Linux only, see big.c) has exact 
+  versions.
+
+===========================================================================*/
+
+/* Check that a is a whole number, and not negative if pos */
+static void whole (a, pos)
+double a;
+int pos;
+  {
+  if (a != floor (a) || (pos && a < 0)) longjmp (err_jump, E_WHOLE);
+  }
+
+/** n! -- beyond 170!, a double has long since overflowed */
+double _fac (n) 
+double n; 
+  {
+  double r = 1, i;
+  whole (n, 1);
+  for (i = 2; i <= n && i <= 171; i++) r *= i;
+  return r;
+  }
+
+/** The ways of choosing k of n things, in order. Once r has overflowed,
+    there's no need to go on */
+double _npr (n, k) 
+double n, k; 
+  {
+  double r = 1, j;
+  whole (n, 1);
+  whole (k, 1);
+  if (k > n) return 0;
+  /* Counting j, rather than stepping a factor up to n, which beyond 
+     2^53 can't be stepped */
+  for (j = 0; j < k && r * 2 != r; j++) r *= n - j;
+  return r;
+  }
+
+/** The ways of choosing k of n things, in any order. Each partial result
+    is itself a number of combinations, so is a whole number */
+double _ncr (n, k) 
+double n, k; 
+  {
+  double r = 1, i;
+  whole (n, 1);
+  whole (k, 1);
+  if (k > n) return 0;
+  if (k > n - k) k = n - k;
+  for (i = 1; i <= k && r * 2 != r; i++) r = r * (n - k + i) / i;
+  return r;
+  }
+
+/** Greatest common divisor, by Euclid's algorithm */
+double _gcd (a, b) 
+double a, b; 
+  {
+  double t;
+  whole (a, 0);
+  whole (b, 0);
+  a = fabs (a);
+  b = fabs (b);
+  while (b > 0)
+    {
+    t = a - b * floor (a / b);
+    a = b;
+    b = t;
+    }
+  return a;
+  }
+
+/** Least common multiple */
+double _lcm (a, b) 
+double a, b; 
+  {
+  if (a == 0 || b == 0)
+    {
+    whole (a, 0);
+    whole (b, 0);
+    return 0;
+    }
+  return fabs (a / _gcd (a, b) * b);
+  }
+
+/*===========================================================================
+
+  Functions of an expression. Each gets a compiled expression, the 
+  address of the variable that the expression is to be evaluated over,
+  and up to two further arguments. The expression is evaluated by 
+  setting the variable and calling te_eval(), so there is no parsing
+  in the loop. Errors in the expression longjmp out in the usual way.
+
+===========================================================================*/
+
+/** Sum of expr for var = from, from + 1, ... to. This uses Neumaier's 
+    compensated summation, so that long sums of terms of different
+    magnitudes don't lose precision. */
+double _sum (expr, var, from, to) 
+te_expr *expr;
+double *var;
+double from, to; 
+  {
+  double sum = 0, c = 0, t, term;
+  long i, n;
+  if (to < from) return 0;
+  if (!(to - from < 2147483647.0)) longjmp (err_jump, E_RANGE);
+  n = (long)(to - from) + 1;
+  for (i = 0; i < n; i++)
+    {
+    *var = from + i;
+    term = te_eval (expr);
+    t = sum + term;
+    if (fabs (sum) >= fabs (term))
+      c += (sum - t) + term;
+    else
+      c += (term - t) + sum;
+    sum = t;
+    }
+  return sum + c;
+  }
+
+/** Product of expr for var = from, from + 1, ... to */
+double _prod (expr, var, from, to) 
+te_expr *expr;
+double *var;
+double from, to; 
+  {
+  double prod = 1;
+  long i, n;
+  if (to < from) return 1;
+  if (!(to - from < 2147483647.0)) longjmp (err_jump, E_RANGE);
+  n = (long)(to - from) + 1;
+  for (i = 0; i < n && prod != 0; i++)
+    {
+    *var = from + i;
+    prod *= te_eval (expr);
+    }
+  return prod;
+  }
+
+/** Value of expr at var = x */
+static double at (expr, var, x)
+te_expr *expr;
+double *var;
+double x;
+  {
+  *var = x;
+  return te_eval (expr);
+  }
+
+/** One step of adaptive Simpson's rule: whole is the Simpson estimate
+    over [a, b], and fa, fm, fb the values at the ends and middle. The
+    interval is split until the two halves agree with the whole to
+    within eps, or the depth limit is reached. */
+static double simpson (expr, var, a, b, eps, whole, fa, fm, fb, depth)
+te_expr *expr;
+double *var;
+double a, b, eps, whole, fa, fm, fb;
+int depth;
+  {
+  double m = (a + b) / 2, h = (b - a) / 4;
+  double flm = at (expr, var, a + h);
+  double frm = at (expr, var, b - h);
+  double left = h / 3 * (fa + 4 * flm + fm);
+  double right = h / 3 * (fm + 4 * frm + fb);
+  double delta = left + right - whole;
+  if (depth <= 0 || fabs (delta) <= 15 * eps)
+    return left + right + delta / 15;
+  return simpson (expr, var, a, m, eps / 2, left, fa, flm, fm, depth - 1)
+       + simpson (expr, var, m, b, eps / 2, right, fm, frm, fb, depth - 1);
+  }
 
+/** Definite integral of expr with respect to var, from a to b */
+double _integr (expr, var, a, b) 
+te_expr *expr;
+double *var;
+double a, b; 
+  {
+  double fa, fm, fb, whole;
+  if (a == b) return 0;
+  fa = at (expr, var, a);
+  fm = at (expr, var, (a + b) / 2);
+  fb = at (expr, var, b);
+  whole = (b - a) / 6 * (fa + 4 * fm + fb);
+  return simpson (expr, var, a, b, INTEG_EPS * (fabs (whole) + INTEG_EPS), 
+    whole, fa, fm, fb, INTEG_DEPTH);
+  }
+
+/** Value of var, near guess, at which expr is zero, by the secant method */
+double _solve (expr, var, guess, unused) 
+te_expr *expr;
+double *var;
+double guess, unused; 
+  {
+  double x0 = guess, x1, f0, f1, x2;
+  int i;
+  (void)unused;
+  x1 = guess + (guess == 0 ? 1e-4 : guess * 1e-4);
+  f0 = at (expr, var, x0);
+  if (f0 == 0) return x0;
+  for (i = 0; i < SOLVE_ITER; i++)
+    {
+    f1 = at (expr, var, x1);
+    if (f1 == 0) return x1;
+    if (f1 == f0) break;
+    x2 = x1 - f1 * (x1 - x0) / (f1 - f0);
+    if (fabs (x2 - x1) <= SOLVE_EPS * fabs (x2)) return x2;
+    x0 = x1; f0 = f1;
+    x1 = x2;
+    }
+  longjmp (err_jump, E_NOCONV);
+  return 0; /* Not reached */
+  }
 
+/** Ways of combining the elements of a vector, for SUM(v), PROD(v), 
+    MIN(v) and MAX(v). The product is also DOT's per-element function. */
+double _vadd (a, b) double a; double b; {return a + b;}
+double _vmul (a, b) double a; double b; {return a * b;}
+double _vmin (a, b) double a; double b; {return a < b ? a : b;}
+double _vmax (a, b) double a; double b; {return a > b ? a : b;}
+
+/** linspace: n equally-spaced values, from a to b inclusive */
+te_vec *_linsp (a, b, n)
+double a;
+double b;
+double n;
+  {
+  te_vec *v;
+  int i, k;
+  if (n < 2 || n > VEC_MAX || n != floor (n)) longjmp (err_jump, E_RANGE);
+  k = n;
+  if ((v = te_vnew (k)) == 0) longjmp (err_jump, E_NOMEM);
+  for (i = 0; i < k - 1; i++)
+    v->v[i] = a + (b - a) * i / (k - 1);
+  v->v[k - 1] = b;
+  return v;
+  }
+
+/*===========================================================================
+
+  Random numbers. These come from a counter-based generator: the n'th
+  number drawn for a sample is a hash of the seed, the sample number,
+  and n, rather than the next state of a sequence. So the numbers for 
+  any sample can be worked out without drawing those for the samples 
+  before it, and the results of MONTECARLO depend only on the seed, 
+  not on the order in which samples are taken. The hash is Chris 
+  Wellons' "lowbias32", which uses only 32-bit arithmetic, so it gives
+  the same numbers on CP/M as on Linux. 
+
+===========================================================================*/
+
+#define LO32(x) ((x) & 0xffffffffL)
+
+static unsigned long rn_key = 0;
+static unsigned long rn_draw = 0;
+
+/** lowbias32 -- mix the bits of a 32-bit number */
+static unsigned long rn_hash (x)
+unsigned long x;
+  {
+  x = LO32 (x);
+  x ^= x >> 16;
+  x = LO32 (x * 0x7feb352dL);
+  x ^= x >> 15;
+  x = LO32 (x * 0x846ca68bL);
+  x ^= x >> 16;
+  return x;
+  }
+
+/** Start drawing the numbers for a sample */
+void rn_start (seed, sample)
+long seed;
+long sample;
+  {
+  rn_key = rn_hash (rn_hash (seed) ^ sample);
+  rn_draw = 0;
+  }
+
+/** The next number for the current sample, uniform in [0, 1), with 53
+    random bits */
+static double rn_next ()
+  {
+  unsigned long h1, h2;
+  h1 = rn_hash (rn_key ^ LO32 (2 * rn_draw));
+  h2 = rn_hash (rn_key ^ LO32 (2 * rn_draw + 1));
+  rn_draw++;
+  return ((h1 >> 5) * 67108864.0 + (h2 >> 6)) / 9007199254740992.0;
+  }
+
+/** Uniformly distributed between a and b */
+double _unif (a, b)
+double a;
+double b;
+  {
+  return a + (b - a) * rn_next ();
+  }
+
+/** Normally distributed, with mean m and standard deviation sd, by the
+    Box-Muller method. This makes two independent numbers, but only one
+    is used, so that each call takes the same number of draws. */
+double _norm (m, sd)
+double m;
+double sd;
+  {
+  double u = 1.0 - rn_next (), v = rn_next ();
+  return m + sd * sqrt (-2.0 * log (u)) * cos (2.0 * CONST_PI * v);
+  }
@@ -13,6 +13,17 @@
 #define CONST_E 2.718281828459045235
 #define CONST_PI 3.141592653589793238
 
+/* The most significant digits that the reduced-precision versions of
+   SIN, COS, TAN, LOG and LOG10 are good to */
+#define FN_DIGITS 9
+
+/* The significant digits that the results of SIN, COS, TAN, LOG and 
+   LOG10 need, or 0 for full precision. With up to FN_DIGITS, they are
+   worked out by short polynomials (see funcs.c), and fn_fast is set
+   non-zero; it is only ever cleared by the caller */
+extern int fn_prec;
+extern int fn_fast;
+
 /* One double argument */
 double _acos ();
 double _asin ();
@@ -24,8 +35,48 @@ double _sin ();
 double _sqrt ();
 double _tan ();
 
-/* Two double arguments */
+/* Two double arguments. _pow is pow, but a negative number to a power
+   that isn't whole is E_NEGPOW, rather than a NaN */
 double _atan2 ();
+double _pow ();
+
+/* Whole numbers: n!, the permutations and combinations of n things
+   taken k at a time, and the greatest common divisor and least common 
+   multiple of a and b. E_WHOLE if an argument isn't a whole number, or
+   for n or k, is negative. args: double n[, double k]; double a, 
+   double b */
+double _fac ();
+double _npr ();
+double _ncr ();
+double _gcd ();
+double _lcm ();
+
+/* An expression, the address of the variable it uses, and two doubles
+   (see TE_FLAG_LOOP) */
+double _integr ();
+double _prod ();
+double _solve ();
+double _sum ();
+
+/* Two double arguments, for combining the elements of a vector (see 
+   TE_FLAG_RED) */
+double _vadd ();
+double _vmax ();
+double _vmin ();
+double _vmul ();
+
+/* Three double arguments, returning a new vector (see TE_FLAG_GEN) */
+te_vec *_linsp ();
+
+/* Random numbers, uniform between a and b, and normal with mean m and
+   standard deviation sd. args: double a, double b; double m, double sd */
+double _unif ();
+double _norm ();
+
+/* Start drawing the random numbers for a sample. The numbers depend only
+   on the seed, the sample, and how many have been drawn since this was
+   called. args: long seed, long sample */
+void rn_start ();
 
 #endif
 
@@ -19,6 +19,17 @@
 #include "term.h"
 #include "config.h"
 #include "compat.h"
+#include "memo.h"
+#include "obuf.h"
+#include "compl.h"
+#include "kcalc.h"
+#include "bulk.h"
+#include "code.h"
+#include "vmath.h"
+#include "dd.h"
+#include "rat.h"
+#include "big.h"
+#include "fix.h"
 #ifdef LINUX
 #include <string.h>
 #include <stdlib.h>
@@ -27,38 +38,45 @@
 #define BANNER1 "kcalc-cpm version 0.1b, January 2022.\r\n"
 #define BANNER2 "Enter \"help\" for instructions, \"quit\" to exit.\r\n"
 
-/* The largest number of characters that are required to render a number
- * in full precision. Aztec C gives about 9 digits; modern compilers much
- * more. */
-#define MAX_NUM_STR 20
-
 /** The main symbol table */
-#define SYMTAB_MAX 30
-static te_variable symtab[SYMTAB_MAX];
+te_variable symtab[SYMTAB_MAX];
 /* Number of entries in the symbol table. Note that nsyms _includes_
    symtab entries that are currently empty.  */
 int nsyms = 0; 
 
 double ans = 0; /* Last answer */
+#ifdef LINUX
+/* The last result of kc_eval() in BIG mode, which is freed by the next
+   call, unless the caller takes it and sets this to 0 */
+static big_num *kc_bnum = 0;
+#endif
 
 void kc_set_num (); /* Fwd ref */
+void kc_set_defn (); /* Fwd ref */
+static te_variable *kc_find_sym (); /* Fwd ref */
 
 int sigfig = 5; /* Precision of output */
+
+/* Output bases that show numbers as integers */
+#define KC_RADIX(b) ((b) == BM_HEX || (b) == BM_OCT || (b) == BM_BIN)
 char fmt[7]; /* sprintf() format string to give this precision */
 
 /*===========================================================================
 
   kc_toupper
 
-  Convert a string to upper case
+  Convert a string to upper case, except for any parts in double quotes,
+  which may be file names.
 
 ===========================================================================*/
 void kc_toupper (s)
 char *s;
   {
+  int quoted = 0;
   while (*s)
     {
-    *s = toupper (*s);
+    if (*s == '"') quoted = !quoted;
+    if (!quoted) *s = toupper (*s);
     s++;
     }
   }
@@ -82,6 +100,22 @@ int code;
   if (code == E_NOIDENT) return "Missing identifier";
   if (code == E_NOEXPR) return "Missing expression";
   if (code == E_MSYMS) return "Symbol table full";
+  if (code == E_CYCLE) return "Circular definition";
+  if (code == E_RANGE) return "Invalid range";
+  if (code == E_NOCONV) return "No solution found";
+  if (code == E_VLEN) return "Vector lengths differ";
+  if (code == E_VECTOR) return "Vector not allowed here";
+  if (code == E_NOMEM) return "Out of memory";
+  if (code == E_DEEP) return "Expression nested too deeply";
+  if (code == E_NOCODE) return "Can't be written as C";
+  if (code == E_NODD) return "Not available in DD mode";
+  if (code == E_NOINT) return "Not available in INT mode";
+  if (code == E_WHOLE) return "Not a whole number";
+  if (code == E_NOBIG) return "Not available in BIG mode";
+  if (code == E_NOFIX) return "Not available in FIXED mode";
+  if (code == E_FIXBIG) return "Too big for FIXED mode";
+  if (code == E_LOOPDEF) return "Formula uses the loop variable";
+  if (code == E_NEGPOW) return "Fractional power of negative number";
   return "Unknown error";
   }
 
@@ -94,14 +128,18 @@ int code;
 ===========================================================================*/
 void kc_keys ()
   {
-  printf ("ctrl+a          left one word\r\n");
-  printf ("ctrl+b          start of line\r\n");
-  printf ("ctrl+b, ctrl-b  end of line\r\n");
-  printf ("ctrl+c          quit\r\n");
-  printf ("ctrl+d          right one character\r\n");
-  printf ("ctrl+f          right one word\r\n");
-  printf ("ctrl+h/BS       erase character left\r\n");
-  printf ("ctrl+s          left one character\r\n");
+  ob_puts ("ctrl+a          left one word\r\n");
+  ob_puts ("ctrl+b          start of line\r\n");
+  ob_puts ("ctrl+b, ctrl-b  end of line\r\n");
+  ob_puts ("ctrl+c          quit\r\n");
+  ob_puts ("ctrl+d          right one character\r\n");
+  ob_puts ("ctrl+e          previous line in history\r\n");
+  ob_puts ("ctrl+f          right one word\r\n");
+  ob_puts ("ctrl+h/BS       erase character left\r\n");
+  ob_puts ("ctrl+r          search history (again: older match)\r\n");
+  ob_puts ("ctrl+s          left one character\r\n");
+  ob_puts ("ctrl+x          next line in history\r\n");
+  ob_puts ("tab             complete a name\r\n");
   }
 
 /*===========================================================================
@@ -113,16 +151,55 @@ void kc_keys ()
 ===========================================================================*/
 void kc_status ()
   {
+  char buff[80];
   if (angle_mode == AM_DEG)
-    printf ("Angle mode is degrees. use RAD to set it to radians.\r\n");
+    ob_puts ("Angle mode is degrees. use RAD to set it to radians.\r\n");
   else
-    printf ("Angle mode is radians. use DEG to set it to degrees.\r\n");
+    ob_puts ("Angle mode is radians. use DEG to set it to degrees.\r\n");
   if (base_mode == BM_DEC)
-    printf ("Output base is decimal. use HEX to set it to hexadecimal.\r\n");
+    ob_puts ("Output base is decimal. use HEX, OCT or BIN to change it.\r\n");
+  else if (base_mode == BM_OCT)
+    ob_puts ("Output base is octal. use DEC to set it to decimal.\r\n");
+  else if (base_mode == BM_BIN)
+    ob_puts ("Output base is binary. use DEC to set it to decimal.\r\n");
+  else if (base_mode == BM_FRAC)
+    ob_puts ("Results are fractions. use DEC to set it to decimal.\r\n");
+  else
+    ob_puts ("Output base is hexadecimal. use DEC to set it to decimal.\r\n");
+  if (int_mode)
+    ob_puts ("INT mode is on. use INT OFF to turn it off.\r\n");
+  else
+    ob_puts ("INT mode is off. use INT ON to turn it on.\r\n");
+  if (fix_mode)
+    {
+    sprintf (buff, "FIXED mode is on, with %d fraction bits. %s\r\n",
+      fix_bits, "use FIXED OFF to turn it off.");
+    ob_puts (buff);
+    }
   else
-    printf ("Output base is hexadecimal. use DEC to set it to decimal.\r\n");
-  printf ("Output precision is %d digits -- use SIGFIG n to change it.\r\n", 
+    ob_puts ("FIXED mode is off. use FIXED ON to turn it on.\r\n");
+  sprintf (buff, 
+    "Output precision is %d digits -- use SIGFIG n to change it.\r\n", 
     sigfig);
+  ob_puts (buff);
+  if (memo_on)
+    ob_puts ("Function cache is on. use MEMO OFF to turn it off.\r\n");
+  else
+    ob_puts ("Function cache is off. use MEMO ON to turn it on.\r\n");
+#ifdef LINUX
+  if (fast_math)
+    ob_puts ("Fast SIN/COS is on. use FAST OFF to turn it off.\r\n");
+  else
+    ob_puts ("Fast SIN/COS is off. use FAST ON to turn it on.\r\n");
+  if (dd_mode)
+    ob_puts ("DD mode is on. use DD OFF to turn it off.\r\n");
+  else
+    ob_puts ("DD mode is off. use DD ON to turn it on.\r\n");
+  if (big_mode)
+    ob_puts ("BIG mode is on. use BIG OFF to turn it off.\r\n");
+  else
+    ob_puts ("BIG mode is off. use BIG ON to turn it on.\r\n");
+#endif
   }
 
 /*===========================================================================
@@ -134,20 +211,37 @@ void kc_status ()
 ===========================================================================*/
 void kc_help ()
   {
-  printf (BANNER1);
-  printf 
+  ob_puts (BANNER1);
+  ob_puts 
 ("Enter mathematical expressions at the prompt (or on the command line).\r\n");
-  printf 
+  ob_puts 
 ("Enter \"list\" for a list of functions, constants, and commands.\r\n");
-  printf 
+  ob_puts 
 ("Enter \"keys\" for information about line editing keys.\r\n");
-  printf 
+  ob_puts 
 ("Enter \"status\" for current settings.\r\n");
-  printf 
+  ob_puts 
 ("For more information: http://kevinboone.me/kcalc-cpm.html.\r\n");
   }
 
 
+/*===========================================================================
+
+  kc_loop_usage
+
+  Describe the arguments of a function like SUM, or LINSPACE
+
+===========================================================================*/
+char *kc_loop_usage (name)
+char *name;
+  {
+  if (strcmp (name, "INTEGRATE") == 0) return "INTEGRATE(expr,x,from,to)";
+  if (strcmp (name, "LINSPACE") == 0) return "LINSPACE(from,to,n)";
+  if (strcmp (name, "SOLVE") == 0) return "SOLVE(expr,x,guess)";
+  if (strcmp (name, "PROD") == 0) return "PROD(expr,i,from,to), PROD(v)";
+  return "SUM(expr,i,from,to), SUM(v)";
+  }
+
 /*===========================================================================
 
   kc_do_list
@@ -159,43 +253,211 @@ void kc_do_list ()
   {
   register int i;
 
-  printf ("Constants/variables:\r\n");
+  ob_puts ("Constants/variables:\r\n");
   for (i = 0; i < nsyms; i++)
     {
     te_variable *sym = &symtab[i];
     if (TYPE_MASK (sym->type) == TE_CONSTANT 
              || TYPE_MASK (sym->type) == TE_VARIABLE)
-      if (sym->name) printf ("%s\r\n", sym->name);
+      if (sym->name) 
+        {
+        ob_puts (sym->name);
+        ob_puts ("\r\n");
+        }
     }
-  printf ("\r\n");
+  ob_puts ("\r\n");
 
-  printf ("Functions:\r\n");
+  ob_puts ("Functions:\r\n");
   for (i = 0; i < nsyms; i++)
     {
     te_variable *sym = &symtab[i];
     if (sym->name)
       {
       if (TYPE_MASK (sym->type) == TE_FUNC1 
-          || TYPE_MASK (sym->type) == TE_FUNC2)
+          || TYPE_MASK (sym->type) == TE_FUNC2
+          || TYPE_MASK (sym->type) == TE_FUNC3)
         {
         if (TYPE_MASK (sym->type) == TE_FUNC1)
-          printf ("%s(x)\r\n", sym->name);
+          {
+          ob_puts (sym->name);
+          ob_puts ("(x)\r\n");
+          }
+        else if (sym->type & (TE_FLAG_LOOP | TE_FLAG_GEN))
+          {
+          ob_puts (kc_loop_usage (sym->name));
+          ob_puts ("\r\n");
+          }
         else
-          printf ("%s(x,y)\r\n", sym->name);
+          {
+          ob_puts (sym->name);
+          ob_puts ("(x,y)\r\n");
+          }
         }
       }
     }
-  printf ("\r\n");
-  printf ("Commands:\r\n");
-  printf ("DEC\r\n");
-  printf ("DEG\r\n");
-  printf ("HEX\r\n");
-  printf ("LIST\r\n");
-  printf ("HELP\r\n");
-  printf ("KEYS\r\n");
-  printf ("QUIT\r\n");
-  printf ("RAD\r\n");
-  printf ("SIGFIG n\r\n");
+  ob_puts ("\r\n");
+  ob_puts ("Commands:\r\n");
+#ifdef LINUX
+  ob_puts ("BINARY \"out\", expr, var = \"in\"[, var = \"in\"...]\r\n");
+#endif
+  ob_puts ("BIN\r\n");
+#ifdef LINUX
+  ob_puts ("BIG [ON|OFF]\r\n");
+#endif
+  ob_puts ("CODE name(param[, param...]) = expr\r\n");
+  ob_puts ("CSV \"file\", expr[, expr...]\r\n");
+  ob_puts ("DEC\r\n");
+  ob_puts ("DEG\r\n");
+#ifdef LINUX
+  ob_puts ("DD [ON|OFF]\r\n");
+  ob_puts ("FAST [ON|OFF]\r\n");
+#endif
+  ob_puts ("FIXED [ON|OFF|n]\r\n");
+  ob_puts ("FRAC\r\n");
+  ob_puts ("HEX\r\n");
+  ob_puts ("INT [ON|OFF]\r\n");
+  ob_puts ("LIST\r\n");
+  ob_puts ("LOAD \"file\", var\r\n");
+  ob_puts ("HELP\r\n");
+  ob_puts ("KEYS\r\n");
+  ob_puts ("MEMO [ON|OFF]\r\n");
+  ob_puts ("MONTECARLO expr, count[, seed]\r\n");
+  ob_puts ("OCT\r\n");
+  ob_puts ("QUIT\r\n");
+  ob_puts ("RAD\r\n");
+  ob_puts ("SIGFIG n\r\n");
+  ob_puts ("STATS expr, var\r\n");
+  ob_puts ("SWEEP expr, var = from:to:count[, var = from:to:count...]\r\n");
+  ob_puts ("TABLE expr[, expr...], var, from, to, step\r\n");
+  }
+
+/*===========================================================================
+
+  kc_redo
+
+  Mark every formula as needing recalculation, after a change of mode
+
+===========================================================================*/
+static void kc_redo ()
+  {
+  int i;
+  for (i = 0; i < nsyms; i++)
+    if (symtab[i].name && (symtab[i].type & TE_FLAG_DEFN))
+      symtab[i].type |= TE_FLAG_DIRTY;
+  }
+
+#ifdef LINUX
+/*===========================================================================
+
+  kc_dd
+
+  Turn DD mode on or off. Formulas are recalculated in the new mode when
+  they are next used; more digits than a double has can't be shown once
+  it is off.
+
+===========================================================================*/
+void kc_dd (on)
+int on;
+  {
+  dd_mode = on;
+  if (on) int_mode = big_mode = fix_mode = 0;
+  if (on && base_mode == BM_FRAC) base_mode = BM_DEC;
+  kc_redo ();
+  if (!on && sigfig > 9) sigfig = 9;
+  }
+
+/*===========================================================================
+
+  kc_big
+
+  Turn BIG mode on or off, as kc_dd() does. INT, DD and FRAC modes are 
+  turned off by it.
+
+===========================================================================*/
+void kc_big (on)
+int on;
+  {
+  if (on)
+    {
+    kc_dd (0);
+    int_mode = fix_mode = 0;
+    if (base_mode == BM_FRAC) base_mode = BM_DEC;
+    }
+  big_mode = on;
+  kc_redo ();
+  }
+#endif
+
+/*===========================================================================
+
+  kc_int
+
+  Turn INT mode on or off. As for kc_dd(), formulas are recalculated in
+  the new mode when they are next used.
+
+===========================================================================*/
+void kc_int (on)
+int on;
+  {
+  int_mode = on;
+#ifdef LINUX
+  if (on) kc_dd (0);
+  if (on) big_mode = 0;
+#endif
+  if (on) fix_mode = 0;
+  if (on && base_mode == BM_FRAC) base_mode = BM_DEC;
+  kc_redo ();
+  }
+
+/*===========================================================================
+
+  kc_fix
+
+  Turn FIXED mode on or off, with bits fraction bits, as kc_int() does.
+  INT, DD, BIG and FRAC modes are turned off by it.
+
+===========================================================================*/
+void kc_fix (on, bits)
+int on;
+int bits;
+  {
+  if (on)
+    {
+    kc_int (0);
+#ifdef LINUX
+    kc_dd (0);
+    kc_big (0);
+#endif
+    if (base_mode == BM_FRAC) base_mode = BM_DEC;
+    fix_set (bits);
+    }
+  fix_mode = on;
+  kc_redo ();
+  }
+
+/*===========================================================================
+
+  kc_base
+
+  Set the output base. In FRAC mode, expressions are also evaluated in
+  fractions, so formulas are recalculated when it is turned on or off,
+  and INT and DD mode are turned off.
+
+===========================================================================*/
+void kc_base (b)
+int b;
+  {
+  if ((b == BM_FRAC) != (base_mode == BM_FRAC)) kc_redo ();
+  if (b == BM_FRAC)
+    {
+    kc_int (0);
+    kc_fix (0, fix_bits);
+#ifdef LINUX
+    kc_dd (0);
+    kc_big (0);
+#endif
+    }
+  base_mode = b;
   }
 
 /*===========================================================================
@@ -235,29 +497,178 @@ char *line;
     }
   else if (strncmp (line, "DEC", 3) == 0)
     {
-    base_mode = BM_DEC; return 1;
+    kc_base (BM_DEC); return 1;
     }
   else if (strncmp (line, "HEX", 3) == 0)
     {
-    base_mode = BM_HEX; return 1;
+    kc_base (BM_HEX); return 1;
+    }
+  else if (strncmp (line, "OCT", 3) == 0 && !isalnum (line[3]) 
+        && line[3] != '_')
+    {
+    kc_base (BM_OCT); return 1;
+    }
+  else if (strncmp (line, "FRAC", 4) == 0 && !isalnum (line[4]) 
+        && line[4] != '_')
+    {
+    kc_base (BM_FRAC); return 1;
+    }
+  else if (strncmp (line, "BIN", 3) == 0 && !isalnum (line[3]) 
+        && line[3] != '_')
+    {
+    kc_base (BM_BIN); return 1;
+    }
+  else if (strncmp (line, "INT", 3) == 0 && !isalnum (line[3]) 
+        && line[3] != '_')
+    {
+    char *arg = line + 3;
+    while (*arg && isspace (*arg)) arg++;
+    if (strncmp (arg, "ON", 2) == 0)
+      kc_int (1);
+    else if (strncmp (arg, "OFF", 3) == 0)
+      kc_int (0);
+    else
+      fprintf (stderr, "Usage: INT ON|OFF\r\n");
+    return 1;
+    }
+  else if (strncmp (line, "FIXED", 5) == 0 && !isalnum (line[5]) 
+        && line[5] != '_')
+    {
+    char *arg = line + 5;
+    int b;
+    while (*arg && isspace (*arg)) arg++;
+    if (strncmp (arg, "ON", 2) == 0)
+      kc_fix (1, fix_bits);
+    else if (strncmp (arg, "OFF", 3) == 0)
+      kc_fix (0, fix_bits);
+    else if (isdigit (*arg) && (b = atoi (arg)) >= FIX_MINB 
+        && b <= FIX_MAXB)
+      kc_fix (1, b);
+#ifdef LINUX
+    else if (*arg == 0)
+      printf ("Last result: %ld additions, %ld multiplications, "
+        "%ld divisions\r\n", fix_nadd, fix_nmul, fix_ndiv);
+#endif
+    else
+      fprintf (stderr, "Usage: FIXED ON|OFF|n, n from %d to %d\r\n", 
+        FIX_MINB, FIX_MAXB);
+    return 1;
+    }
+  else if (strncmp (line, "MONTECARLO", 10) == 0)
+    {
+    bulk_mc (line + 10); return 1;
+    }
+  else if (strncmp (line, "SWEEP", 5) == 0)
+    {
+    bulk_sweep (line + 5); return 1;
+    }
+  else if (strncmp (line, "STATS", 5) == 0)
+    {
+    bulk_stats (line + 5); return 1;
+    }
+#ifdef LINUX
+  else if (strncmp (line, "BINARY", 6) == 0)
+    {
+    bulk_binary (line + 6); return 1;
+    }
+#endif
+  else if (strncmp (line, "LOAD", 4) == 0)
+    {
+    bulk_load (line + 4); return 1;
+    }
+  else if (strncmp (line, "CSV", 3) == 0)
+    {
+    bulk_csv (line + 3); return 1;
+    }
+  else if (strncmp (line, "CODE", 4) == 0)
+    {
+    code_func (line + 4); return 1;
+    }
+  else if (strncmp (line, "TABLE", 5) == 0)
+    {
+    bulk_table (line + 5); return 1;
+    }
+#ifdef LINUX
+  else if (strncmp (line, "DD", 2) == 0 && !isalnum (line[2]) 
+        && line[2] != '_')
+    {
+    char *arg = line + 2;
+    while (*arg && isspace (*arg)) arg++;
+    if (strncmp (arg, "ON", 2) == 0)
+      kc_dd (1);
+    else if (strncmp (arg, "OFF", 3) == 0)
+      kc_dd (0);
+    else
+      fprintf (stderr, "Usage: DD ON|OFF\r\n");
+    return 1;
+    }
+  else if (strncmp (line, "BIG", 3) == 0 && !isalnum (line[3]) 
+        && line[3] != '_')
+    {
+    char *arg = line + 3;
+    while (*arg && isspace (*arg)) arg++;
+    if (strncmp (arg, "ON", 2) == 0)
+      kc_big (1);
+    else if (strncmp (arg, "OFF", 3) == 0)
+      kc_big (0);
+    else
+      fprintf (stderr, "Usage: BIG ON|OFF\r\n");
+    return 1;
+    }
+  else if (strncmp (line, "FAST", 4) == 0)
+    {
+    char *arg = line + 4;
+    while (*arg && isspace (*arg)) arg++;
+    if (strncmp (arg, "ON", 2) == 0)
+      fast_math = 1;
+    else if (strncmp (arg, "OFF", 3) == 0)
+      fast_math = 0;
+    else
+      fprintf (stderr, "Usage: FAST ON|OFF\r\n");
+    return 1;
+    }
+#endif
+  else if (strncmp (line, "MEMO", 4) == 0)
+    {
+    char *arg = line + 4;
+    while (*arg && isspace (*arg)) arg++;
+    if (strncmp (arg, "ON", 2) == 0)
+      {
+      memo_clear ();
+      memo_on = 1;
+      }
+    else if (strncmp (arg, "OFF", 3) == 0)
+      {
+      memo_on = 0;
+      }
+    else 
+      printf ("Function cache hits: %ld, misses: %ld\r\n", 
+        memo_hits, memo_miss);
+    return 1;
     }
   else if (strncmp (line, "SIGFIG", 6) == 0)
     {
-    if (strlen (line) >= 8)
+    char *arg = line + 6;
+    int max = 9;
+#ifdef LINUX
+    if (dd_mode) max = DD_SIGFIG;
+#endif
+    while (*arg && isspace (*arg)) arg++;
+    if (isdigit (*arg))
       {
-      int s = line[7] - '0';
-      if (s >= 1 && s <= 9)
+      int s = atoi (arg);
+      if (s >= 1 && s <= max)
         {
         sigfig = s;
         }
       else
         {
-        fprintf (stderr, "sigfig must be in range 1-9\n");
+        fprintf (stderr, "sigfig must be in range 1-%d\n", max);
         }
       }
     else
       {
-      fprintf (stderr, "Usage: \"sigfig N\", where n is 1 to 9\n");
+      fprintf (stderr, "Usage: \"sigfig N\", where n is 1 to %d\n", max);
       }
     return 1;
     }
@@ -267,6 +678,51 @@ char *line;
   return 0;
   }
 
+/*===========================================================================
+
+  kc_lanes
+
+  Display the errors in the elements of a vector, given an array of 
+  their error codes: the first few, and how many there were.
+
+===========================================================================*/
+static void kc_lanes (errs, n)
+char *errs;
+int n;
+  {
+  int i, bad = 0;
+  for (i = 0; i < n; i++)
+    {
+    if (!errs[i]) continue;
+    if (bad < VEC_SHOW)
+      printf ("Element %d: %s\r\n", i + 1, kc_strerror (errs[i]));
+    bad++;
+    }
+  if (bad > VEC_SHOW)
+    printf ("%d elements could not be calculated\r\n", bad);
+  }
+
+/*===========================================================================
+
+  kc_near
+
+  Non-zero if a result is within 10^-(SIGFIG+2) of changing the digits
+  that are shown of it, relatively, so that it may be shown differently
+  if it is worked out to more digits
+
+===========================================================================*/
+static int kc_near (x)
+double x;
+  {
+  char s1[MAX_NUM_STR], s2[MAX_NUM_STR];
+  double m = 1.0;
+  int i;
+  for (i = 0; i < sigfig + 2; i++) m *= 0.1;
+  kc_fmts (x - x * m, s1);
+  kc_fmts (x + x * m, s2);
+  return strcmp (s1, s2) != 0;
+  }
+
 /*===========================================================================
 
   kc_eval
@@ -275,24 +731,145 @@ char *line;
   to true, and return HUGE if the evaluation fails. This function
   displays an error message on failure, so callers should not do so.  
 
+  If vec is not 0, the expression may use vectors, and if the result is 
+  a vector, *vec is set to it; the caller must free it. Elements of the
+  vector that can't be calculated are NaN, and the errors are displayed
+  with the element numbers.
+
+  In DD mode, the low part of the result is set in *lo; otherwise *lo is
+  zero. In INT and FRAC modes, the exact result is set in *rv, and the 
+  one returned is only its nearest double; in INT mode, its denominator 
+  is 1, and otherwise, if the result isn't exact, it is 0. In FIXED 
+  mode, *rv is the fixed-point result, over -fix_bits. In BIG mode, it
+  is set in kc_bnum.
+
+  If shown is non-zero, the result is to be displayed, so SIN and the 
+  like may be worked out to only a few more digits than SIGFIG (see 
+  fn_prec in funcs.h), unless that might change the digits shown.
+
 ===========================================================================*/
-double kc_eval (expr, error, vars, nvars)
+double kc_eval (expr, error, vars, nvars, vec, lo, rv, shown)
 char *expr;
 te_variable *vars[];
 int nvars;
 int *error;
+te_vec **vec;
+double *lo;
+rat_num *rv;
+int shown;
   {
   double ret = 0; /* TODO */
   double result;
   int error_pos = 0;
   int rt_error = 0;
+  te_expr *n;
+  char *errs;
   *error = 1;
+  if (vec) *vec = 0;
+  *lo = 0.0;
+  rv->p = 0;
+  rv->q = 0;
+#ifdef LINUX
+  big_free (kc_bnum);
+  kc_bnum = 0;
+  /* Constants are worked out as the expression is built */
+  fix_nadd = fix_nmul = fix_ndiv = 0;
+#endif
 
-  result = te_interp (expr, &error_pos, &rt_error, vars, nvars);
+  /* A result that is only shown needs SIN and the like to be good to
+     just a few more digits than it is, in floating point */
+  if (shown && sigfig + FN_GUARD <= FN_DIGITS && !int_mode && !fix_mode
+      && base_mode != BM_FRAC)
+    fn_prec = sigfig + FN_GUARD;
+#ifdef LINUX
+  /* The C library is quicker than the short kernels on Linux, so they
+     are only used with FAST ON */
+  if (big_mode || dd_mode || !fast_math) fn_prec = 0;
+#endif
+  fn_fast = 0;
+
+  n = te_build (expr, &error_pos, &rt_error, vars, nvars);
+  if (fn_prec && (!n || (vec && te_isvec (n)) || !te_smooth (n)))
+    {
+    /* Anything but arithmetic on the results, or an error, and they are
+       worked out again in full */
+    fn_prec = 0;
+    if (fn_fast)
+      {
+      if (n) te_free (n);
+      return kc_eval (expr, error, vars, nvars, vec, lo, rv, 0);
+      }
+    }
+  if (n)
+    {
+#ifdef LINUX
+    if (big_mode && !(vec && te_isvec (n)))
+      {
+      rt_error = te_btry (n, 0, 0, &kc_bnum);
+      result = rt_error ? 0.0 : big_dbl (kc_bnum);
+      }
+    else
+#endif
+    if (int_mode)
+      {
+      rt_error = te_itry (n, 0, 0, &rv->p);
+      rv->q = 1;
+      result = (double)rv->p;
+      }
+    else if (fix_mode && !(vec && te_isvec (n)))
+      {
+      rt_error = te_ftry (n, 0, 0, &rv->p);
+      rv->q = -fix_bits;
+      result = fix_dbl (rv->p);
+      }
+    else if (base_mode == BM_FRAC && !(vec && te_isvec (n)))
+      {
+      rt_error = te_rtry (n, 0, 0, rv);
+      result = rat_dbl (rv);
+      }
+    else
+#ifdef LINUX
+    if (dd_mode)
+      {
+      dd_real x;
+      rt_error = te_ddtry (n, 0, 0, &x);
+      result = x.hi;
+      *lo = x.lo;
+      }
+    else
+#endif
+    if (vec && te_isvec (n))
+      {
+      rt_error = te_vtry (n, 0, 0, &result, vec, &errs);
+      if (errs)
+        {
+        kc_lanes (errs, (*vec)->n);
+        free (errs);
+        }
+      }
+    else
+      {
+      rt_error = te_try (n, 0, 0, &result);
+      if (fn_fast && (rt_error || !te_smooth (n) || kc_near (result)))
+        {
+        te_free (n);
+        fn_prec = 0;
+        return kc_eval (expr, error, vars, nvars, vec, lo, rv, 0);
+        }
+      }
+    if (rt_error) error_pos = -1;
+    te_free (n);
+    }
+  fn_prec = 0;
 
   if (rt_error == 0)
     {
     ret = result;
+    if (!int_mode && !fix_mode && base_mode != BM_FRAC)
+      {
+      rv->p = te_toint (result);
+      rv->q = 0;
+      }
     *error = 0;
     }
   else
@@ -334,6 +911,10 @@ char *s;
 
   Parse the line as an assignment. If it can be parsed, return 1, whether
   it succeeds or not. Display error if it fails.
+
+  "name = expr" stores the value of the expression; "name := expr" stores
+  the expression itself, so that the variable follows any changes to the
+  variables it is defined in terms of.
  
   This is all very ugly -- this assignment parsing ought to be integrated
   into the main expression parser.
@@ -349,7 +930,9 @@ int nvars;
     {
     /* We are modifying the caller's string here. Check whether that's OK */
     char *sval;
+    int defn = (eqp > line && eqp[-1] == ':');
     *eqp = 0; 
+    if (defn) eqp[-1] = 0;
   
     kc_trim_right (line);
     sval = eqp + 1;
@@ -358,14 +941,40 @@ int nvars;
 
     if (line[0])
       {
-      if (sval[0])
+      if (sval[0] && defn)
+        {
+        kc_set_defn (line, sval);
+        }
+      else if (sval[0])
         {
         int error = 0;
-        double result = kc_eval (sval, &error, vars, nvars);
+        te_vec *vec;
+        double lo;
+        rat_num rv;
+        double result = kc_eval (sval, &error, vars, nvars, &vec, &lo, &rv,
+          0);
         /* kc_eval will already have displayed any error */
-        if (!error)
+        if (!error && vec)
+          {
+          kc_set_vec (line, vec);
+          }
+        else if (!error)
 	  {
+          te_variable *te;
           kc_set_num (line, result);
+          te = kc_find_sym (line);
+          if (te && TYPE_MASK (te->type) == TE_VARIABLE) 
+            {
+#ifdef LINUX
+            te->lo = lo;
+#endif
+            te->ival = rv.p;
+            te->rden = base_mode == BM_FRAC ? RAT_DEN (&rv) : rv.q;
+#ifdef LINUX
+            te->big = kc_bnum;
+            kc_bnum = 0;
+#endif
+            }
 	  }
         }
       else
@@ -437,41 +1046,256 @@ char *str;
 
 /*===========================================================================
 
-  kc_fmt
+  kc_fmtb
 
-  Format a number for display
+  Format a number in hexadecimal, octal or binary, according to the base
+  mode, into a buffer of MAX_NUM_STR characters. A hexadecimal number is
+  shown with a "#", as one is typed.
 
 ===========================================================================*/
-void kc_fmt (num)
+static void kc_fmtb (u, buff)
+te_uint u;
+char *buff;
+  {
+  char digits[TE_IBITS];
+  int shift, n = 0;
+  shift = base_mode == BM_HEX ? 4 : base_mode == BM_OCT ? 3 : 1;
+  if (base_mode == BM_HEX) *buff++ = '#';
+  do
+    {
+    digits[n++] = "0123456789abcdef"[(int)(u & ((1 << shift) - 1))];
+    u >>= shift;
+    }
+  while (u);
+  while (n > 0) *buff++ = digits[--n];
+  *buff = 0;
+  }
+
+/*===========================================================================
+
+  kc_fmts
+
+  Format a number for display, into a buffer of MAX_NUM_STR characters
+
+===========================================================================*/
+void kc_fmts (num, buff)
 double num;
+char *buff;
   {
   if (num == 0) 
     {
-    printf ("0\n");
+    strcpy (buff, "0");
     }
   else
     { 
     if (num < 0)
       {
-      printf ("-");
+      *buff++ = '-';
       num = -num;
       }
-    if (base_mode == BM_HEX)
+    if (KC_RADIX (base_mode) && num < -(double)TE_IMIN)
       {
-      printf ("#%lx\n", (long)num);
+      kc_fmtb ((te_uint)te_toint (num), buff);
       }
+#ifdef LINUX
+    else if (sigfig > 9)
+      {
+      /* Only in DD mode, for numbers that are only doubles, which have 
+         no more than 17 digits to show */
+      int s = sigfig > 17 ? 17 : sigfig;
+      sprintf (buff, "%*.*g", s, s, num);
+      kc_strz (buff);
+      }
+#endif
     else
       {
-      char s_m[MAX_NUM_STR];
       fmt[1] = sigfig + '0';
       fmt[3] = sigfig + '0'; 
-      sprintf (s_m, fmt, num);
-      kc_strz (s_m);
-      printf ("%s\n", s_m);
+      sprintf (buff, fmt, num);
+      kc_strz (buff);
       }
     }
   }
 
+/*===========================================================================
+
+  kc_fmt
+
+  Format a number for display
+
+===========================================================================*/
+void kc_fmt (num)
+double num;
+  {
+  char s_m[MAX_NUM_STR];
+  kc_fmts (num, s_m);
+  ob_puts (s_m);
+  ob_putc ('\n');
+  }
+
+/*===========================================================================
+
+  kc_fmti
+
+  Format an integer result, in INT mode. In hexadecimal, octal and 
+  binary, a negative number is shown in two's complement, as it would be
+  held in a register of TE_IBITS bits.
+
+===========================================================================*/
+void kc_fmti (i)
+te_int i;
+  {
+  char s_m[MAX_NUM_STR];
+  if (KC_RADIX (base_mode))
+    kc_fmtb ((te_uint)i, s_m);
+  else
+    sprintf (s_m, TE_IFMT, i);
+  ob_puts (s_m);
+  ob_putc ('\n');
+  }
+
+/*===========================================================================
+
+  kc_fmtr
+
+  Format a result in FRAC mode: p/q, or just p if q is 1, or as a 
+  decimal after a ~ if it isn't a fraction, so that a result that has 
+  been rounded, even to a whole number, can't be taken for exact
+
+===========================================================================*/
+void kc_fmtr (r)
+rat_num *r;
+  {
+  char s_m[MAX_NUM_STR];
+  char *p;
+  if (r->q == 0)
+    {
+    kc_fmts (r->d, s_m);
+    for (p = s_m; *p == ' '; p++)
+      ;
+    ob_putc ('~');
+    ob_puts (p);
+    ob_putc ('\n');
+    return;
+    }
+  sprintf (s_m, TE_IFMT, r->p);
+  ob_puts (s_m);
+  if (r->q != 1)
+    {
+    sprintf (s_m, TE_IFMT, r->q);
+    ob_putc ('/');
+    ob_puts (s_m);
+    }
+  ob_putc ('\n');
+  }
+
+/*===========================================================================
+
+  kc_fmtx
+
+  Format a result in FIXED mode, with as many decimal places as its 
+  fraction bits resolve, or in the output base, if that isn't decimal
+
+===========================================================================*/
+void kc_fmtx (a, d)
+te_int a;
+double d;
+  {
+  char s_m[MAX_NUM_STR];
+  if (KC_RADIX (base_mode))
+    {
+    kc_fmt (d);
+    return;
+    }
+  fix_fmt (a, s_m);
+  ob_puts (s_m);
+  ob_putc ('\n');
+  }
+
+#ifdef LINUX
+/*===========================================================================
+
+  kc_fmtdd
+
+  Format a double-double result for display, to as many as DD_SIGFIG 
+  digits
+
+===========================================================================*/
+void kc_fmtdd (hi, lo)
+double hi;
+double lo;
+  {
+  char s_m[MAX_NUM_STR];
+  dd_real x;
+  if (KC_RADIX (base_mode))
+    {
+    kc_fmt (hi);
+    return;
+    }
+  x.hi = hi;
+  x.lo = lo;
+  dd_fmt (&x, sigfig, s_m);
+  kc_strz (s_m);
+  ob_puts (s_m);
+  ob_putc ('\n');
+  }
+
+/*===========================================================================
+
+  kc_fmtbig
+
+  Format a result in BIG mode, with all its digits, in decimal whatever 
+  the base
+
+===========================================================================*/
+void kc_fmtbig (a)
+big_num *a;
+  {
+  char *s = malloc (big_len (a) + 1);
+  if (!s)
+    {
+    printf ("%s\r\n", kc_strerror (E_NOMEM));
+    return;
+    }
+  big_fmt (a, s);
+  ob_puts (s);
+  ob_putc ('\n');
+  free (s);
+  }
+#endif
+
+/*===========================================================================
+
+  kc_fmtv
+
+  Format a vector for display: its first VEC_SHOW elements, and its 
+  length if there are more.
+
+===========================================================================*/
+void kc_fmtv (v)
+te_vec *v;
+  {
+  char s_m[MAX_NUM_STR + 20];
+  char *p;
+  int i;
+  ob_putc ('[');
+  for (i = 0; i < v->n && i < VEC_SHOW; i++)
+    {
+    if (i) ob_puts (", ");
+    if (v->v[i] < 0) ob_putc ('-');
+    kc_fmts (fabs (v->v[i]), s_m);
+    for (p = s_m; *p == ' '; p++)
+      ;
+    ob_puts (p);
+    }
+  if (v->n > VEC_SHOW)
+    {
+    sprintf (s_m, ", ... (%d elements)", v->n);
+    ob_puts (s_m);
+    }
+  ob_puts ("]\n");
+  }
+
 /*===========================================================================
 
   kc_do_line
@@ -492,12 +1316,47 @@ int nvars;
     if (kc_do_assign (expr, vars, nvars) == 0)
       {  
       int error = 0;
-      double result = kc_eval (expr, &error, vars, nvars);
-      if (!error)
+      te_vec *vec;
+      double lo;
+      rat_num rv;
+      double result = kc_eval (expr, &error, vars, nvars, &vec, &lo, &rv, 1);
+      if (!error && vec)
+        {
+        kc_fmtv (vec);
+        te_vfree (vec);
+        }
+      else if (!error)
 	{
 	/* Format properly, strip trailing zeros after the point, etc */
+#ifdef LINUX
+        if (big_mode)
+          kc_fmtbig (kc_bnum);
+        else
+#endif
+        if (int_mode)
+          kc_fmti (rv.p);
+        else if (fix_mode && rv.q < 0)
+          kc_fmtx (rv.p, result);
+        else if (base_mode == BM_FRAC)
+          kc_fmtr (&rv);
+        else
+#ifdef LINUX
+        if (dd_mode)
+          kc_fmtdd (result, lo);
+        else
+#endif
         kc_fmt (result);
 	ans = result;
+#ifdef LINUX
+        kc_find_sym ("ANS")->lo = lo;
+        big_free (kc_find_sym ("ANS")->big);
+        kc_find_sym ("ANS")->big = kc_bnum;
+        kc_bnum = 0;
+#endif
+        kc_find_sym ("ANS")->ival = rv.p;
+        kc_find_sym ("ANS")->rden = base_mode == BM_FRAC 
+          ? RAT_DEN (&rv) : rv.q;
+        te_touch (symtab, nsyms, kc_find_sym ("ANS"));
 	}
       }
     }
@@ -512,16 +1371,18 @@ int nvars;
 ===========================================================================*/
 void kc_do_repl ()
   {
-  char line [128];
+  char *line;
+  int size = 128;
   int done = 0;
-  printf (BANNER1);
-  printf (BANNER2);
-  printf ("\r\n");
+  if ((line = malloc (size)) == 0) return;
+  ob_puts (BANNER1);
+  ob_puts (BANNER2);
+  ob_puts ("\r\n");
   while (!done)
     {
-    printf ("kcalc> ");
-    fflush (stdout);
-    if (term_g_line (line, sizeof (line) - 1) == 0)
+    ob_puts ("kcalc> ");
+    ob_flush ();
+    if (term_g_buf (&line, &size) == 0)
       {
       kc_toupper (line);
       if (strncmp (line, "QUIT", 4) == 0) done = 1;
@@ -530,12 +1391,14 @@ void kc_do_repl ()
       done = 1;
     if (!done)
       {
-      printf ("\r"); /* Need this with a terminal, if CR does not imply LF */
+      ob_putc ('\r'); /* Need this with a terminal, if CR does not imply LF */
+      ob_flush ();
       kc_do_expr (line, symtab, nsyms); 
-      printf ("\r\n");
       fflush (stdout);
+      ob_puts ("\r\n");
       }
     }
+  free (line);
   }
 
 
@@ -554,13 +1417,44 @@ double value;
   int i = nsyms;
   if (i >= SYMTAB_MAX - 1) return E_MSYMS;
   symtab[i].name = _strdup (name);
+  cp_add (name, 0);
   symtab[i].type = TE_VARIABLE;
   symtab[i].num = value;
+#ifdef LINUX
+  symtab[i].lo = 0.0;
+#endif
+  symtab[i].ival = te_toint (value);
+  symtab[i].rden = 0;
   symtab[i].address = &(symtab[i].num);
   nsyms++;
   return 0;
   }
 
+/*===========================================================================
+
+  kc_new_sym
+
+  Start an entry in the symtab for one of the built-in names, with cp 
+  as for cp_add(). Returns 0, having said so, if there is no room for it,
+  which means that SYMTAB_MAX in config.h is too small.
+
+===========================================================================*/
+static te_variable *kc_new_sym (name, cp)
+char *name;
+int cp;
+  {
+  te_variable *s = &symtab[nsyms];
+  if (nsyms >= SYMTAB_MAX - 1)
+    {
+    printf ("%s: can't add %s\r\n", kc_strerror (E_MSYMS), name);
+    return 0;
+    }
+  s->name = _strdup (name);
+  cp_add (name, cp);
+  nsyms++;
+  return s;
+  }
+
 /*===========================================================================
 
   kc_add_var
@@ -568,61 +1462,154 @@ double value;
   Add a variable with global scope to the symtab. Only used for "ans"
   at present.
 
-  At present, this is only called at startup, so no need to check errors.
-
 ===========================================================================*/
 void kc_add_var (name, address)
 char *name;
 void *address;
   {
-  int i = nsyms;
-  symtab[i].name = _strdup (name);
-  symtab[i].type = TE_VARIABLE;
-  symtab[i].address = address;
-  nsyms++;
-  /** TODO check overflow */
+  te_variable *s = kc_new_sym (name, 0);
+  if (!s) return;
+  s->type = TE_VARIABLE;
+  s->address = address;
   }
 
 /*===========================================================================
 
   kc_add_1func
 
-  Add a one-arg function to the symtab
+  Add a one-arg function to the symtab. flags is TE_FLAG_MEMO if the
+  function is expensive enough that its results are worth caching, or zero.
+
+===========================================================================*/
+void kc_add_1func (name, address, flags)
+char *name;
+void *address;
+int flags;
+  {
+  te_variable *s = kc_new_sym (name, 1);
+  if (!s) return;
+  s->type = TE_FUNC1 | TE_FLAG_PURE | flags;
+  s->address = address;
+  }
+
+/*===========================================================================
+
+  kc_add_bfunc
 
-  At present, this is only called at startup, so no need to check errors.
+  Add a one-arg function that has a block version (see vmath.h) to the
+  symtab. flags is as for kc_add_1func.
 
 ===========================================================================*/
-void kc_add_1func (name, address)
+void kc_add_bfunc (name, address, block, flags)
 char *name;
 void *address;
+void *block;
+int flags;
   {
   int i = nsyms;
-  symtab[i].name = _strdup (name);
-  symtab[i].type = TE_FUNC1 | TE_FLAG_PURE;
-  symtab[i].address = address;
-  /** TODO check overflow */
-  nsyms++;
+  kc_add_1func (name, address, flags | TE_FLAG_BLK);
+  if (nsyms > i) symtab[i].context = block;
   }
 
 /*===========================================================================
 
   kc_add_2func
 
-  Add a two-arg function to the symtab
+  Add a two-arg function to the symtab. flags is TE_FLAG_MEMO if the
+  function is expensive enough that its results are worth caching, or zero.
+
+===========================================================================*/
+void kc_add_2func (name, address, flags)
+char *name;
+void *address;
+int flags;
+  {
+  te_variable *s = kc_new_sym (name, 1);
+  if (!s) return;
+  s->type = TE_FUNC2 | TE_FLAG_PURE | flags;
+  s->address = address;
+  }
+
+/*===========================================================================
+
+  kc_add_loop
 
-  At present, this is only called at startup, so no need to check errors.
+  Add a function of an expression, like SUM, to the symtab. arity is the
+  number of arguments other than the variable. If fold is not 0, the
+  function can also be given just a vector, like SUM(v), and fold
+  combines its elements.
 
 ===========================================================================*/
-void kc_add_2func (name, address)
+void kc_add_loop (name, address, arity, fold)
 char *name;
 void *address;
+int arity;
+void *fold;
   {
-  int i = nsyms;
-  symtab[i].name = _strdup (name);
-  symtab[i].type = TE_FUNC2 | TE_FLAG_PURE;
-  symtab[i].address = address;
-  /** TODO check overflow */
-  nsyms++;
+  te_variable *s = kc_new_sym (name, 1);
+  if (!s) return;
+  s->type = (TE_FUNC0 + arity) | TE_FLAG_PURE | TE_FLAG_LOOP;
+  s->address = address;
+  s->context = fold;
+  }
+
+/*===========================================================================
+
+  kc_add_red
+
+  Add a function that reduces vectors to a number, like MIN, to the 
+  symtab. map is applied to each element (or each pair of elements, if
+  arity is 2), and fold combines the results.
+
+===========================================================================*/
+void kc_add_red (name, map, fold, arity)
+char *name;
+void *map;
+void *fold;
+int arity;
+  {
+  te_variable *s = kc_new_sym (name, 1);
+  if (!s) return;
+  s->type = (TE_FUNC0 + arity) | TE_FLAG_PURE | TE_FLAG_RED;
+  s->address = map;
+  s->context = fold;
+  }
+
+/*===========================================================================
+
+  kc_add_impure
+
+  Add a two-arg function that gives random numbers, like UNIFORM, to the
+  symtab. Unlike other functions, it isn't pure, so a call with constant
+  arguments is not worked out when the expression is compiled.
+
+===========================================================================*/
+void kc_add_impure (name, address)
+char *name;
+void *address;
+  {
+  te_variable *s = kc_new_sym (name, 1);
+  if (!s) return;
+  s->type = TE_FUNC2;
+  s->address = address;
+  }
+
+/*===========================================================================
+
+  kc_add_gen
+
+  Add a function that makes a vector, like LINSPACE, to the symtab.
+
+===========================================================================*/
+void kc_add_gen (name, address, arity)
+char *name;
+void *address;
+int arity;
+  {
+  te_variable *s = kc_new_sym (name, 1);
+  if (!s) return;
+  s->type = (TE_FUNC0 + arity) | TE_FLAG_GEN;
+  s->address = address;
   }
 
 /*===========================================================================
@@ -663,6 +1650,31 @@ void kc_clear_syms ()
     te_variable *sym = &symtab[i];
     if (sym->name) free (sym->name);
     sym->name = 0;
+    if ((sym->type & TE_FLAG_DEFN) && sym->context) te_free (sym->context);
+    if (sym->type & TE_FLAG_VEC) te_vfree (sym->context);
+    sym->context = 0;
+#ifdef LINUX
+    big_free (sym->big);
+    sym->big = 0;
+#endif
+    }
+  }
+
+/*===========================================================================
+
+  kc_unvec
+
+  Make a variable that holds a vector into an ordinary variable
+
+===========================================================================*/
+static void kc_unvec (te)
+te_variable *te;
+  {
+  if (te->type & TE_FLAG_VEC)
+    {
+    te_vfree (te->context);
+    te->context = 0;
+    te->type = TE_VARIABLE;
     }
   }
 
@@ -701,7 +1713,23 @@ double value;
     {
     if (TYPE_MASK (te->type) == TE_VARIABLE)
       {
-      te->num = value;
+      /* Assigning a value replaces any definition, or vector */
+      kc_unvec (te);
+      if (te->type & TE_FLAG_DEFN)
+        {
+        te_free (te->context);
+        te->context = 0;
+        te->type = TE_VARIABLE;
+        }
+      *(double *)te->address = value;
+#ifdef LINUX
+      te->lo = 0.0;
+      big_free (te->big);
+      te->big = 0;
+#endif
+      te->ival = te_toint (value);
+      te->rden = 0;
+      te_touch (symtab, nsyms, te);
       }
     }
   else
@@ -710,9 +1738,17 @@ double value;
     if (te)
       {
       te->name = _strdup (name);
+      cp_add (name, 0);
       te->type = TE_VARIABLE;
       te->address = &(te->num);
+      te->context = 0;
       te->num = value;
+#ifdef LINUX
+      te->lo = 0.0;
+      te->big = 0;
+#endif
+      te->ival = te_toint (value);
+      te->rden = 0;
       }
     else
       {
@@ -723,6 +1759,104 @@ double value;
   }
 
 
+/*===========================================================================
+
+  kc_bind
+
+  Assign a value to a variable, as kc_set_num() does, and return the
+  variable so that commands that step a variable through a range of
+  values can update it directly.
+
+===========================================================================*/
+te_variable *kc_bind (name, value)
+char *name;
+double value;
+  {
+  te_variable *te;
+  kc_set_num (name, value);
+  te = kc_find_sym (name);
+  if (te && TYPE_MASK (te->type) == TE_VARIABLE) return te;
+  if (te) printf ("%s\r\n", kc_strerror (E_NOIDENT));
+  return 0;
+  }
+
+/*===========================================================================
+
+  kc_set_vec
+
+  Assign a vector to a variable, creating the variable if necessary. The
+  variable takes over the vector, which is freed if it can't be assigned.
+
+===========================================================================*/
+void kc_set_vec (name, vec)
+char *name;
+te_vec *vec;
+  {
+  te_variable *te = kc_bind (name, 0.0);
+  if (te && te->address != &(te->num))
+    {
+    /* Variables like ANS, that are bound to program storage, can only
+       be numbers */
+    printf ("%s\r\n", kc_strerror (E_VECTOR));
+    te = 0;
+    }
+  if (!te) 
+    {
+    te_vfree (vec);
+    return;
+    }
+  te->type = TE_VARIABLE | TE_FLAG_VEC;
+  te->context = vec;
+  te_touch (symtab, nsyms, te);
+  }
+
+/*===========================================================================
+
+  kc_set_defn
+
+  Define a variable by a formula, creating the variable if necessary. 
+  The formula is compiled now, but only evaluated when the variable is
+  used, and then only if something it depends on has changed. 
+
+===========================================================================*/
+void kc_set_defn (name, expr)
+char *name;
+char *expr;
+  {
+  int error_pos = 0;
+  int rt_error = 0;
+  int created = 0;
+  te_variable *te = kc_find_sym (name);
+  if (!te)
+    {
+    kc_set_num (name, 0.0);
+    te = kc_find_sym (name);
+    if (!te) return; /* kc_set_num will have displayed the error */
+    created = 1;
+    }
+  if (TYPE_MASK (te->type) != TE_VARIABLE || te->address != &(te->num))
+    {
+    /* Functions, and variables like ANS that are bound to program 
+       storage, can't be redefined. */
+    printf ("%s\r\n", kc_strerror (E_NOIDENT));
+    return;
+    }
+
+  kc_unvec (te);
+  te_define (expr, &error_pos, &rt_error, te, symtab, nsyms);
+  if (rt_error)
+    {
+    printf ("%s", kc_strerror (rt_error));
+    if (error_pos > 0) printf (" at position %d", error_pos);
+    printf ("\r\n");
+    if (created)
+      {
+      free (te->name);
+      te->name = 0;
+      }
+    }
+  }
+
 /*===========================================================================
 
   main
@@ -732,55 +1866,76 @@ int main (argc, argv)
 int argc;
 char **argv;
   {
-  int i;
-  char line [128];
+  int i, len;
+  char *line, *p;
   kc_add_num ("PI", CONST_PI);
   kc_add_num ("E", CONST_E);
+#ifdef LINUX
+  kc_find_sym ("PI")->lo = DD_PI_LO;
+  kc_find_sym ("E")->lo = DD_E_LO;
+#endif
   kc_add_var ("ANS", &ans);
-  kc_add_1func ("ABS", fabs);
-  kc_add_1func ("ACOS", _acos);
-  kc_add_1func ("ASIN", _asin);
-  kc_add_1func ("ATAN", _atan); 
-  kc_add_2func ("ATAN2", _atan2); 
-  kc_add_1func ("CEIL", ceil); 
-  kc_add_1func ("COS", _cos); 
-  kc_add_1func ("COSH", cosh); 
-  kc_add_1func ("EXP", exp); 
-  kc_add_1func ("FLOOR", floor); 
-  kc_add_1func ("LOG", _log); 
-  kc_add_1func ("LOG10", _log10); 
-  kc_add_2func ("POW", pow); 
-  /*kc_add_1func ("FAC", fac);*/ 
-  kc_add_1func ("SIN", _sin); 
-  kc_add_1func ("SINH", sinh); 
-  kc_add_1func ("SQRT", _sqrt);
-  kc_add_1func ("TAN", _tan); 
-  kc_add_1func ("TANH", tanh); 
+  /* Each function of numbers needs a KC_ macro in kcode.h, for CODE */
+  kc_add_1func ("ABS", fabs, 0);
+  kc_add_1func ("ACOS", _acos, TE_FLAG_MEMO);
+  kc_add_1func ("ASIN", _asin, TE_FLAG_MEMO);
+  kc_add_1func ("ATAN", _atan, TE_FLAG_MEMO); 
+  kc_add_2func ("ATAN2", _atan2, TE_FLAG_MEMO); 
+  kc_add_1func ("CEIL", ceil, 0); 
+  kc_add_bfunc ("COS", _cos, _bcos, TE_FLAG_MEMO); 
+  kc_add_1func ("COSH", cosh, TE_FLAG_MEMO); 
+  kc_add_bfunc ("EXP", exp, _bexp, TE_FLAG_MEMO); 
+  kc_add_1func ("FLOOR", floor, 0); 
+  kc_add_2func ("GCD", _gcd, 0); 
+  kc_add_2func ("LCM", _lcm, 0); 
+  kc_add_bfunc ("LOG", _log, _blog, TE_FLAG_MEMO); 
+  kc_add_1func ("LOG10", _log10, TE_FLAG_MEMO); 
+  kc_add_2func ("NCR", _ncr, TE_FLAG_MEMO); 
+  kc_add_2func ("NPR", _npr, TE_FLAG_MEMO); 
+  kc_add_2func ("POW", _pow, TE_FLAG_MEMO); 
+  kc_add_1func ("FAC", _fac, TE_FLAG_MEMO); 
+  kc_add_bfunc ("SIN", _sin, _bsin, TE_FLAG_MEMO); 
+  kc_add_1func ("SINH", sinh, TE_FLAG_MEMO); 
+  kc_add_bfunc ("SQRT", _sqrt, _bsqrt, TE_FLAG_MEMO);
+  kc_add_1func ("TAN", _tan, TE_FLAG_MEMO); 
+  kc_add_1func ("TANH", tanh, TE_FLAG_MEMO); 
+  kc_add_loop ("INTEGRATE", _integr, 3, 0); 
+  kc_add_loop ("PROD", _prod, 3, _vmul); 
+  kc_add_loop ("SOLVE", _solve, 2, 0); 
+  kc_add_loop ("SUM", _sum, 3, _vadd); 
+  kc_add_red ("DOT", _vmul, _vadd, 2); 
+  kc_add_gen ("LINSPACE", _linsp, 3); 
+  kc_add_red ("MAX", te_ident, _vmax, 1); 
+  kc_add_red ("MIN", te_ident, _vmin, 1); 
+  kc_add_impure ("NORMAL", _norm); 
+  kc_add_impure ("UNIFORM", _unif); 
+  rn_start (1L, 0L);
 
   sprintf (fmt, "%%5.5g");
 
-  line [0] = 0;
+  /* The arguments, joined with spaces */
+  for (i = 1, len = 1; i < argc; i++) len += strlen (argv[i]) + 1;
+  if ((line = malloc (len)) == 0) return 1;
+  p = line;
   for (i = 1; i < argc; i++)
     {
     char *arg = argv[i];
-    int l = strlen (arg);
-    int ll = strlen (line);
-    if (ll + l + 2 < (int)sizeof (line))
-      {
 #ifndef CPM
-      _strupr (arg);
-      /* CP/M always provides ags in upper case */
+    kc_toupper (arg);
+    /* CP/M always provides ags in upper case */
 #endif
-      strcat (line, arg);
-      strcat (line, " ");
-      }
+    strcpy (p, arg);
+    p += strlen (p);
+    *p++ = ' ';
     }
+  *p = 0;
 
   if (line[0])
     kc_do_expr (line, symtab, nsyms);
   else
     kc_do_repl (); 
 
+  free (line);
   kc_clear_syms ();
   }
 
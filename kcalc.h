@@ -0,0 +1,51 @@
+/*===========================================================================
+
+  kcalc.h
+
+  Functions and data in kcalc.c that are used by the command modules.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __KCALC_H
+#define __KCALC_H
+
+/* The largest number of characters that are required to render a number
+ * in full precision. Aztec C gives about 9 digits; modern compilers much
+ * more. An integer in binary needs one character for each bit of a 
+ * te_int, and two more. */
+#ifdef LINUX
+#define MAX_NUM_STR 72
+#else
+#define MAX_NUM_STR 36
+#endif
+
+/* The main symbol table, and the number of entries in it, including
+   empty ones */
+extern te_variable symtab[];
+extern int nsyms;
+
+/* Get a textual represetation of an error code. args: int code */
+char *kc_strerror ();
+
+/* Convert a string to upper case, except in double quotes. args: char *s */
+void kc_toupper ();
+
+/* Trim whitespace on the right. args: char *s */
+void kc_trim_right ();
+
+/* Format a number for display, as kc_fmt() does, but into a buffer of
+   at least MAX_NUM_STR characters. args: double num, char *buff */
+void kc_fmts ();
+
+/* Assign a value to a variable, creating it if necessary, and return
+   it so that it can be updated in place. args: char *name, double value.
+   ret: the variable, or 0 (having displayed an error message) if it can't
+   be assigned */
+te_variable *kc_bind ();
+
+/* Assign a vector to a variable, creating it if necessary. The variable 
+   takes over the vector. args: char *name, te_vec *vec */
+void kc_set_vec ();
+
+#endif
@@ -0,0 +1,104 @@
+/*===========================================================================
+
+  kcode.h
+
+  For C and C++ programs that use functions written by the CODE command.
+  Include this before the functions, and link with funcs.o and
+  tinyexpr.o, and the modules they use (compat.o, fix.o, memo.o, rat.o,
+  strutil.o and vmath.o, and on Linux big.o and dd.o), built as for
+  kcalc.
+
+  Errors -- division by zero, the square root of a negative number, and
+  so on -- are raised as they are in kcalc, by longjmp (err_jump, code),
+  with the codes in tinyexpr.h, so a program must set err_jump with
+  setjmp() before calling a function that can fail. Angles are in
+  radians, unless angle_mode is set to AM_DEG.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __KCODE_H
+#define __KCODE_H
+
+#include "math.h"
+#include "setjmp.h"
+
+#ifdef __cplusplus
+#define KC_ANSI
+#endif
+#ifdef __STDC__
+#define KC_ANSI
+#endif
+
+#ifdef KC_ANSI
+#define KC_P(args) args
+#else
+#define KC_P(args) ()
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern jmp_buf err_jump;
+extern int angle_mode;
+
+double te_div KC_P((double, double));
+double te_mod KC_P((double, double));
+double te_and KC_P((double, double));
+double te_or KC_P((double, double));
+double te_xor KC_P((double, double));
+double te_shl KC_P((double, double));
+double te_shr KC_P((double, double));
+
+double _acos KC_P((double));
+double _asin KC_P((double));
+double _atan KC_P((double));
+double _atan2 KC_P((double, double));
+double _cos KC_P((double));
+double _fac KC_P((double));
+double _gcd KC_P((double, double));
+double _lcm KC_P((double, double));
+double _log KC_P((double));
+double _log10 KC_P((double));
+double _ncr KC_P((double, double));
+double _npr KC_P((double, double));
+double _sin KC_P((double));
+double _sqrt KC_P((double));
+double _tan KC_P((double));
+double _unif KC_P((double, double));
+double _norm KC_P((double, double));
+
+#ifdef __cplusplus
+}
+#endif
+
+/* The functions that kcalc knows by each name (see main() in kcalc.c) */
+#define KC_ABS(x) fabs (x)
+#define KC_ACOS(x) _acos (x)
+#define KC_ASIN(x) _asin (x)
+#define KC_ATAN(x) _atan (x)
+#define KC_ATAN2(y, x) _atan2 (y, x)
+#define KC_CEIL(x) ceil (x)
+#define KC_COS(x) _cos (x)
+#define KC_COSH(x) cosh (x)
+#define KC_EXP(x) exp (x)
+#define KC_FAC(x) _fac (x)
+#define KC_FLOOR(x) floor (x)
+#define KC_GCD(a, b) _gcd (a, b)
+#define KC_LCM(a, b) _lcm (a, b)
+#define KC_LOG(x) _log (x)
+#define KC_LOG10(x) _log10 (x)
+#define KC_NCR(n, k) _ncr (n, k)
+#define KC_NPR(n, k) _npr (n, k)
+#define KC_POW(x, y) _pow (x, y)
+#define KC_SIN(x) _sin (x)
+#define KC_SINH(x) sinh (x)
+#define KC_SQRT(x) _sqrt (x)
+#define KC_TAN(x) _tan (x)
+#define KC_TANH(x) tanh (x)
+#define KC_UNIFORM(a, b) _unif (a, b)
+#define KC_NORMAL(m, sd) _norm (m, sd)
+
+#endif
+
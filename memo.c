@@ -0,0 +1,132 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  memo.c
+
+  A direct-mapped cache of the results of expensive, pure function
+  calls, keyed on the function, the exact bit patterns of its arguments,
+  and the angle mode. Each new result simply replaces whatever was in
+  its slot, so the cache takes a fixed amount of memory, set by
+  MEMO_SIZE in config.h. Only functions flagged TE_FLAG_MEMO are cached 
+  -- for cheap functions, computing the hash costs more than the call.
+  Results worked out to fewer digits (see fn_prec in funcs.h) are kept
+  apart from the rest, as if they were in another angle mode.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "tinyexpr.h"
+#include "memo.h"
+#include "funcs.h"
+#include "config.h"
+#include "compat.h"
+
+typedef struct memo_ent
+  {
+  void *fn; /* Zero if the slot is empty */
+  int mode;
+  double a;
+  double b;
+  double result;
+  } memo_ent;
+
+static memo_ent memo_tab[MEMO_SIZE];
+
+/* The angle mode, and the digits that results need */
+#define MODE (angle_mode + 2 * fn_prec)
+
+int memo_on = 0;
+long memo_hits = 0;
+long memo_miss = 0;
+
+/*
+  memo_hash
+  Work out which slot a function call belongs in 
+*/
+static int memo_hash (fn, a, b)
+void *fn;
+double a;
+double b;
+  {
+  register unsigned h = (unsigned)(long)fn + MODE;
+  register int i;
+  unsigned char *p;
+
+  p = (unsigned char *)&a;
+  for (i = 0; i < (int)sizeof (double); i++)
+    h = h * 31 + p[i];
+  p = (unsigned char *)&b;
+  for (i = 0; i < (int)sizeof (double); i++)
+    h = h * 31 + p[i];
+  return (int)(h % MEMO_SIZE);
+  }
+
+/*
+  memo_same
+  Compare arguments bit-for-bit, so that (for example) -0 and 0 are 
+  kept apart.
+*/
+static int memo_same (x, y)
+double x;
+double y;
+  {
+  register int i;
+  unsigned char *p = (unsigned char *)&x;
+  unsigned char *q = (unsigned char *)&y;
+  for (i = 0; i < (int)sizeof (double); i++)
+    if (p[i] != q[i]) return 0;
+  return 1;
+  }
+
+/*
+  memo_get
+*/
+int memo_get (fn, a, b, result)
+void *fn;
+double a;
+double b;
+double *result;
+  {
+  memo_ent *e = &memo_tab[memo_hash (fn, a, b)];
+  if (e->fn == fn && e->mode == MODE 
+        && memo_same (e->a, a) && memo_same (e->b, b))
+    {
+    memo_hits++;
+    if (fn_prec) fn_fast = 1;
+    *result = e->result;
+    return 1;
+    }
+  memo_miss++;
+  return 0;
+  }
+
+/*
+  memo_put
+*/
+void memo_put (fn, a, b, result)
+void *fn;
+double a;
+double b;
+double result;
+  {
+  memo_ent *e = &memo_tab[memo_hash (fn, a, b)];
+  e->fn = fn;
+  e->mode = MODE;
+  e->a = a;
+  e->b = b;
+  e->result = result;
+  }
+
+/*
+  memo_clear
+*/
+void memo_clear ()
+  {
+  _memset (memo_tab, 0, sizeof (memo_tab));
+  memo_hits = 0;
+  memo_miss = 0;
+  }
+
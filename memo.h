@@ -0,0 +1,32 @@
+/*===========================================================================
+
+  memo.h
+
+  A small cache of the results of expensive function calls. 
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __MEMO_H
+#define __MEMO_H
+
+/* Non-zero if the cache is in use */
+extern int memo_on;
+
+/* Number of cache hits and misses since the cache was last cleared */
+extern long memo_hits;
+extern long memo_miss;
+
+/* Look up the result of a function call. 
+   args: void *fn, double a, double b, double *result. ret: non-zero if
+   found, in which case the result is stored. */
+int memo_get ();
+
+/* Store the result of a function call.
+   args: void *fn, double a, double b, double result. */
+void memo_put ();
+
+/* Empty the cache, and reset the counters. args: none. */
+void memo_clear ();
+
+#endif
@@ -0,0 +1,92 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  obuf.c
+
+  Buffered console output. On CP/M, every character written by putchar()
+  or printf() goes through the C library and a separate BDOS call,
+  which makes the console a bottleneck even at 9600 baud. This module
+  collects output and sends it a line at a time, in a single BDOS call
+  (or, on Linux, a single write()). Anything that does not end in a 
+  newline, like a prompt, or the echo of a key in the line editor, must
+  be followed by ob_flush().
+
+  Output from printf() can still be mixed with output from here, provided
+  that each line is completed (or flushed) before switching.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "obuf.h"
+#include "config.h"
+#ifdef LINUX
+#include <unistd.h>
+#endif
+
+/* One extra byte for the BDOS string terminator */
+static char ob_buf[OB_SIZE + 1];
+static int ob_len = 0;
+
+/*
+  ob_flush
+*/
+void ob_flush ()
+  {
+#ifdef CPM
+  char *p, *q;
+#endif
+  if (ob_len == 0) return;
+  /* Anything written by stdio must come out first */
+  fflush (stdout);
+#ifdef CPM
+  /* BDOS function 9 prints up to a '$', so any '$' in the output has
+     to be sent separately. */
+  ob_buf[ob_len] = '$';
+  p = ob_buf;
+  for (;;)
+    {
+    for (q = p; *q != '$'; q++)
+      ;
+    if (q > p) bdos (9, p);
+    if (q == ob_buf + ob_len) break;
+    bdos (2, '$');
+    p = q + 1;
+    }
+#else
+  if (write (1, ob_buf, ob_len) < 0) 
+    {
+    /* Nothing useful can be done about a console error */
+    }
+#endif
+  ob_len = 0;
+  }
+
+/*
+  ob_putc
+*/
+void ob_putc (c)
+int c;
+  {
+#ifdef CPM
+  /* Make sure every newline has a carriage return, as the console 
+     output of the C library would */
+  if (c == '\n' && (ob_len == 0 || ob_buf[ob_len - 1] != '\r'))
+    ob_putc ('\r');
+#endif
+  if (ob_len == OB_SIZE) ob_flush ();
+  ob_buf[ob_len++] = c;
+  if (c == '\n') ob_flush ();
+  }
+
+/*
+  ob_puts
+*/
+void ob_puts (s)
+char *s;
+  {
+  while (*s) ob_putc (*s++);
+  }
+
@@ -0,0 +1,23 @@
+/*===========================================================================
+
+  obuf.h
+
+  Buffered console output
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __OBUF_H
+#define __OBUF_H
+
+/* Add a character to the output buffer, sending the buffer to the 
+   console at the end of a line. args: int c */
+void ob_putc ();
+
+/* Add a string to the output buffer. args: char *s */
+void ob_puts ();
+
+/* Send whatever is in the buffer to the console. args: none */
+void ob_flush ();
+
+#endif
@@ -0,0 +1,374 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  rat.c
+
+  Fractions, for FRAC mode. A number is p/q in lowest terms, p and q
+  being te_ints, and the common factors are found by the binary GCD
+  algorithm, which needs only shifts and subtraction -- much cheaper on
+  a Z80 than the divisions of Euclid's. Each operation checks for
+  overflow, and a result too big to be a fraction of te_ints becomes an
+  ordinary double instead, as do the results of functions like SQRT.
+  Since the operands are kept in lowest terms, and factors are cancelled
+  before multiplying, that only happens when the result itself won't
+  fit, not when some intermediate product won't.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "math.h"
+#include "setjmp.h"
+#include "tinyexpr.h"
+#include "config.h"
+#include "rat.h"
+#include "funcs.h"
+
+extern jmp_buf err_jump;
+
+/*
+  rmag -- the magnitude of a, which can be -TE_IMIN
+*/
+static te_uint rmag (a)
+te_int a;
+  {
+  return a < 0 ? 0 - (te_uint)a : (te_uint)a;
+  }
+
+/*
+  rgcd -- the greatest common divisor of a and b, or the other if one is
+  zero. Whole numbers have a denominator of 1, so that is worth checking
+  for first. One division brings the larger down to the size of the 
+  smaller, which saves many steps of the binary algorithm when, as is
+  usual here, they are of very different sizes
+*/
+static te_uint rgcd (a, b)
+te_uint a;
+te_uint b;
+  {
+  te_uint t;
+  int k = 0;
+  if (a == 0) return b;
+  if (b == 0) return a;
+  if (a == 1 || b == 1) return 1;
+  if (a > b)
+    {
+    t = a;
+    a = b;
+    b = t;
+    }
+  if ((b %= a) == 0) return a;
+  while (((a | b) & 1) == 0)
+    {
+    a >>= 1;
+    b >>= 1;
+    k++;
+    }
+  while ((a & 1) == 0) a >>= 1;
+  do
+    {
+    while ((b & 1) == 0) b >>= 1;
+    if (a > b)
+      {
+      t = a;
+      a = b;
+      b = t;
+      }
+    b -= a;
+    }
+  while (b);
+  return a << k;
+  }
+
+/*
+  cmul -- *r = a * b, returning zero if that overflows
+*/
+static int cmul (a, b, r)
+te_int a;
+te_int b;
+te_int *r;
+  {
+  te_uint ua = rmag (a), ub = rmag (b);
+  if (ua && ub > (te_uint)TE_IMAX / ua) return 0;
+  *r = (a < 0) != (b < 0) ? -(te_int)(ua * ub) : (te_int)(ua * ub);
+  return 1;
+  }
+
+/*
+  cadd -- *r = a + b, returning zero if that overflows
+*/
+static int cadd (a, b, r)
+te_int a;
+te_int b;
+te_int *r;
+  {
+  te_int s = (te_int)((te_uint)a + (te_uint)b);
+  if ((a < 0) == (b < 0) && (s < 0) != (a < 0)) return 0;
+  *r = s;
+  return 1;
+  }
+
+/*
+  rinex -- r is d, which isn't a fraction
+*/
+static void rinex (r, d)
+rat_num *r;
+double d;
+  {
+  r->p = 0;
+  r->q = 0;
+  r->d = d;
+  }
+
+/*
+  rnorm -- r = p/q in lowest terms, where q > 0
+*/
+static void rnorm (p, q, r)
+te_int p;
+te_int q;
+rat_num *r;
+  {
+  te_uint g = q == 1 ? 1 : rgcd (rmag (p), (te_uint)q);
+  if (g > 1)
+    {
+    p /= (te_int)g;
+    q /= (te_int)g;
+    }
+  r->p = p;
+  r->q = q;
+  }
+
+double rat_dbl (a)
+rat_num *a;
+  {
+  return a->q ? (double)a->p / (double)a->q : a->d;
+  }
+
+void rat_add (a, b, r)
+rat_num *a;
+rat_num *b;
+rat_num *r;
+  {
+  te_int g, x, y, p, q;
+  if (a->q && a->q == b->q)
+    {
+    /* Common when adding whole numbers, and cheaper */
+    if (cadd (a->p, b->p, &p))
+      {
+      rnorm (p, a->q, r);
+      return;
+      }
+    }
+  else if (a->q && b->q)
+    {
+    g = (te_int)rgcd ((te_uint)a->q, (te_uint)b->q);
+    if (cmul (a->p, b->q / g, &x) && cmul (b->p, a->q / g, &y)
+         && cadd (x, y, &p) && cmul (a->q / g, b->q, &q))
+      {
+      rnorm (p, q, r);
+      return;
+      }
+    }
+  rinex (r, rat_dbl (a) + rat_dbl (b));
+  }
+
+void rat_sub (a, b, r)
+rat_num *a;
+rat_num *b;
+rat_num *r;
+  {
+  rat_num nb;
+  nb = *b;
+  if (nb.q && nb.p != TE_IMIN)
+    nb.p = -nb.p;
+  else
+    rinex (&nb, -rat_dbl (b));
+  rat_add (a, &nb, r);
+  }
+
+void rat_mul (a, b, r)
+rat_num *a;
+rat_num *b;
+rat_num *r;
+  {
+  te_int g1, g2, p, q;
+  if (a->q && b->q)
+    {
+    g1 = (te_int)rgcd (rmag (a->p), (te_uint)b->q);
+    g2 = (te_int)rgcd (rmag (b->p), (te_uint)a->q);
+    if (cmul (a->p / g1, b->p / g2, &p)
+         && cmul (a->q / g2, b->q / g1, &q))
+      {
+      rnorm (p, q, r);
+      return;
+      }
+    }
+  rinex (r, rat_dbl (a) * rat_dbl (b));
+  }
+
+void rat_div (a, b, r)
+rat_num *a;
+rat_num *b;
+rat_num *r;
+  {
+  rat_num rb;
+  if (rat_dbl (b) == 0) longjmp (err_jump, E_DIVZ);
+  if (b->q && b->p != TE_IMIN)
+    {
+    rb.p = b->p < 0 ? -b->q : b->q;
+    rb.q = b->p < 0 ? -b->p : b->p;
+    rat_mul (a, &rb, r);
+    return;
+    }
+  rinex (r, rat_dbl (a) / rat_dbl (b));
+  }
+
+void rat_mod (a, b, r)
+rat_num *a;
+rat_num *b;
+rat_num *r;
+  {
+  rat_num t;
+  double x = rat_dbl (a), y = rat_dbl (b);
+  rat_div (a, b, &t);
+  if (t.q)
+    {
+    /* a - trunc (a/b) * b */
+    t.p /= t.q;
+    t.q = 1;
+    rat_mul (&t, b, &t);
+    rat_sub (a, &t, r);
+    if (r->q) return;
+    }
+  rinex (r, fmod (x, y));
+  }
+
+/*
+  rpow -- r = a to the power n, where a is a fraction, returning zero if
+  that overflows. A power of a fraction in lowest terms is in lowest 
+  terms.
+*/
+static int rpow (a, n, r)
+rat_num *a;
+te_int n;
+rat_num *r;
+  {
+  te_int p = 1, q = 1, xp = a->p, xq = a->q;
+  if (n < 0)
+    {
+    if (xp == 0) longjmp (err_jump, E_DIVZ);
+    if (xp == TE_IMIN || n == TE_IMIN) return 0;
+    n = -n;
+    xp = a->p < 0 ? -a->q : a->q;
+    xq = a->p < 0 ? -a->p : a->p;
+    }
+  for (;;)
+    {
+    if ((n & 1) && (!cmul (p, xp, &p) || !cmul (q, xq, &q))) return 0;
+    if ((n >>= 1) == 0) break;
+    if (!cmul (xp, xp, &xp) || !cmul (xq, xq, &xq)) return 0;
+    }
+  r->p = p;
+  r->q = q;
+  return 1;
+  }
+
+void rat_pow (a, b, r)
+rat_num *a;
+rat_num *b;
+rat_num *r;
+  {
+  if (a->q && b->q == 1 && rpow (a, b->p, r)) return;
+  rinex (r, _pow (rat_dbl (a), rat_dbl (b)));
+  }
+
+/*
+  The convergents of the continued fraction for d, until one is exactly
+  d (as a double), or has too large a denominator. The limit is what
+  stops PI from being taken for a fraction: the best approximations
+  with small denominators are still much further from an irrational
+  number than a double can tell apart. A double of 2^53 or more might
+  already have been rounded to a whole number, so it isn't taken for
+  one.
+*/
+void rat_of (d, r)
+double d;
+rat_num *r;
+  {
+  te_int h0 = 0, h1 = 1, k0 = 1, k1 = 0, a, h, k;
+  double x = d, f;
+  int i;
+  rinex (r, d);
+  if (d != d || fabs (d) >= 9007199254740992.0) return;
+  for (i = 0; i < 64; i++)
+    {
+    f = floor (x);
+    if (fabs (f) >= -(double)TE_IMIN) return;
+    a = (te_int)f;
+    if (!cmul (a, h1, &h) || !cadd (h, h0, &h)) return;
+    if (!cmul (a, k1, &k) || !cadd (k, k0, &k)) return;
+    if (k > FRAC_QMAX) return;
+    if ((double)h / (double)k == d)
+      {
+      r->p = h;
+      r->q = k;
+      return;
+      }
+    if (x == f) return;
+    x = 1.0 / (x - f);
+    h0 = h1;
+    h1 = h;
+    k0 = k1;
+    k1 = k;
+    }
+  }
+
+/*
+  ratoi -- the decimal number from s up to end as a fraction, returning 
+  zero if it won't fit
+*/
+static int ratoi (s, end, r)
+char *s;
+char *end;
+rat_num *r;
+  {
+  te_int p = 0, q = 1;
+  int e = 0, esign = 1, point = 0;
+  for (; s < end && *s != 'e' && *s != 'E'; s++)
+    {
+    if (*s == '.')
+      {
+      point = 1;
+      continue;
+      }
+    if (!cmul (p, (te_int)10, &p) || !cadd (p, (te_int)(*s - '0'), &p))
+      return 0;
+    if (point && !cmul (q, (te_int)10, &q)) return 0;
+    }
+  if (s < end)
+    {
+    s++;
+    if (*s == '-' || *s == '+') esign = *s++ == '-' ? -1 : 1;
+    for (; s < end; s++)
+      {
+      e = e * 10 + *s - '0';
+      if (e > TE_IBITS) return 0;
+      }
+    }
+  for (; e > 0; e--)
+    if (!cmul (esign > 0 ? p : q, (te_int)10, esign > 0 ? &p : &q))
+      return 0;
+  rnorm (p, q, r);
+  return 1;
+  }
+
+void rat_atof (s, end, d, r)
+char *s;
+char *end;
+double d;
+rat_num *r;
+  {
+  if (!ratoi (s, end, r)) rinex (r, d);
+  }
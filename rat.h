@@ -0,0 +1,59 @@
+/*===========================================================================
+
+  rat.h
+
+  Fractions, for FRAC mode: a number is held as p/q, with q positive and
+  no common factor, so that results like 1/3 + 1/6 are exact. Include
+  tinyexpr.h first, for te_int.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __RAT_H
+#define __RAT_H
+
+/* p/q, or, if q is zero, a number that isn't a fraction (because it is
+   irrational, like SQRT(2), or because p or q would be too big for a
+   te_int), whose value as a double is d */
+typedef struct rat_num
+  {
+  te_int p;
+  te_int q;
+  double d;
+  } rat_num;
+
+/* The rden (see te_variable) of a number that was worked out in FRAC 
+   mode and isn't a fraction, so that it is not taken for one later, as
+   a number set outside FRAC mode may be (see rat_of()); and the rden of
+   a rat_num */
+#define RAT_INEX ((te_int)-1)
+#define RAT_DEN(r) ((r)->q ? (r)->q : RAT_INEX)
+
+/* r = a + b, a - b, a * b, a / b, and the remainder of a / b, as fmod()
+   gives it. args: rat_num *a, rat_num *b, rat_num *r. r may be the same
+   as a or b. Division by zero raises E_DIVZ */
+void rat_add ();
+void rat_sub ();
+void rat_mul ();
+void rat_div ();
+void rat_mod ();
+
+/* r = a to the power b, which is exact if b is a whole number.
+   args as for rat_add() */
+void rat_pow ();
+
+/* The value of a fraction as a double. args: rat_num *a */
+double rat_dbl ();
+
+/* A double as a fraction, if it is one with a denominator no larger
+   than FRAC_QMAX; otherwise r is marked as not a fraction.
+   args: double d, rat_num *r */
+void rat_of ();
+
+/* Convert the decimal number from s up to end, which _strtod() has
+   already accepted and found to be d, exactly. args: char *s, char *end,
+   double d, rat_num *r */
+void rat_atof ();
+
+#endif
+
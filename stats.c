@@ -0,0 +1,126 @@
+/*===========================================================================
+
+  kcalc-cpm
+
+  stats.c
+
+  Running statistics over a stream of numbers, in constant memory. The
+  numbers are added a block at a time. The mean and variance of a block
+  are found in two passes, the mean and then the squared differences 
+  from it, which does not suffer the cancellation that comes from 
+  subtracting a sum of squares, and the sum by Kahan's compensated 
+  summation. Blocks, and whole accumulators, are combined by the 
+  pairwise formulae of Chan, Golub and LeVeque, so that (for example) 
+  partial results for separate parts of a data set can be accumulated
+  separately and then merged.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "math.h"
+#include "stats.h"
+
+/*
+  stat_init
+*/
+void stat_init (acc)
+stat_acc *acc;
+  {
+  acc->n = 0;
+  acc->mean = 0;
+  acc->m2 = 0;
+  acc->min = 0;
+  acc->max = 0;
+  acc->sum = 0;
+  acc->comp = 0;
+  }
+
+/*
+  stat_ksum
+  Kahan summation step
+*/
+static void stat_ksum (acc, x)
+stat_acc *acc;
+double x;
+  {
+  double y = x - acc->comp;
+  double t = acc->sum + y;
+  acc->comp = (t - acc->sum) - y;
+  acc->sum = t;
+  }
+
+/*
+  stat_merge
+*/
+void stat_merge (acc, other)
+stat_acc *acc;
+stat_acc *other;
+  {
+  double delta, n;
+  if (other->n == 0) return;
+  if (acc->n == 0 || other->min < acc->min) acc->min = other->min;
+  if (acc->n == 0 || other->max > acc->max) acc->max = other->max;
+  n = (double)acc->n + other->n;
+  delta = other->mean - acc->mean;
+  acc->mean += delta * other->n / n;
+  acc->m2 += other->m2 + delta * delta * acc->n * other->n / n;
+  acc->n += other->n;
+  stat_ksum (acc, other->sum);
+  stat_ksum (acc, -other->comp);
+  }
+
+/*
+  stat_block
+  Summarize the block in two simple passes -- the mean, then the squared
+  differences from it -- which needs no division per value, and then
+  merge the summary. 
+*/
+void stat_block (acc, x, n)
+stat_acc *acc;
+double *x;
+int n;
+  {
+  stat_acc b;
+  register int i;
+  double d;
+
+  if (n <= 0) return;
+  stat_init (&b);
+  b.min = b.max = x[0];
+  for (i = 0; i < n; i++)
+    {
+    stat_ksum (&b, x[i]);
+    if (x[i] < b.min) b.min = x[i];
+    if (x[i] > b.max) b.max = x[i];
+    }
+  b.n = n;
+  b.mean = (b.sum - b.comp) / n;
+  for (i = 0; i < n; i++)
+    {
+    d = x[i] - b.mean;
+    b.m2 += d * d;
+    }
+  stat_merge (acc, &b);
+  }
+
+/*
+  stat_var
+*/
+double stat_var (acc)
+stat_acc *acc;
+  {
+  if (acc->n < 2) return 0;
+  return acc->m2 / (acc->n - 1);
+  }
+
+/*
+  stat_sum
+*/
+double stat_sum (acc)
+stat_acc *acc;
+  {
+  return acc->sum - acc->comp;
+  }
+
@@ -0,0 +1,41 @@
+/*===========================================================================
+
+  stats.h
+
+  Running statistics over a stream of numbers, in constant memory.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __STATS_H
+#define __STATS_H
+
+typedef struct stat_acc
+  {
+  long n;
+  double mean;
+  double m2;   /* Sum of squared differences from the mean */
+  double min;
+  double max;
+  double sum;
+  double comp; /* Compensation (lost low-order bits) for sum */
+  } stat_acc;
+
+/* Empty an accumulator. args: stat_acc *acc */
+void stat_init ();
+
+/* Add a block of values. args: stat_acc *acc, double *x, int n */
+void stat_block ();
+
+/* Combine the values of one accumulator into another, as if they had
+   all been added to it. args: stat_acc *acc, stat_acc *other */
+void stat_merge ();
+
+/* Sample variance; zero if there are fewer than two values. 
+   args: stat_acc *acc */
+double stat_var ();
+
+/* Compensated sum. args: stat_acc *acc */
+double stat_sum ();
+
+#endif
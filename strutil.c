@@ -6,9 +6,11 @@
 
 ===========================================================================*/
 #include "ctype.h"
+#include "compat.h"
 
 #ifndef CPM
 #include <ctype.h>
+#include <stdlib.h>
 #endif
 
 /* 
@@ -64,3 +66,132 @@ char **ptr;
   }
 
 
+
+/*
+  strsplit
+  Split a string in place at commas that are not inside brackets or
+  double quotes, trimming spaces from each field. Stores at most max fields; returns
+  the number found, which is max + 1 if there are too many.
+*/
+int strsplit (str, fields, max)
+char *str;
+char **fields;
+int max;
+  {
+  int n = 0;
+  int depth = 0;
+  int quoted = 0;
+  char *p = str;
+  char *e;
+
+  for (;;)
+    {
+    while (isspace (*p)) p++;
+    if (n == max) return max + 1;
+    fields[n++] = p;
+    while (*p && (*p != ',' || depth > 0 || quoted))
+      {
+      if (*p == '"') quoted = !quoted;
+      if (*p == '(') depth++;
+      if (*p == ')') depth--;
+      p++;
+      }
+    e = p;
+    while (e > fields[n - 1] && isspace (e[-1])) e--;
+    if (*p == 0) 
+      {
+      *e = 0;
+      return n;
+      }
+    *e = 0;
+    p++;
+    }
+  }
+
+/*
+  strtodn
+  Convert a decimal number, in ordinary or scientific notation, that 
+  ends at or before end -- the string need not be terminated. Sets *ptr to
+  the first character not converted, or to str if there is no number.
+  Most numbers, with up to fifteen digits and not too large or small, 
+  are worked out exactly, much more quickly than _strtod(), which has to
+  scan the number and then hand it to sscanf(); the rest are handed to
+  _strtod(). Leading spaces are skipped.
+*/
+double strtodn (str, end, ptr)
+char *str;
+char *end;
+char **ptr;
+  {
+  char *p = str, *start, *q, buff[64];
+  double m = 0, scale = 1, ten = 10;
+  int neg = 0, eneg = 0, digits = 0;
+  int e = 0, ex = 0;
+
+  *ptr = str;
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  start = p;
+  if (p < end && (*p == '+' || *p == '-')) neg = (*p++ == '-');
+  while (p < end && *p >= '0' && *p <= '9')
+    {
+    m = m * 10 + (*p++ - '0');
+    digits++;
+    }
+  if (p < end && *p == '.')
+    {
+    p++;
+    while (p < end && *p >= '0' && *p <= '9')
+      {
+      m = m * 10 + (*p++ - '0');
+      e--;
+      digits++;
+      }
+    }
+  if (digits == 0) return 0;
+  *ptr = p;
+
+  if (p < end && (*p == 'e' || *p == 'E'))
+    {
+    q = p + 1;
+    if (q < end && (*q == '+' || *q == '-')) eneg = (*q++ == '-');
+    if (q < end && *q >= '0' && *q <= '9')
+      {
+      while (q < end && *q >= '0' && *q <= '9')
+        {
+        if (ex < 10000) ex = ex * 10 + (*q - '0');
+        q++;
+        }
+      e += eneg ? -ex : ex;
+      *ptr = q;
+      }
+    }
+
+  /* The digits, as a whole number below 2^53, and powers of ten up to
+     10^22 are exact, so that one multiplication or division rounds the
+     result correctly. Otherwise the number is copied, so that it is
+     terminated, for _strtod(). */
+  if (m >= 9007199254740992.0 || e < -22 || e > 22)
+    {
+    ex = *ptr - start;
+    q = ex < (int)sizeof (buff) ? buff : malloc (ex + 1);
+    if (q)
+      {
+      _memcpy (q, start, ex);
+      q[ex] = 0;
+      m = _strtod (q, &p);
+      if (q != buff) free (q);
+      return m;
+      }
+    }
+
+  /* Scale by a power of ten, built by repeated squaring */
+  ex = e < 0 ? -e : e;
+  while (ex)
+    {
+    if (ex & 1) scale *= ten;
+    ten *= ten;
+    ex >>= 1;
+    }
+  m = e < 0 ? m / scale : m * scale;
+  return neg ? -m : m;
+  }
@@ -30,4 +30,18 @@ int ishexdigit ();
 int ishexdigit (char c);
 #endif
 
+/** Split a string in place at commas that are not inside brackets */
+#ifdef CPM
+int strsplit ();
+#else
+int strsplit (char *str, char **fields, int max);
+#endif
+
+/** Fast decimal conversion of a string that need not be terminated */
+#ifdef CPM
+double strtodn ();
+#else
+double strtodn (char *str, char *end, char **ptr);
+#endif
+
 #endif
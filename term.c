@@ -14,6 +14,15 @@
 #include "ctype.h"
 #include "term.h"
 #include "config.h"
+#include "compat.h"
+#include "obuf.h"
+#include "compl.h"
+#ifdef LINUX
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <termios.h>
+#endif
 
 #ifdef CPM
 
@@ -39,6 +48,62 @@ int term_g_rchar ()
   return bios (3, 0, 0); 
   }
 
+#endif
+
+#ifdef LINUX
+
+/*===========================================================================
+
+  term_get_rchar
+
+  Get a raw char, without echoing. The terminal must already be in raw 
+  mode. End of input is treated as an interrupt.
+
+===========================================================================*/
+int term_g_rchar ()
+  {
+  unsigned char c;
+  if (read (0, &c, 1) != 1) return I_INTR;
+  return c;
+  }
+
+/*===========================================================================
+
+  term_g_esc
+
+  Interpret the rest of an ANSI escape sequence for one of the cursor 
+  keys, or Home or End. Anything else is ignored.
+
+===========================================================================*/
+static int term_g_esc ()
+  {
+  int c = term_g_rchar ();
+  if (c != '[' && c != 'O') return 0;
+  c = term_g_rchar ();
+  if (c >= '0' && c <= '9')
+    {
+    /* ESC [ n ~ */
+    int n = c;
+    while (c >= '0' && c <= '9') 
+      c = term_g_rchar ();
+    if (n == '1' || n == '7') return VK_SOL;
+    if (n == '4' || n == '8') return VK_EOL;
+    return 0;
+    }
+  switch (c)
+    {
+    case 'A': return VK_UP;
+    case 'B': return VK_DOWN;
+    case 'C': return VK_RCHAR;
+    case 'D': return VK_LCHAR;
+    case 'H': return VK_SOL;
+    case 'F': return VK_EOL;
+    }
+  return 0;
+  }
+
+#endif
+
 /*===========================================================================
 
   term_get_ichar
@@ -59,44 +124,427 @@ int term_g_ichar ()
     case 'D' - '@': return VK_RCHAR; 
     case 'F' - '@': return VK_RWORD; 
     case 'B' - '@': return VK_SOL; 
+    case 'E' - '@': return VK_UP; 
+    case 'X' - '@': return VK_DOWN; 
+    case 'R' - '@': return VK_SRCH; 
+    case '\t': return VK_TAB;
+#ifdef LINUX
+    /* What a Linux terminal sends for backspace, and the cursor keys */
+    case 127: return VK_DESTBS;
+    case 27: return term_g_esc ();
+#endif
     }
   return c;
   }
 
-/* TODO delete this */
-void dump (buff)
-char *buff;
+/* Longest line that the editor displays */
+#define TERM_MAX 128
+
+/* The editor keeps a copy of what it has displayed after the prompt, 
+   and where the cursor is, so that each edit sends only the characters
+   that have changed. On a serial terminal, output is the slowest thing
+   the editor does. */
+static char shown[TERM_MAX];
+static int nshown = 0;
+static int cur = 0;
+
+/* Number of characters sent to the terminal by the editor */
+long term_nout = 0;
+
+/*===========================================================================
+
+  term_out, term_str
+
+  Send a character, or a string, to the terminal. The output of each edit 
+  is collected, and sent in one piece when the edit is complete.
+
+===========================================================================*/
+static void term_out (c)
+int c;
   {
-  int i;
-  char c;
-  for (i = 0; i < 10; i++)
+  ob_putc (c);
+  term_nout++;
+  }
+
+static void term_str (s)
+char *s;
+  {
+  while (*s) term_out (*s++);
+  }
+
+/*===========================================================================
+
+  term_move
+
+  Move the cursor to a position in the displayed line. Moving right is done
+  by sending the characters that are already there, which is no more 
+  output than a cursor movement sequence for short distances.
+
+===========================================================================*/
+static void term_move (to)
+int to;
+  {
+#ifdef O_CUB
+  if (cur - to > 4)
+    {
+    char seq[10];
+    sprintf (seq, O_CUB, cur - to);
+    term_str (seq);
+    cur = to;
+    }
+#endif
+  while (cur > to)
     {
-    c = buff[i];
-    printf ("%02x %d '%c'\n", c, c, c);
+    term_out (O_BS);
+    cur--;
     }
+  while (cur < to)
+    term_out (shown[cur++]);
   }
 
 /*===========================================================================
 
-  term_g_line
+  term_sync
+
+  Update the display to show line, with the cursor at pos, sending only
+  the span of characters that differs from what is displayed already.
+
+===========================================================================*/
+static void term_sync (line, pos)
+char *line;
+int pos;
+  {
+  int l = strlen (line);
+  int n = l > nshown ? l : nshown;
+  int i, j, c;
+
+  for (i = 0; i < n; i++)
+    if ((i < l ? line[i] : ' ') != (i < nshown ? shown[i] : ' ')) break;
+  if (i < n)
+    {
+    for (j = n - 1; j > i; j--)
+      if ((j < l ? line[j] : ' ') != (j < nshown ? shown[j] : ' ')) break;
+    term_move (i);
+    for (; i <= j; i++)
+      {
+      c = i < l ? line[i] : ' ';
+      term_out (c);
+      shown[i] = c;
+      }
+    cur = i;
+    }
+  /* Blanks added at the end were already showing, so weren't sent */
+  for (i = nshown; i < l; i++) shown[i] = line[i];
+  nshown = l;
+  term_move (pos);
+  }
+
+/* The history is a ring of HIST_SIZE bytes, holding previous lines end 
+   to end, each with its terminating zero. A line is identified by its
+   offset from the start of the oldest line, so 0 is the oldest line, and 
+   h_used is the new line that is being entered. */
+static char hist[HIST_SIZE];
+static int h_head = 0;
+static int h_used = 0;
+
+#define H_AT(o) hist[(h_head + (o)) % HIST_SIZE]
+
+/*===========================================================================
+
+  hist_prev, hist_next
+
+  Find the line before, or after, the line at offset o. hist_prev returns
+  -1 if o is the oldest line; o must not be the newest for hist_next.
+
+===========================================================================*/
+static int hist_prev (o)
+int o;
+  {
+  if (o <= 0) return -1;
+  o--; /* The end of the previous line */
+  while (o > 0 && H_AT (o - 1) != 0)
+    o--;
+  return o;
+  }
+
+static int hist_next (o)
+int o;
+  {
+  while (H_AT (o) != 0)
+    o++;
+  return o + 1;
+  }
+
+/*===========================================================================
+
+  hist_get
+
+  Copy the line at offset o into line, which has room for len characters
+  including the terminating zero.
+
+===========================================================================*/
+static void hist_get (o, line, len)
+int o;
+char *line;
+int len;
+  {
+  int p = (h_head + o) % HIST_SIZE;
+  while (len > 1 && hist[p] != 0)
+    {
+    *line++ = hist[p];
+    if (++p == HIST_SIZE) p = 0;
+    len--;
+    }
+  *line = 0;
+  }
+
+/*===========================================================================
+
+  hist_match
+
+  Return the position of pat in the line at offset o, or -1 if it is 
+  not there.
+
+===========================================================================*/
+static int hist_match (o, pat)
+int o;
+char *pat;
+  {
+  int p = (h_head + o) % HIST_SIZE;
+  int col, q;
+  char *s;
+
+  for (col = 0; ; col++)
+    {
+    q = p;
+    for (s = pat; *s && hist[q] == *s; s++)
+      if (++q == HIST_SIZE) q = 0;
+    if (*s == 0) return col;
+    if (hist[p] == 0) return -1;
+    if (++p == HIST_SIZE) p = 0;
+    }
+  }
+
+/*===========================================================================
+
+  hist_find
+
+  Search backwards from the line at offset o, inclusive, for a line that 
+  contains pat. Returns the offset of the line, and the position of pat
+  in col, or -1 if there is no such line.
+
+===========================================================================*/
+static int hist_find (o, pat, col)
+int o;
+char *pat;
+int *col;
+  {
+  for (; o >= 0; o = hist_prev (o))
+    if ((*col = hist_match (o, pat)) >= 0) return o;
+  return -1;
+  }
+
+/*===========================================================================
+
+  hist_add
+
+  Add a line to the history, discarding the oldest lines to make room. 
+  Empty lines, and repeats of the last line, are not stored. 
+
+===========================================================================*/
+static void hist_add (line)
+char *line;
+  {
+  int n = strlen (line) + 1;
+  int i, o, p;
+  char *s;
+
+  if (n == 1 || n > HIST_SIZE) return;
+  if ((o = hist_prev (h_used)) >= 0)
+    {
+    for (s = line; *s && H_AT (o) == *s; s++)
+      o++;
+    if (*s == 0 && H_AT (o) == 0) return;
+    }
+  while (h_used + n > HIST_SIZE)
+    {
+    o = hist_next (0);
+    h_head = (h_head + o) % HIST_SIZE;
+    h_used -= o;
+    }
+  p = (h_head + h_used) % HIST_SIZE;
+  for (i = 0; i < n; i++)
+    {
+    hist[p] = line[i];
+    if (++p == HIST_SIZE) p = 0;
+    }
+  h_used += n;
+  }
+
+/*===========================================================================
+
+  term_srch
+
+  Reverse incremental search of the history, started by VK_SRCH. Each 
+  character typed extends the pattern, and the search continues from the
+  current match, so no line is examined more than once as the pattern 
+  grows; the match for each shorter pattern is kept, so that deleting a 
+  character goes straight back to it. VK_SRCH finds the next older match.
+  Any other key leaves the match in the line, and is returned to be 
+  processed by the editor as usual, except VK_INTR, which abandons the
+  search. *h is set to the history line that was matched.
+
+===========================================================================*/
+static int term_srch (line, len, pos, h)
+char *line;
+int len;
+int *pos;
+int *h;
+  {
+  static char pat[HIST_PAT + 1];
+  static int found[HIST_PAT + 1];
+  static char disp[TERM_MAX];
+  int n = 0, col = 0, fail = 0, m, i, l, c;
+
+  pat[0] = 0;
+  found[0] = hist_prev (h_used); 
+  for (;;)
+    {
+    /* Show the pattern, and the latest line that matched */
+    for (i = n; i > 0 && found[i] < 0; i--)
+      ;
+    m = found[i];
+    if (m >= 0) col = hist_match (m, pat);
+    strcpy (disp, fail || found[n] < 0 ? "failed search '" : "search '");
+    strcat (disp, pat);
+    strcat (disp, "': ");
+    i = strlen (disp);
+    if (m >= 0) 
+      {
+      hist_get (m, disp + i, TERM_MAX - i); 
+      i += col;
+      }
+    else
+      {
+      for (l = 0; line[l] && i + l < TERM_MAX - 1; l++)
+        disp[i + l] = line[l];
+      disp[i + l] = 0;
+      }
+    l = strlen (disp);
+    term_sync (disp, i < l ? i : l);
+    ob_flush ();
+
+    fail = 0;
+    c = term_g_ichar ();
+    if (c == VK_SRCH)
+      {
+      if (found[n] >= 0) 
+        {
+        m = hist_find (hist_prev (found[n]), pat, &col);
+        if (m >= 0) 
+          found[n] = m; 
+        else
+          fail = 1;
+        }
+      }
+    else if (c == VK_DESTBS)
+      {
+      if (n > 0) pat[--n] = 0;
+      }
+    else if (c >= 32 && c < 256)
+      {
+      if (n < HIST_PAT)
+        {
+        pat[n++] = c;
+        pat[n] = 0;
+        found[n] = found[n - 1] < 0 ? -1 
+          : hist_find (found[n - 1], pat, &col); 
+        }
+      }
+    else 
+      break;
+    }
+
+  if (c == VK_INTR)
+    c = 0;
+  else if (m >= 0)
+    {
+    hist_get (m, line, len);
+    *h = m;
+    *pos = col;
+    }
+  l = strlen (line);
+  if (*pos > l) *pos = l;
+  term_sync (line, *pos);
+  return c;
+  }
+
+/*===========================================================================
+
+  term_compl
+
+  Complete the identifier that ends at pos in line, as far as all the
+  names that it could be have in common. Returns the new cursor position.
+
+===========================================================================*/
+static int term_compl (line, len, pos)
+char *line;
+int len;
+int pos;
+  {
+  char ext[TERM_MAX];
+  int s = pos, l = strlen (line), n, i;
+
+  while (s > 0 && (isalnum (line[s - 1]) || line[s - 1] == '_'))
+    s--;
+  while (s < pos && !isalpha (line[s]))
+    s++;
+  n = s < pos ? cp_find (line + s, pos - s, ext, sizeof (ext)) : 0;
+  if (n == 0 || ext[0] == 0)
+    {
+    term_out (7); /* Nothing, or nothing certain, to add */
+    return pos;
+    }
+  n = strlen (ext);
+  if (l + n > len - 1) n = len - 1 - l;
+  if (n <= 0) return pos;
+  _memmove (line + pos + n, line + pos, l - pos + 1);
+  for (i = 0; i < n; i++)
+    {
+    /* Follow the case of what was typed */
+    line[pos + i] = islower (line[pos - 1]) ? tolower (ext[i]) : ext[i];
+    }
+  pos += n;
+  term_sync (line, pos);
+  return pos;
+  }
+
+/*===========================================================================
+
+  term_edit
  
-  Read a line from the console, with editing
+  Read a line from the console, with editing. The terminal must be in
+  raw mode. Arguments and return value are as for term_g_line. 
 
-  Fills in the line, up to len characters. Caller should allocate one more
-  character for the terminating zero. Returns zero if the program should
-  continue, or non-zero on error or end-of-input.
-  
 ===========================================================================*/
-int term_g_line (line, len)
+static int term_edit (line, len)
 char *line;
 int len;
   {
+  static char saved[TERM_MAX];
   int stop = 0;
   int pos = 0;
+  int h = h_used;
+  int l;
   line[0] = 0;
+  nshown = 0;
+  cur = 0;
+  if (len > TERM_MAX) len = TERM_MAX;
   while (!stop)
     {
     int c = term_g_ichar ();
+    if (c == VK_SRCH) c = term_srch (line, len, &pos, &h);
+    l = strlen (line);
     switch (c)
       {
       case VK_INTR: /* Interrupt */
@@ -105,118 +553,213 @@ int len;
       case VK_DESTBS: /* Destructive backspace */
         if (pos > 0)
 	  {
-          int i, l;
-	  _memmove (line + pos - 1, line + pos, len - pos - 0);
+	  _memmove (line + pos - 1, line + pos, l - pos + 1);
 	  pos--;
-	  putchar (O_BS); 
-          l = strlen (line);
-          for (i = pos; i < l; i++) putchar (line[i]);
-	  putchar (' '); 
-          for (i = pos; i <= l; i++) putchar (O_BS);
+#ifdef O_DCH
+          term_move (pos);
+          term_str (O_DCH);
+	  _memmove (shown + pos, shown + pos + 1, nshown - pos - 1);
+          nshown--;
+#else
+          term_sync (line, pos);
+#endif
 	  }
 	break;
 
       case VK_LCHAR: /* Left one char */ 
-        if (pos > 0)
-	  {
-	  putchar (O_BS); 
-	  pos--;
-	  }
+        if (pos > 0) pos--;
+        term_move (pos);
 	break;
 
       case VK_LWORD: /* Left one word */ 
         if (pos == 1)
-          {
           pos = 0;
-          putchar (O_BS);
-          }
         else
           {
           while (pos > 0 && isspace (line[(pos - 1)]))
-            {
             pos--;
-            putchar (O_BS);
-            }
           while (pos > 0 && !isspace (line[pos - 1]))
-            {
             pos--;
-            putchar (O_BS);
-            }
           }
+        term_move (pos);
         break;
 
       case VK_RWORD: /* Right one word */ 
         while (line[pos] != 0 && !isspace (line[pos]))
-          {
-          putchar (line[pos]);
           pos++;
-          }
         while (line[pos] != 0 && isspace (line[pos]))
-          {
-          putchar (line[pos]);
           pos++;
-          }
+        term_move (pos);
         break;
 
       case VK_SOL: /* Start of line */ 
         if (pos > 0)
-          {
-          int i;
-          for (i = 0; i < pos; i++)
-            putchar (O_BS);
           pos = 0;
-          }
         else 
-          {
-          /* Wrap round to end of line */
-          int i, l = strlen (line);
-          for (i = pos; i < l; i++)
-            putchar (line[i]);
-          pos = l;
-          }
+          pos = l; /* Wrap round to end of line */
+        term_move (pos);
         break;
 
       case VK_RCHAR: /* Right one char */ 
-        {
-        int l = strlen (line);
-        if (pos < l)
-	  {
-          putchar (line[pos]);
-          pos++;
-	  }
-        }
+        if (pos < l) pos++;
+        term_move (pos);
 	break;
 
+      case VK_EOL: /* End of line */ 
+        pos = l;
+        term_move (pos);
+        break;
+
+      case VK_TAB: /* Complete a name */ 
+        pos = term_compl (line, len, pos);
+        break;
+
+      case VK_UP: /* Previous line in the history */
+        if (h > 0)
+          {
+          if (h == h_used) strcpy (saved, line);
+          h = hist_prev (h);
+          hist_get (h, line, len);
+          pos = strlen (line);
+          term_sync (line, pos);
+          }
+        break;
+
+      case VK_DOWN: /* Next line in the history */
+        if (h < h_used)
+          {
+          h = hist_next (h);
+          if (h == h_used)
+            strcpy (line, saved);
+          else
+            hist_get (h, line, len);
+          pos = strlen (line);
+          term_sync (line, pos);
+          }
+        break;
+
       case 10: case 13: 
-	printf ("\r\n");
+        hist_add (line);
+	ob_puts ("\r\n");
         stop = 1;
 	break;
 
       default:
-        if (pos < len - 1 && c >= 32)
+        if (l < len - 1 && c >= 32)
 	  {
-          int i, l;
-          char *p;
-	  _memmove (line + pos + 1, line + pos, len - pos - 1);
+	  _memmove (line + pos + 1, line + pos, l - pos + 1);
           line[pos] = c;
-          printf ("%s", line + pos);
-          l = strlen (line + pos);
-          for (i = 0; i < l - 1; i++) putchar (8);
-          pos ++;
+          pos++;
+#ifdef O_ICH
+          if (pos <= l)
+            {
+            term_move (pos - 1);
+            term_str (O_ICH);
+            term_out (c);
+	    _memmove (shown + pos, shown + pos - 1, nshown - pos + 1);
+            shown[pos - 1] = c;
+            nshown++;
+            cur = pos;
+            break;
+            }
+#endif
+          term_sync (line, pos);
 	  }
       }
+    ob_flush ();
     }
-  fflush (stdout);
   return 0;
   }
 
+/*===========================================================================
+
+  term_g_line
+ 
+  Read a line from the console, with editing
+
+  Fills in the line, up to len characters. Caller should allocate one more
+  character for the terminating zero. Returns zero if the program should
+  continue, or non-zero on error or end-of-input.
+  
+===========================================================================*/
+#ifdef CPM
+
+int term_g_line (line, len)
+char *line;
+int len;
+  {
+  return term_edit (line, len);
+  }
+
 #endif
 
 #ifdef LINUX
 
+/* On Linux, the editor only makes sense when the input is a terminal. 
+   Otherwise (input from a pipe or a file), lines are read as they are. 
+   The terminal is in raw mode only while a line is being edited, so 
+   ctrl+C is an ordinary key at the prompt, but still interrupts the
+   program while it is working. */
 int term_g_line (char *line, int len)
   {
-  return fgets (line, len, stdin) == NULL;
+  struct termios old, raw;
+  int ret;
+
+  if (!isatty (0) || tcgetattr (0, &old) != 0)
+    return fgets (line, len, stdin) == NULL;
+  raw = old;
+  raw.c_iflag &= ~(ICRNL | IXON);
+  raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+  raw.c_cc[VMIN] = 1;
+  raw.c_cc[VTIME] = 0;
+  tcsetattr (0, TCSADRAIN, &raw);
+  ret = term_edit (line, len);
+  tcsetattr (0, TCSADRAIN, &old);
+  return ret;
+  }
+
+#endif
+
+/*===========================================================================
+
+  term_g_buf
+
+  Read a line from the console, as term_g_line() does, into a buffer
+  allocated with malloc() whose size is in *size. On Linux, a line read
+  from a file or a pipe may be of any length, the buffer being enlarged
+  to hold it; the editor, and CP/M, have the editor's fixed limit.
+  
+===========================================================================*/
+#ifdef CPM
+
+int term_g_buf (line, size)
+char **line;
+int *size;
+  {
+  return term_edit (*line, *size - 1);
+  }
+
+#endif
+
+#ifdef LINUX
+
+int term_g_buf (char **line, int *size)
+  {
+  char *p;
+  int len;
+
+  if (isatty (0)) return term_g_line (*line, *size - 1);
+  if (fgets (*line, *size, stdin) == NULL) return 1;
+  len = strlen (*line);
+  while (len == *size - 1 && (*line)[len - 1] != '\n')
+    {
+    if ((p = realloc (*line, 2 * *size)) == NULL) return 1;
+    *line = p;
+    *size *= 2;
+    if (fgets (*line + len, *size - len, stdin) == NULL) break;
+    len += strlen (*line + len);
+    }
+  return 0;
   }
 
 #endif
@@ -37,11 +37,32 @@
 /* Start of line */
 #define VK_SOL 1006
 
+/* Previous line in the history */
+#define VK_UP 1007
+
+/* Next line in the history */
+#define VK_DOWN 1008
+
+/* Search backwards through the history */
+#define VK_SRCH 1009
+
+/* End of line */
+#define VK_EOL 1010
+
+/* Complete the name at the cursor */
+#define VK_TAB 1011
+
 
 /* Get a line from the console, with editing. 
    args: char *line, int len, ret: 0 if program should proceed. */
 int term_g_line ();
 
+/* Get a line from the console, as term_g_line() does, into a buffer
+   from malloc(), which is enlarged if a line from a file or pipe is 
+   longer than it. args: char **line, int *size (the buffer's size), 
+   ret: 0 if program should proceed. */
+int term_g_buf ();
+
 /* Get a raw char from the console, without echoing.
     args: none. */
 int term_g_rchar ();
@@ -0,0 +1,218 @@
+/*===========================================================================
+
+  termtest.c
+
+  A check of the line editor in term.c (Linux only): it feeds scripted
+  keys to term_edit() and counts the characters that each edit sends to
+  the terminal, which on a serial terminal is what makes editing slow.
+  Each edit must leave the expected line, both in the editor and on a 
+  simulated terminal that is sent what the editor sends, and send no 
+  more than it did when it was last measured. Build and run it with
+
+    make -f Makefile.linux termtest
+
+  which checks it both with the ANSI sequences in config.h and, as
+  KCalc-CPM is by default, without them (TERM_DUMB). The whole file is
+  empty unless TERMTEST is defined, so it doesn't add to kcalc.
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifdef TERMTEST
+
+/* config.h is read first, so that its sequences can be left out */
+#include "config.h"
+#ifdef TERM_DUMB
+#undef O_ICH
+#undef O_DCH
+#undef O_CUB
+#endif
+#include "term.c"
+
+/* WordStar keys, as term_g_ichar() reads them */
+#define K_LEFT "\023"
+#define K_RIGHT "\004"
+#define K_LWORD "\001"
+#define K_RWORD "\006"
+#define K_SOL "\002"
+#define K_UP "\005"
+#define K_BS "\010"
+
+/* An edit: its keys, the line that they should leave, and the most
+   characters that they may send with and without the ANSI sequences */
+typedef struct
+  {
+  char *name;
+  char *keys;
+  char *line;
+  long ansi;
+  long dumb;
+  } tt_case;
+
+static tt_case cases[] =
+  {
+    {"type a line", "SIN(X) + COS(Y) * 2.5\r", 
+      "SIN(X) + COS(Y) * 2.5", 21, 21},
+    {"fix the first word",
+      "SIM(X) + COS(Y) * 2.5" K_SOL K_RIGHT K_RIGHT K_RIGHT K_BS "N\r",
+      "SIN(X) + COS(Y) * 2.5", 37, 121},
+    {"insert in the middle",
+      "SIN(X) + COS(Y) * 2.5" K_LWORD K_LWORD K_LWORD "2*\r",
+      "SIN(X) + 2*COS(Y) * 2.5", 38, 83},
+    {"delete a word",
+      "SIN(X) + COS(Y) * 2.5" K_LWORD K_LWORD 
+        K_BS K_BS K_BS K_BS K_BS K_BS K_BS "\r",
+      "SIN(X) + * 2.5", 54, 117},
+    {"recall and change",
+      K_UP K_SOL K_RWORD K_RWORD "-" K_BS "\r",
+      "SIN(X) + * 2.5", 36, 61},
+    {0}
+  };
+
+/*===========================================================================
+
+  tt_screen
+
+  Play what the editor sent, in the n characters at p, on a simulated 
+  terminal that understands backspace and the sequences in config.h, and
+  leave what it shows, without trailing blanks, in screen. Returns zero
+  if anything else was sent, or the cursor went off the line.
+
+===========================================================================*/
+static int tt_screen (p, n, screen)
+char *p;
+int n;
+char *screen;
+  {
+  char *end = p + n;
+  int cur = 0, i, k;
+  for (i = 0; i <= TERM_MAX; i++) screen[i] = ' ';
+  while (p < end)
+    {
+    if (*p == '\033')
+      {
+      /* ESC [ @, ESC [ P, or ESC [ n D */
+      if (end - p < 3 || p[1] != '[') return 0;
+      p += 2;
+      for (k = 0; p < end && *p >= '0' && *p <= '9'; p++) 
+        k = k * 10 + *p - '0';
+      if (p == end) return 0;
+      if (*p == '@')
+        _memmove (screen + cur + 1, screen + cur, TERM_MAX - cur);
+      else if (*p == 'P')
+        _memmove (screen + cur, screen + cur + 1, TERM_MAX - cur);
+      else if (*p == 'D')
+        cur -= k;
+      else
+        return 0;
+      screen[TERM_MAX] = ' ';
+      p++;
+      }
+    else if (*p == O_BS)
+      cur--, p++;
+    else if (*p == '\r' && end - p == 2 && p[1] == '\n')
+      p = end;
+    else if (*p >= 32 && *p < 127)
+      screen[cur++] = *p++;
+    else
+      return 0;
+    if (cur < 0 || cur >= TERM_MAX) return 0;
+    }
+  for (i = TERM_MAX; i > 0 && screen[i - 1] == ' '; i--)
+    ;
+  screen[i] = 0;
+  return 1;
+  }
+
+/*===========================================================================
+
+  tt_edit
+
+  Run term_edit() with keys as its input, and the count of characters
+  it sends in *sent, and what they leave on the terminal in screen 
+  (which is empty if they don't make sense). Returns the line it read.
+
+===========================================================================*/
+static char *tt_edit (keys, sent, screen)
+char *keys;
+long *sent;
+char *screen;
+  {
+  static char line[TERM_MAX + 1];
+  char buff[4096];
+  FILE *f = tmpfile ();
+  int fd[2], n;
+  screen[0] = 0;
+  if (!f || pipe (fd) != 0) return 0;
+  write (fd[1], keys, strlen (keys));
+  close (fd[1]);
+  dup2 (fd[0], 0);
+  close (fd[0]);
+  dup2 (fileno (f), 1);
+  term_nout = 0;
+  term_edit (line, TERM_MAX);
+  ob_flush ();
+  *sent = term_nout;
+  rewind (f);
+  n = fread (buff, 1, sizeof (buff), f);
+  fclose (f);
+  if (!tt_screen (buff, n, screen)) screen[0] = 0;
+  return line;
+  }
+
+/*===========================================================================
+
+  main
+
+  The results are written to what was standard output, which the editor
+  no longer uses. Returns non-zero if any edit fails.
+
+===========================================================================*/
+int main ()
+  {
+  FILE *out = fdopen (dup (1), "w");
+  tt_case *t;
+  char *line, screen[TERM_MAX + 1];
+  long sent, most, total = 0;
+  int bad = 0;
+
+  if (!out) return 2;
+#ifdef TERM_DUMB
+  fprintf (out, "Without the ANSI sequences\n");
+#else
+  fprintf (out, "With the ANSI sequences\n");
+#endif
+  for (t = cases; t->name; t++)
+    {
+    line = tt_edit (t->keys, &sent, screen);
+#ifdef TERM_DUMB
+    most = t->dumb;
+#else
+    most = t->ansi;
+#endif
+    fprintf (out, "  %-22s %3ld keys %4ld sent", t->name,
+      (long)strlen (t->keys), sent);
+    if (!line || strcmp (line, t->line) != 0)
+      {
+      fprintf (out, "  FAILED: line is \"%s\"", line ? line : "");
+      bad++;
+      }
+    else if (strcmp (screen, t->line) != 0)
+      {
+      fprintf (out, "  FAILED: terminal shows \"%s\"", screen);
+      bad++;
+      }
+    else if (sent > most)
+      {
+      fprintf (out, "  FAILED: more than %ld", most);
+      bad++;
+      }
+    fprintf (out, "\n");
+    total += sent;
+    }
+  fprintf (out, "  total %ld%s\n", total, bad ? ", FAILED" : "");
+  fclose (out);
+  return bad != 0;
+  }
+
+#endif
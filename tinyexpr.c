@@ -28,6 +28,13 @@
 #include "tinyexpr.h"
 #include "compat.h"
 #include "strutil.h"
+#include "memo.h"
+#include "dd.h"
+#include "rat.h"
+#include "big.h"
+#include "fix.h"
+#include "funcs.h"
+#include "config.h"
 #ifdef LINUX
 #include <stdlib.h>
 #include <string.h>
@@ -45,19 +52,40 @@
 
 typedef double (*te_fun1)();
 typedef double (*te_fun2)();
+typedef double (*te_funl)();
+typedef te_vec *(*te_fung)();
+typedef int (*te_funb)();
 
 jmp_buf err_jump;
 AngleMode angle_mode = AM_RAD;
 BaseMode base_mode = BM_DEC;
+int int_mode = 0;
 
-typedef struct te_expr 
+struct te_expr 
   {
   int type;
   double dvalue; 
+#ifdef LINUX
+  double dlow; /* KB -- the low part of a constant, in DD mode */
+  big_num *big; /* KB -- a constant too long for a double, in BIG mode */
+#endif
+  te_int ivalue; /* KB -- a constant as an integer, in INT mode */
+  te_int rden; /* KB -- and over this, as a fraction in FRAC mode; or, if
+                  it is negative, ivalue is a fixed-point number with 
+                  -rden fraction bits, in FIXED mode */
   double *bound; 
   void *fvalue;
   void *parameters[1];
-  } te_expr;
+  };
+
+/* KB -- a variable that exists only within a call like SUM(expr, i, a, b) */
+typedef struct te_local
+  {
+  char *name;
+  int len;
+  double *address;
+  struct te_local *prev;
+  } te_local;
 
 typedef struct state 
   {
@@ -65,12 +93,19 @@ typedef struct state
   char *next;
   int type;
   double dvalue;
+#ifdef LINUX
+  double dlow;
+  char *lit; /* KB -- where a decimal number starts, for BIG mode */
+#endif
+  te_int ivalue;
+  te_int rden;
   double *bound;
   void *fvalue;
   void *context;
 
   te_variable *lookup;
   int lookup_len;
+  te_local *locals; /* KB -- innermost first */
   } state;
 
 #define TOK_NULL 24
@@ -82,12 +117,29 @@ typedef struct state
 #define TOK_NUMBER 30
 #define TOK_VARIABLE 31
 #define TOK_INFIX 32
-
-static te_expr *power (); 
-static te_expr *expr (); 
-static te_expr *list (); 
-static double te_eval (); 
-static void te_free (); 
+/* KB -- token types are compared after TYPE_MASK(), so these have to be
+   values that no other token or function type uses */
+#define TOK_LBRACK 2
+#define TOK_RBRACK 3
+
+static te_expr *vgen (); 
+static double te_chain (); 
+static double te_horner (); 
+static void pkind (); 
+static double *veval (); 
+static te_vec *vec_of (); 
+static double vscalar (); 
+static void refresh (); 
+static void stale (); 
+static int te_refs (); 
+static te_int ie (); 
+static void re (); 
+static te_int fe (); 
+static int smooth1 (); 
+#ifdef LINUX
+static void dde (); 
+static big_num *be (); 
+#endif
 
 /* Implementation of missing trunc() function. */
 double trunc (x)
@@ -97,8 +149,42 @@ double x;
   return (ceil (x));
   }
 
-static double add (a, b) double a; double b; {return a + b;}
-static double sub (a, b) double a; double b; {return a - b;}
+/* KB -- set if, with fn_prec set, something was worked out that isn't 
+   smooth (see smooth1()), or sums and differences have lost more than
+   one of the digits that the results of short kernels have to spare: 
+   lost is the factor by which cancellation has magnified their errors */
+static int rough = 0;
+static double lost = 1.0;
+
+static void cancel (a, b, r)
+double a;
+double b;
+double r;
+  {
+  if (r == 0.0)
+    rough = 1;
+  else if ((lost *= (fabs (a) + fabs (b)) / fabs (r)) > 10.0)
+    rough = 1;
+  }
+
+static double add (a, b) 
+double a; 
+double b; 
+  {
+  double r = a + b;
+  if (fn_prec && (a < 0) != (b < 0)) cancel (a, b, r);
+  return r;
+  }
+
+static double sub (a, b) 
+double a; 
+double b; 
+  {
+  double r = a - b;
+  if (fn_prec && (a < 0) == (b < 0)) cancel (a, b, r);
+  return r;
+  }
+
 static double mul (a, b) double a; double b; {return a * b;}
 
 /** KB -- divide with error check */
@@ -123,6 +209,65 @@ static double fmod (a, b) double a; double b;
 
 static double negate (a) double a; {return -a;}
 
+/** KB -- division and remainder, for the C that te_code() writes */
+double te_div (a, b) double a; double b; {return divide (a, b);}
+double te_mod (a, b) double a; double b; {return fmod (a, b);}
+
+/** KB -- a double as an integer, without the undefined behaviour of a 
+    cast when it is out of range */
+te_int te_toint (x)
+double x;
+  {
+  if (x != x) return 0;
+  if (x >= -(double)TE_IMIN) return TE_IMAX;
+  if (x < (double)TE_IMIN) return TE_IMIN;
+  return (te_int)x;
+  }
+
+/** KB -- a shifted left by s bits, or right if left is zero. Bits 
+    shifted out are lost, and a right shift copies the sign bit. */
+static te_int ishift (a, s, left)
+te_int a;
+te_int s;
+int left;
+  {
+  if (s < 0)
+    {
+    left = !left;
+    s = s < -TE_IBITS ? TE_IBITS : -s;
+    }
+  if (left) return s >= TE_IBITS ? 0 : (te_int)((te_uint)a << (int)s);
+  if (s >= TE_IBITS) s = TE_IBITS - 1;
+  return a < 0 ? ~(~a >> (int)s) : a >> (int)s;
+  }
+
+/** KB -- the bitwise operators, for numbers that are not integers */
+double te_and (a, b) double a; double b; 
+  {return (double)(te_toint (a) & te_toint (b));}
+double te_or (a, b) double a; double b; 
+  {return (double)(te_toint (a) | te_toint (b));}
+double te_xor (a, b) double a; double b; 
+  {return (double)(te_toint (a) ^ te_toint (b));}
+double te_shl (a, b) double a; double b; 
+  {return (double)ishift (te_toint (a), te_toint (b), 1);}
+double te_shr (a, b) double a; double b; 
+  {return (double)ishift (te_toint (a), te_toint (b), 0);}
+
+/*
+    KB -- the digits from s up to end as an integer, in base 10 or 16. 
+    Like arithmetic in INT mode, this wraps around, so that 
+    #FFFFFFFFFFFFFFFF is -1.
+*/
+static te_int iatoi (s, end, base)
+char *s;
+char *end;
+int base;
+  {
+  te_uint u = 0;
+  for (; s < end; s++) u = u * base + htod (*s);
+  return (te_int)u;
+  }
+
 /*
     Find an entry in the symbol table
 */
@@ -168,11 +313,68 @@ void next_token (s)
       {
       s->dvalue = hstrtod (s->next + 1, (char**)&s->next);
       s->type = TOK_NUMBER;
+#ifdef LINUX
+      s->dlow = 0.0;
+      s->lit = 0;
+#endif
+      /* KB -- in INT mode, all the digits count, and in FRAC mode, 
+         as many as make a te_int */
+      s->ivalue = 0;
+      s->rden = 0;
+      if (int_mode || base_mode == BM_FRAC)
+        {
+        char *p = s->next;
+        while (p > s->start && ishexdigit (p[-1])) p--;
+        if (int_mode || s->next - p < TE_IBITS / 4)
+          {
+          s->ivalue = iatoi (p, s->next, 16);
+          s->dvalue = (double)s->ivalue;
+          s->rden = 1;
+          }
+        else
+          s->rden = RAT_INEX;
+        }
       }
     else if ((s->next[0] >= '0' && s->next[0] <= '9') || s->next[0] == '.') 
       {
+      char *start = s->next;
+      char *p;
       s->dvalue = _strtod (s->next, (char**)&s->next);
       s->type = TOK_NUMBER;
+      s->ivalue = 0;
+      s->rden = 0;
+      if (base_mode == BM_FRAC)
+        {
+        /* KB -- in FRAC mode, a decimal like 0.1 is exactly 1/10; one 
+           with too many digits to be a fraction stays a double */
+        rat_num x;
+        rat_atof (start, s->next, s->dvalue, &x);
+        s->ivalue = x.p;
+        s->rden = RAT_DEN (&x);
+        }
+      if (int_mode)
+        {
+        /* KB -- a whole number is read exactly; anything else is 
+           truncated */
+        for (p = start; p < s->next && isdigit (*p); p++)
+          ;
+        s->ivalue = p == s->next ? iatoi (start, p, 10) 
+          : te_toint (s->dvalue);
+        s->dvalue = (double)s->ivalue;
+        }
+#ifdef LINUX
+      /* KB -- in DD mode, decimals like 0.1 need the digits that a 
+         double doesn't have */
+      s->lit = start;
+      s->dlow = 0.0;
+      if (dd_mode)
+        {
+        dd_real x;
+        dd_atof (start, s->next, &x);
+        s->dvalue = x.hi;
+        s->dlow = x.lo;
+        }
+#endif
       }
     else 
       {
@@ -180,12 +382,36 @@ void next_token (s)
       if (isalpha(s->next[0])) 
         {
         te_variable *var;
+        te_local *local;
         char *start;
         start = s->next;
         while (isalpha(s->next[0]) || isdigit(s->next[0]) 
 	               || (s->next[0] == '_')) 
 	  s->next++;
+
+        /* KB -- XOR is an operator, spelt as a name */
+        if (s->next - start == 3 && strncmp (start, "XOR", 3) == 0)
+          {
+          s->type = TOK_INFIX;
+          s->fvalue = te_xor;
+          return;
+          }
                 
+        /* KB -- loop variables shadow the symbol table */
+        for (local = s->locals; local; local = local->prev)
+          {
+          if (local->len == s->next - start 
+                && strncmp (start, local->name, local->len) == 0)
+            break;
+          }
+        if (local)
+          {
+          s->type = TOK_VARIABLE;
+          s->bound = local->address;
+          s->fvalue = 0;
+          return;
+          }
+
         var = find_lookup (s, start, s->next - start);
 
         if (!var) 
@@ -198,16 +424,26 @@ void next_token (s)
           switch (TYPE_MASK(var->type))
             {
             case TE_VARIABLE:
+              /* KB -- a defined variable is only recomputed when it is
+                 actually used, and only if its inputs have changed */
+              if (var->type & TE_FLAG_DIRTY)
+                refresh (s->lookup, s->lookup_len, var);
               s->type = TOK_VARIABLE;
               s->bound = var->address;
+              /* KB -- the node keeps the variable, in case it is (or 
+                 becomes) a vector */
+              s->fvalue = var;
               break;
             case TE_CLO0: case TE_CLO1: case TE_CLO2: 
 	    case TE_CLO3: case TE_CLO4: case TE_CLO5: 
 	    case TE_CLO6: case TE_CLO7:     
-              s->context = var->context; /* Fall through */ 
             case TE_FUNC0: case TE_FUNC1: case TE_FUNC2: 
 	    case TE_FUNC3: case TE_FUNC4: case TE_FUNC5: 
 	    case TE_FUNC6: case TE_FUNC7:   
+              /* KB -- the context is also used by reductions, by
+                 functions like SUM that can be reductions, and by 
+                 functions with block versions */
+              s->context = var->context; 
               s->type = var->type;
               s->fvalue = var->address;
               break;
@@ -223,11 +459,25 @@ void next_token (s)
           case '-': s->type = TOK_INFIX; s->fvalue = sub; break;
           case '*': s->type = TOK_INFIX; s->fvalue = mul; break;
           case '/': s->type = TOK_INFIX; s->fvalue = divide; break;
-          case '^': s->type = TOK_INFIX; s->fvalue = pow; break;
+          case '^': s->type = TOK_INFIX; s->fvalue = _pow; break;
           case '%': s->type = TOK_INFIX; s->fvalue = fmod; break;
+          case '&': s->type = TOK_INFIX; s->fvalue = te_and; break;
+          case '|': s->type = TOK_INFIX; s->fvalue = te_or; break;
+          case '<': case '>': 
+            /* KB -- only as << and >> */
+            if (s->next[0] != s->next[-1])
+              {
+              s->type = TOK_ERROR;
+              break;
+              }
+            s->type = TOK_INFIX; 
+            s->fvalue = s->next++[0] == '<' ? te_shl : te_shr; 
+            break;
           case '(': s->type = TOK_OPEN; break;
           case ')': s->type = TOK_CLOSE; break;
           case ',': s->type = TOK_SEP; break;
+          case '[': s->type = TOK_LBRACK; break;
+          case ']': s->type = TOK_RBRACK; break;
           case ' ': case '\t': case '\n': case '\r': break;
           default: s->type = TOK_ERROR; break;
           }
@@ -258,49 +508,201 @@ te_expr *n;
 
 /*
     Free memory used to represent an expression.
+    KB -- the first argument is followed in a loop rather than by 
+    recursion, so that a long chain like a+b+c+... doesn't use up the
+    stack.
 */
 void te_free(n) 
 te_expr *n;
   {
-  if (!n) return;
-  te_fp(n);
-  free(n);
+  te_expr *next;
+  int i, arity;
+  while (n)
+    {
+    arity = ARITY(n->type);
+    next = arity ? n->parameters[0] : 0;
+    for (i = 1; i < arity; i++) te_free (n->parameters[i]);
+    /* KB -- a vector constant owns its vector */
+    if (n->type == (TE_CONSTANT | TE_FLAG_VEC)) te_vfree (n->fvalue);
+    /* KB -- and a polynomial its coefficients */
+    if (n->type & TE_FLAG_POLY) te_vfree (n->parameters[1]);
+#ifdef LINUX
+    /* KB -- and a long constant its digits */
+    if (n->big) big_free (n->big);
+#endif
+    free(n);
+    n = next;
+    }
+  }
+
+/*
+    KB -- grow one of the parser's stacks, if it is full, by doubling it.
+    n is the number of entries in use, max the number allocated, size the
+    size of an entry.
+*/
+static void *pgrow (p, n, max, size)
+void *p;
+int n;
+int *max;
+int size;
+  {
+  void *q;
+  int m;
+  if (n < *max) return p;
+  m = *max ? 2 * *max : 16;
+  if ((q = realloc (p, m * size)) == 0) longjmp (err_jump, E_NOMEM);
+  *max = m;
+  return q;
+  }
+
+/*
+    KB -- a long chain of binary operators, like a+b+c+..., makes a tree
+    that leans to the left, as deep as the chain is long. The nodes down
+    its left side are put on this stack, so that they can be evaluated
+    in a loop. Chains inside chains share the stack, each using the part
+    above where it started, and putting it back as it was when done.
+*/
+static te_expr **spine = 0;
+static int nspine = 0, maxspine = 0;
+
+/*
+    KB -- push the nodes down the left side of a chain, top first, and
+    return the node at the bottom
+*/
+static te_expr *climb (n)
+te_expr *n;
+  {
+  while (TYPE_MASK(n->type) == TE_FUNC2 
+      && !(n->type & (TE_FLAG_LOOP | TE_FLAG_RED)))
+    {
+    spine = pgrow (spine, nspine, &maxspine, sizeof (te_expr *));
+    spine[nspine++] = n;
+    n = n->parameters[0];
+    }
+  return n;
+  }
+
+/*
+    KB -- smooth1() is non-zero if a node is arithmetic, or a function 
+    whose result changes only a little when its arguments do, so that 
+    functions worked out to a few digits more than are shown (see 
+    fn_prec in funcs.h) can't change the result by more than a little 
+    either. Rounding, remainders, bitwise operators, functions like ASIN
+    whose domain ends where an argument is often exactly, and powers 
+    other than constant ones, don't qualify; nor do sums and the like, 
+    vectors, or random numbers; nor do polynomials, which may cancel.
+*/
+static double (*smooths[])() = 
+  {
+  add, sub, mul, divide, negate, comma, fabs, _sqrt, _sin, _cos, _tan, 
+  _atan, _atan2, _log, _log10, exp, sinh, cosh, tanh, 0
+  };
+static int smooth1 (n)
+te_expr *n;
+  {
+  int i;
+  if (n->type & (TE_FLAG_VEC | TE_FLAG_LOOP | TE_FLAG_RED)) return 0;
+  if (n->type & TE_FLAG_POLY) return 0;
+  if (ARITY(n->type) == 0) 
+    return TYPE_MASK(n->type) == TE_CONSTANT 
+      || TYPE_MASK(n->type) == TE_VARIABLE;
+  if (IS_CLOSURE(n->type)) return 0;
+  /* A constant power may itself be a short kernel's result */
+  if (n->fvalue == (void *)_pow)
+    return TYPE_MASK(((te_expr *)n->parameters[1])->type) == TE_CONSTANT
+      && !fn_fast;
+  for (i = 0; smooths[i] && (void *)smooths[i] != n->fvalue; i++)
+    ;
+  return smooths[i] != 0;
+  }
+
+int te_smooth (n)
+te_expr *n;
+  {
+  int i, arity = 0;
+  if (rough) return 0;
+  for (; n; n = arity ? n->parameters[0] : 0)
+    {
+    if (!smooth1 (n)) return 0;
+    arity = ARITY(n->type);
+    for (i = 1; i < arity; i++)
+      if (!te_smooth (n->parameters[i])) return 0;
+    }
+  return 1;
   }
 
 /*
     Where possible, evalate those parts of an expression whose
     values are already known. (KB -- this facility has no particular
-    benefit in KCalc-CPM)
+    benefit in KCalc-CPM. It is applied to each node as the node is
+    made, when its arguments are as simple as they will get.)
 */
-static void optimize (n) 
+static te_expr *fold (n) 
 te_expr *n;
   {
-  /* Evaluates as much as possible. */
-  if (n->type == TE_CONSTANT) return;
-  if (n->type == TE_VARIABLE) return;
+  int arity, i;
+  double value;
 
   /* Only optimize out functions flagged as pure. */
-  if (IS_PURE(n->type)) 
+  if (!IS_PURE(n->type)) return n;
+  arity = ARITY(n->type);
+  for (i = 0; i < arity; ++i) 
     {
-    int arity = ARITY(n->type);
-    int known = 1;
-    int i;
-    for (i = 0; i < arity; ++i) 
-      {
-      optimize (n->parameters[i]);
-      if (((te_expr*)(n->parameters[i]))->type != TE_CONSTANT) 
-        {
-        known = 0;
-        }
-      }
-    if (known) 
-      {
-      double value = te_eval (n);
-      te_fp(n);
-      n->type = TE_CONSTANT;
-      n->dvalue = value;
-      }
+    if (((te_expr*)(n->parameters[i]))->type != TE_CONSTANT) return n;
+    }
+  if (fn_prec && !smooth1 (n)) rough = 1;
+#ifdef LINUX
+  /* KB -- in BIG mode, a constant may be too big for a double, so is 
+     left to be worked out every time */
+  if (big_mode) return n;
+  /* KB -- in DD mode, constants are worked out in DD */
+  if (dd_mode)
+    {
+    dd_real x;
+    dde (n, &x);
+    te_fp(n);
+    n->type = TE_CONSTANT;
+    n->dvalue = x.hi;
+    n->dlow = x.lo;
+    return n;
+    }
+#endif
+  /* KB -- in INT mode, they are worked out in integers */
+  if (int_mode)
+    {
+    n->ivalue = ie (n);
+    te_fp(n);
+    n->type = TE_CONSTANT;
+    n->dvalue = (double)n->ivalue;
+    return n;
+    }
+  /* KB -- in FIXED mode, in fixed point */
+  if (fix_mode)
+    {
+    n->ivalue = fe (n);
+    te_fp(n);
+    n->type = TE_CONSTANT;
+    n->dvalue = fix_dbl (n->ivalue);
+    n->rden = -fix_bits;
+    return n;
     }
+  /* KB -- and in FRAC mode, in fractions */
+  if (base_mode == BM_FRAC)
+    {
+    rat_num x;
+    re (n, &x);
+    te_fp(n);
+    n->type = TE_CONSTANT;
+    n->dvalue = rat_dbl (&x);
+    n->ivalue = x.p;
+    n->rden = RAT_DEN (&x);
+    return n;
+    }
+  value = te_eval (n);
+  te_fp(n);
+  n->type = TE_CONSTANT;
+  n->dvalue = value;
+  return n;
   }
 
 /*
@@ -313,7 +715,9 @@ te_expr *parameters[];
   {
   int arity = ARITY (type);
   int psize = sizeof(void*) * arity;
-  int size = (sizeof(te_expr) - sizeof(void*)) + psize + (IS_CLOSURE (type) ? sizeof(void*) : 0);
+  int size = (sizeof(te_expr) - sizeof(void*)) + psize 
+    + (IS_CLOSURE (type) || (type & (TE_FLAG_RED | TE_FLAG_BLK | TE_FLAG_POLY)) 
+      ? sizeof(void*) : 0);
   te_expr *ret = malloc(size);
   _memset(ret, 0, size);
   if (arity && parameters) 
@@ -326,303 +730,922 @@ te_expr *parameters[];
   }
 
 /*
-    Parse current token as a terminal symbol (constant, function call...)
+  KB -- the parser. Rather than calling itself for every bracket and 
+  every level of precedence, which would limit how deeply an expression 
+  could be nested by the size of the C stack (small, on CP/M), it keeps 
+  the operands it has parsed, and the operators and brackets waiting for
+  them, on stacks of its own, which grow as needed. The trees it builds
+  are those of this grammar:
+
+  <list>   = <expr> {"," <expr>}
+  <expr>   = <xor> {"|" <xor>}
+  <xor>    = <and> {"XOR" <and>}
+  <and>    = <shift> {"&" <shift>}
+  <shift>  = <sum> {("<<" | ">>") <sum>}
+  <sum>    = <term> {("+" | "-") <term>}
+  <term>   = <factor> {("*" | "/" | "%") <factor>}
+  <factor> = <power> {"^" <power>}
+  <power>  = {("-" | "+")} <base>
+  <base>   = <constant> | <variable> | <function-0> {"(" ")"} 
+             | <function-1> <power> 
+             | <function-X> "(" <expr> {"," <expr>} ")" 
+             | <loop> | <vector> | "(" <list> ")"
+  <loop>   = <function> "(" <expr> "," <name> {"," <expr>} ")"
+             | <function> "(" <expr> ")"
+  <vector> = "[" <expr> {"," <expr>} "]"
+
+  As in C, the bitwise operators bind more loosely than arithmetic. All
+  the binary operators are left-associative, and the signs in front
+  of a <power> apply to its <base> only, so -2^2 is 4. A function of one
+  argument without brackets applies to a <power>, so SIN X^2 is 
+  (SIN X)^2.
 */
-static te_expr *base (s) 
-state *s;
-  /* <base>      =    <constant> | <variable> | <function-0> {"(" ")"} | <function-1> <power> | <function-X> "(" <expr> {"," <expr>} ")" | "(" <list> ")" */
+
+/* An operand: a finished tree */
+typedef struct pv_ent
+  {
+  te_expr *e;
+  int depth; /* how deeply evaluating it will recurse */
+  int chain; /* length of the chain of operators down its left side */
+  int pk;    /* PK_TERM or PK_SUM if it is a polynomial (see ppoly()) */
+  int pdeg;  /* PK_TERM: the power of the variable */
+  double pc; /* PK_TERM: the coefficient */
+  double *px;  /* the variable, or 0 for a constant */
+  void *pvar;  /* the variable's symbol table entry, if any */
+  } pv_ent;
+
+/* A single term c*x^k, or a constant */
+#define PK_TERM 1
+/* A sum of terms, in a TE_FLAG_POLY node */
+#define PK_SUM 2
+
+/* An operator or bracket, waiting for its operands */
+typedef struct pf_ent
   {
-  te_expr *ret;
-  int arity;
+  int kind;
+  int prec;        /* PF_INFIX: precedence, higher binding tighter */
+  te_fun2 f;       /* PF_INFIX: the operator's function */
+  te_expr *node;   /* PF_FN1, PF_CALL, PF_LOOP, PF_LARG, PF_RED: the call */
+  int narg;        /* arguments stored in node; PF_BRACK: first element */
+  int depth;       /* the deepest of those arguments */
+  te_local *local; /* PF_LOOP: its variable, while its expression is read */
+  } pf_ent;
+
+/* Signs in front of an operand, collapsed to one negation */
+#define PF_NEG 1
+/* Function of one argument, without brackets */
+#define PF_FN1 2
+/* Binary operator, its left operand on the operand stack */
+#define PF_INFIX 3
+/* Bracketed list */
+#define PF_PAREN 4
+/* Function call, reading arguments */
+#define PF_CALL 5
+/* Call like SUM(expr, var, ...), reading its expression */
+#define PF_LOOP 6
+/* Call like SUM(expr, var, ...), reading the arguments after var */
+#define PF_LARG 7
+/* Call like SUM(v), a reduction */
+#define PF_RED 8
+/* Vector literal, its elements on pnums */
+#define PF_BRACK 9
+
+/* A chain of operators this long or longer is evaluated by te_chain() */
+#define TE_CHAIN 16
+
+/* A polynomial of this degree or higher is evaluated by te_horner() in
+   two halves */
+#define POLY_SPLIT 4
+
+static pv_ent *pvs = 0;
+static int npv = 0, maxpv = 0;
+static pf_ent *pfs = 0;
+static int npf = 0, maxpf = 0;
+static double *pnums = 0;
+static int nnums = 0, maxnums = 0;
+/* For each "(" or "[" in the expression, the offset of the first "," or
+   ")" inside it and at its own level; built when first needed */
+static int *pmatch = 0;
+static int pscanned;
 
-  switch (TYPE_MASK (s->type)) 
+/*
+    KB -- empty the parser's stacks, freeing anything on them. Called
+    before each compilation, and after one that fails, which may have 
+    been left half-done by longjmp().
+*/
+static void pclear ()
+  {
+  while (npv > 0) te_free (pvs[--npv].e);
+  while (npf > 0)
     {
-    case TOK_NUMBER:
-      ret = new_expr (TE_CONSTANT, 0);
-      ret->dvalue = s->dvalue;
-      next_token(s);
-      break;
-
-    case TOK_VARIABLE:
-      ret = new_expr (TE_VARIABLE, 0);
-      ret->bound = s->bound;
-      next_token(s);
-      break;
-
-    case TE_FUNC0:
-    case TE_CLO0:
-      ret = new_expr(s->type, 0);
-      ret->fvalue = s->fvalue;
-      if (IS_CLOSURE(s->type)) ret->parameters[0] = s->context;
-        next_token(s);
-      if (s->type == TOK_OPEN) 
-	{
-        next_token(s);
-        if (s->type != TOK_CLOSE) 
-	  {
-          s->type = TOK_ERROR;
-          } 
-	else 
-	  {
-          next_token(s);
-          }
-        }
-      break;
-
-    case TE_FUNC1:
-    case TE_CLO1:
-      ret = new_expr(s->type, 0);
-      ret->fvalue = s->fvalue;
-      if (IS_CLOSURE(s->type)) ret->parameters[1] = s->context;
-      next_token(s);
-      ret->parameters[0] = power(s);
-      break;
-
-    case TE_FUNC2: case TE_FUNC3: case TE_FUNC4:
-    case TE_FUNC5: case TE_FUNC6: case TE_FUNC7:
-    case TE_CLO2: case TE_CLO3: case TE_CLO4:
-    case TE_CLO5: case TE_CLO6: case TE_CLO7:
-      arity = ARITY(s->type);
-
-      ret = new_expr(s->type, 0);
-      ret->fvalue = s->fvalue;
-      if (IS_CLOSURE(s->type)) ret->parameters[arity] = s->context;
-      next_token(s);
-
-      if (s->type != TOK_OPEN) 
-	{
-        s->type = TOK_ERROR;
-        } 
-      else 
-	{
-        int i;
-        for (i = 0; i < arity; i++) 
-	  {
-          next_token(s);
-          ret->parameters[i] = expr(s);
-          if(s->type != TOK_SEP) 
-	    {
-            break;
-            }
-          }
-        if(s->type != TOK_CLOSE || i != arity - 1) 
-	  {
-          s->type = TOK_ERROR;
-          } 
-	else 
-	  {
-          next_token(s);
-          }
-        }
-      break;
-
-    case TOK_OPEN:
-      next_token(s);
-      ret = list(s);
-      if (s->type != TOK_CLOSE) 
-        {
-        s->type = TOK_ERROR;
-        } 
-      else 
-	{
-        next_token(s);
-        }
-      break;
-
-    default:
-      ret = new_expr (0, 0);
-      s->type = TOK_ERROR;
-      ret->dvalue = NAN;
-      break;
+    npf--;
+    te_free (pfs[npf].node);
+    if (pfs[npf].local) free (pfs[npf].local);
     }
-  return ret;
+  nnums = 0;
+  if (pmatch) free (pmatch);
+  pmatch = 0;
+  pscanned = 0;
   }
 
 /*
-  Grammar rule:
-  <power> = {("-" | "+")} <base> 
+    KB -- push an operand. Its tree belongs to the stack as soon as it is
+    on it, so that it is freed if compilation fails.
 */
-static te_expr *power (s) 
-state *s;
+static void ppush (e, depth, chain)
+te_expr *e;
+int depth;
+int chain;
   {
-  te_expr *ret;
-  int sign = 1;
+  pvs = pgrow (pvs, npv, &maxpv, sizeof (pv_ent));
+  pvs[npv].e = e;
+  if (e->type == TE_CONSTANT) depth = 1, chain = 0;
+  pvs[npv].depth = depth;
+  pvs[npv].chain = chain;
+  pkind (&pvs[npv]);
+  npv++;
+  if (depth > EXPR_DEPTH) longjmp (err_jump, E_DEEP);
+  }
 
-  while (s->type == TOK_INFIX && (s->fvalue == add || s->fvalue == sub)) 
-    {
-    if (s->fvalue == sub) sign = -sign;
-    next_token (s);
-    }
+/*
+    KB -- polynomials. A sum of terms like a*x^4 + b*x^3 + ..., with
+    constant coefficients, is made into a single node, evaluated by
+    Horner's rule rather than as a tree of calls to pow() and mul().
+    Each operand on the parser's stack records whether it is a single
+    term c*x^k, or such a sum, so that a polynomial is recognized as it
+    is parsed, whatever the order of its terms. Terms of the same power
+    are added together, and a sum may be multiplied by a constant or
+    a term, so x*(2*x + 1) is 2*x^2 + x. But a sum is not multiplied by
+    another sum, or raised to a power: expanding (x - 1)^10 would lose
+    the accuracy that the factored form has near x = 1.
+*/
 
-  if (sign == 1) 
+/*
+    KB -- set what an operand is, as far as it is known from its node
+    alone: a constant or a variable is a term, anything else is not
+*/
+static void pkind (v)
+pv_ent *v;
+  {
+  v->pk = 0;
+  if (v->e->type == TE_CONSTANT)
     {
-    ret = base (s);
-    } 
-  else 
+    v->pk = PK_TERM;
+    v->pdeg = 0;
+    v->pc = v->e->dvalue;
+    v->px = 0;
+    }
+  else if (v->e->type == TE_VARIABLE)
     {
-    /* ??? */
-    te_expr *a[1];
-    a[0] = base (s);
-    ret = new_expr (TE_FUNC1 | TE_FLAG_PURE, a);
-    ret->fvalue = negate;
+    v->pk = PK_TERM;
+    v->pdeg = 1;
+    v->pc = 1.0;
+    v->px = v->e->bound;
+    v->pvar = v->e->fvalue;
     }
-  return ret;
   }
 
 /*
-  Grammar rule:
-  <factor> = <power> {"^" <power>} 
+    KB -- put the coefficients of a polynomial operand in c, and return
+    its degree
 */
-static te_expr *factor(s) 
-state *s;
+static int pcoef (v, c)
+pv_ent *v;
+double *c;
   {
-  te_expr *ret = power(s);
-
-  while (s->type == TOK_INFIX && (s->fvalue == pow)) 
+  te_vec *k;
+  int i;
+  for (i = 0; i <= POLY_DEG; i++) c[i] = 0.0;
+  if (v->pk == PK_TERM) 
     {
-    /* ??? */
-    te_expr *a[2];
-    te_fun2 t = s->fvalue;
-    next_token(s);
-    a[0] = ret;
-    a[1] = power (s);
-    ret = new_expr (TE_FUNC2 | TE_FLAG_PURE, a);
-    ret->fvalue = t;
+    c[v->pdeg] = v->pc;
+    return v->pdeg;
     }
-
-  return ret;
+  k = v->e->parameters[1];
+  for (i = 0; i < k->n; i++) c[i] = k->v[i];
+  return k->n - 1;
   }
 
 /*
-  Grammar rule:
-  <term> = <factor> {("*" | "/" | "%") <factor>} 
+    KB -- try to apply an operator f to operands a and b (b is 0, and f
+    is 0, for a negation) as polynomials. Returns 0 if the result is 
+    not a polynomial, and 1 if it is a single term, which a now 
+    describes; the caller makes the node as usual in both cases. 
+    Returns 2 if the result is a sum of terms, in which case the 
+    operands are freed and replaced in a by a new polynomial node.
 */
-static te_expr *term (s) 
-state *s;
+static int ppoly (a, b, f)
+pv_ent *a;
+pv_ent *b;
+te_fun2 f;
   {
-  te_expr *ret = factor (s);
+  double ca[POLY_DEG + 1], cb[POLY_DEG + 1];
+  double *x = a->px;
+  void *var = a->pvar;
+  te_expr *e, *v;
+  te_vec *k;
+  int da, db, i, j, n;
 
-  while (s->type == TOK_INFIX && (s->fvalue == mul 
-    || s->fvalue == divide || s->fvalue == fmod)) 
+#ifdef LINUX
+  /* KB -- coefficients are only doubles */
+  if (dd_mode || big_mode) return 0;
+#endif
+  if (int_mode || fix_mode || base_mode == BM_FRAC) return 0;
+  if (!a->pk || (b && !b->pk)) return 0;
+  if (b && b->px)
     {
-    te_expr *a[2];
-    te_fun2 t = s->fvalue;
-    next_token(s);
-    a[0] = ret;
-    a[1] = factor (s);
-    ret = new_expr (TE_FUNC2 | TE_FLAG_PURE, a);
-    ret->fvalue = t;
+    if (x && x != b->px) return 0;
+    x = b->px;
+    var = b->pvar;
     }
+  /* Constants are left to fold() */
+  if (!x) return 0;
 
-    return ret;
-}
-
-/*
-  Grammar rule:
-   <expr> = <term> {("+" | "-") <term>} 
-*/
-static te_expr *expr (s) 
-state *s;
-  {
-  te_expr *ret = term (s);
-
-  while (s->type == TOK_INFIX && (s->fvalue == add || s->fvalue == sub)) 
+  if (!b)
     {
-    te_expr *a[2];
-    te_fun2 t = s->fvalue;
-    next_token (s);
-    a[0] = ret;
-    a[1] = term(s);
-    ret = new_expr (TE_FUNC2 | TE_FLAG_PURE, a);
-    ret->fvalue = t;
+    if (a->pk == PK_TERM)
+      {
+      a->pc = -a->pc;
+      return 1;
+      }
+    da = pcoef (a, ca);
+    for (i = 0; i <= da; i++) ca[i] = -ca[i];
+    }
+  else if (f == _pow)
+    {
+    if (a->pk != PK_TERM || b->px || b->pc < 1 || b->pc > POLY_DEG) 
+      return 0;
+    n = (int)b->pc;
+    if (n != b->pc || a->pdeg * n > POLY_DEG) return 0;
+    a->pdeg *= n;
+    a->pc = pow (a->pc, (double)n);
+    return 1;
+    }
+  else if (f == mul)
+    {
+    if (a->pk == PK_SUM && b->pk == PK_SUM) return 0;
+    if (a->pk == PK_TERM && b->pk == PK_TERM)
+      {
+      if (a->pdeg + b->pdeg > POLY_DEG) return 0;
+      a->pdeg += b->pdeg;
+      a->pc *= b->pc;
+      a->px = x;
+      a->pvar = var;
+      return 1;
+      }
+    da = pcoef (a, ca);
+    db = pcoef (b, cb);
+    if (da + db > POLY_DEG) return 0;
+    if (a->pk == PK_TERM)
+      {
+      for (i = 0; i <= da + db; i++) ca[i] = 0.0;
+      for (i = 0; i <= db; i++) ca[i + da] = a->pc * cb[i];
+      }
+    else
+      {
+      j = b->pdeg;
+      for (i = da; i >= 0; i--) ca[i + j] = ca[i] * b->pc;
+      for (i = 0; i < j; i++) ca[i] = 0.0;
+      }
+    da += db;
+    }
+  else if (f == add || f == sub)
+    {
+    da = pcoef (a, ca);
+    db = pcoef (b, cb);
+    for (i = 0; i <= db; i++) 
+      ca[i] = f == add ? ca[i] + cb[i] : ca[i] - cb[i];
+    if (db > da) da = db;
     }
+  else
+    return 0;
 
-  return ret;
+  /* A sum of two or more terms */
+  while (da > 0 && ca[da] == 0.0) da--;
+  for (i = 0, n = 0; i <= da; i++) 
+    if (ca[i] != 0.0) n++;
+  if (n < 2) return 0;
+
+  e = new_expr (TE_FUNC1 | TE_FLAG_PURE | TE_FLAG_POLY, 0);
+  e->parameters[0] = v = new_expr (TE_VARIABLE, 0);
+  v->bound = x;
+  v->fvalue = var;
+  if ((k = te_vnew (da + 1)) == 0)
+    {
+    te_free (e);
+    longjmp (err_jump, E_NOMEM);
+    }
+  e->parameters[1] = k;
+  for (i = 0; i <= da; i++) k->v[i] = ca[i];
+  te_free (a->e);
+  if (b) te_free (b->e);
+  a->e = e;
+  a->pk = PK_SUM;
+  a->px = x;
+  a->pvar = var;
+  return 2;
   }
 
 /*
-  Grammar rule:
-  <list> = <expr> {"," <expr>} 
+    KB -- push an operator or bracket, with no node
 */
-static te_expr *list(s) 
-state *s;
+static pf_ent *fpush (kind)
+int kind;
   {
-  te_expr *ret = expr (s);
+  pf_ent *f;
+  pfs = pgrow (pfs, npf, &maxpf, sizeof (pf_ent));
+  f = &pfs[npf++];
+  _memset (f, 0, sizeof (pf_ent));
+  f->kind = kind;
+  return f;
+  }
 
-  while (s->type == TOK_SEP) 
+/*
+    KB -- the operand on top of the stack is complete, so apply any signs
+    and one-argument functions that are waiting for it
+*/
+static void pprefix ()
+  {
+  pf_ent *f;
+  pv_ent *v;
+  te_expr *a[1];
+  int r;
+  while (npf > 0 && (pfs[npf - 1].kind == PF_NEG 
+      || pfs[npf - 1].kind == PF_FN1))
     {
-    te_expr *a[2];
-    next_token(s);
-    a[0] = ret;
-    a[1] = expr (s);
-    ret = new_expr (TE_FUNC2 | TE_FLAG_PURE, a);
-    ret->fvalue = comma;
+    f = &pfs[npf - 1];
+    v = &pvs[npv - 1];
+    v->chain = 0;
+    if (f->kind == PF_NEG)
+      {
+      if ((r = ppoly (v, (pv_ent *)0, (te_fun2)0)) == 2)
+        {
+        npf--;
+        v->depth = 2;
+        continue;
+        }
+      a[0] = v->e;
+      v->e = new_expr (TE_FUNC1 | TE_FLAG_PURE, a);
+      v->e->fvalue = negate;
+      }
+    else
+      {
+      r = 0;
+      f->node->parameters[0] = v->e;
+      v->e = f->node;
+      f->node = 0;
+      }
+    npf--;
+    fold (v->e);
+    if (r == 0) pkind (v);
+    if (v->e->type == TE_CONSTANT)
+      v->depth = 1;
+    else if (++v->depth > EXPR_DEPTH) 
+      longjmp (err_jump, E_DEEP);
     }
-
-  return ret;
   }
 
 /*
-   Build the syntax tree.
+    KB -- apply the binary operators on top of the stack whose precedence
+    is at least prec. Operators of equal precedence are applied left to
+    right.
 */
-te_expr *te_compile (expression, variables, var_count, error) 
-char *expression;
-te_variable *variables;
-int var_count;
-int *error;
+static void pinfix (prec)
+int prec;
   {
-  state s;
-  te_expr *root; 
-  s.start = s.next = expression;
-  s.lookup = variables;
-  s.lookup_len = var_count;
-
-  next_token(&s);
-  root = list (&s);
-
-  if (s.type != TOK_END) 
+  pf_ent *f;
+  pv_ent *a, *b;
+  te_expr *p[2];
+  int type, r;
+  while (npf > 0 && pfs[npf - 1].kind == PF_INFIX 
+      && pfs[npf - 1].prec >= prec)
     {
-    te_free(root);
-    if (error) 
+    f = &pfs[--npf];
+    a = &pvs[npv - 2];
+    b = &pvs[npv - 1];
+    if ((r = ppoly (a, b, f->f)) == 2)
       {
-      *error = (s.next - s.start);
-      if (*error == 0) *error = 1;
+      npv--;
+      a->depth = 2;
+      a->chain = 0;
+      continue;
       }
-    return 0;
-    } 
-  else 
-    {
-    optimize (root);
-    if (error) *error = 0;
-    return root;
+    p[0] = a->e;
+    p[1] = b->e;
+    type = TE_FUNC2 | TE_FLAG_PURE;
+    if (f->f == _pow) type |= TE_FLAG_MEMO;
+    a->chain = TYPE_MASK (a->e->type) == TE_FUNC2 ? a->chain + 1 : 1;
+    if (a->chain >= TE_CHAIN)
+      {
+      type |= TE_FLAG_DEEP;
+      if (b->depth + 2 > a->depth) a->depth = b->depth + 2;
+      }
+    else
+      a->depth = 1 + (a->depth > b->depth ? a->depth : b->depth);
+    a->e = new_expr (type, p);
+    a->e->fvalue = f->f;
+    npv--;
+    fold (a->e);
+    if (r == 0) pkind (a);
+    if (a->e->type == TE_CONSTANT) a->depth = 1, a->chain = 0;
+    if (a->depth > EXPR_DEPTH) longjmp (err_jump, E_DEEP);
     }
   }
 
 /*
-   Evaluate a specific node in the syntax tree. 
+    KB -- store the operand on top of the stack as the next argument of 
+    the call in frame f
 */
-
-#define M(e) te_eval (n->parameters[e])
-
-double te_eval (n) 
-te_expr *n;
+static void parg (f)
+pf_ent *f;
   {
-  if (!n) return NAN; /* Should not happen */
+  pv_ent *v = &pvs[--npv];
+  f->node->parameters[f->narg++] = v->e;
+  if (v->depth > f->depth) f->depth = v->depth;
+  }
 
-  switch (TYPE_MASK(n->type)) 
-    {
+/*
+    KB -- the call in frame f, which is on top of the stack, is complete: 
+    move it to the operand stack
+*/
+static void pcall (f)
+pf_ent *f;
+  {
+  te_expr *e = f->node;
+  int depth = f->depth + 1;
+  if (e->type & TE_FLAG_GEN) vgen (e);
+  f->node = 0;
+  npf--;
+  ppush (e, depth, 0);
+  fold (e);
+  if (e->type == TE_CONSTANT) pvs[npv - 1].depth = 1;
+  pkind (&pvs[npv - 1]);
+  }
+
+/*
+    KB -- the offset of the first "," or ")" inside the bracket at offset
+    i of the expression, and at the same level, or of the end of the 
+    expression. The table is made with one pass over the expression, 
+    so that calls like SUM nested inside one another don't each have
+    to search the rest of it.
+*/
+static int plook (s, i)
+state *s;
+int i;
+  {
+  int *open;
+  int len, n = 0, j;
+  if (!pscanned)
+    {
+    len = strlen (s->start);
+    pmatch = malloc ((len + 1) * sizeof (int));
+    open = malloc ((len + 1) * sizeof (int));
+    if (!pmatch || !open)
+      {
+      if (open) free (open);
+      longjmp (err_jump, E_NOMEM);
+      }
+    for (j = 0; j <= len; j++)
+      {
+      pmatch[j] = len;
+      switch (s->start[j])
+        {
+        case '(': case '[':
+          open[n++] = j;
+          pmatch[j] = -1;
+          break;
+        case ',':
+          if (n > 0 && pmatch[open[n - 1]] < 0) pmatch[open[n - 1]] = j;
+          break;
+        case ')': case ']':
+          if (n > 0 && pmatch[open[--n]] < 0) pmatch[open[n]] = j;
+          break;
+        }
+      }
+    while (n > 0) pmatch[open[--n]] = len;
+    free (open);
+    pscanned = 1;
+    }
+  return pmatch[i];
+  }
+
+/*
+  KB -- start a call to a function like SUM(expr, var, from, to), whose
+  first argument is evaluated repeatedly with the variable set to 
+  different values. The variable belongs to the call: it is stored in
+  the call's own node, and shadows any variable of the same name.
+  Returns zero on a syntax error.
+*/
+static int ploop (s)
+state *s;
+  {
+  pf_ent *f;
+  te_local *local;
+  void *comb = s->context;
+  char *p;
+
+  f = fpush (PF_LOOP);
+  f->node = new_expr (s->type, 0);
+  f->node->fvalue = s->fvalue;
+  next_token (s);
+  if (s->type != TOK_OPEN) return 0;
+
+  /* The expression comes before the variable that it uses, so look
+     ahead for the variable's name */
+  p = s->start + plook (s, s->next - s->start - 1);
+  if (*p == ')' && comb)
+    {
+    /* With only one argument, a function that has a way to combine 
+       values in its context reduces a vector: SUM(v) */
+    free (f->node);
+    f->node = new_expr (TE_FUNC1 | TE_FLAG_PURE | TE_FLAG_RED, 0);
+    f->node->fvalue = te_ident;
+    f->node->parameters[1] = comb;
+    f->kind = PF_RED;
+    next_token (s);
+    return 1;
+    }
+  if (*p != ',') return 0;
+  p++;
+  while (isspace (*p)) p++;
+  if ((local = malloc (sizeof (te_local))) == 0) 
+    longjmp (err_jump, E_NOMEM);
+  f->local = local;
+  local->name = p;
+  while (isalpha (*p) || isdigit (*p) || *p == '_') p++;
+  local->len = p - local->name;
+  local->address = &f->node->dvalue;
+  local->prev = s->locals;
+  s->locals = local;
+  next_token (s);
+  return 1;
+  }
+
+/*
+    KB -- read an operand, or the start of one. Returns zero on a syntax
+    error, otherwise sets *done if the operand is complete.
+*/
+static int pbase (s, done)
+state *s;
+int *done;
+  {
+  pf_ent *f;
+  te_expr *e;
+  int sign = 1, arity;
+
+  *done = 0;
+  if (s->type == TOK_INFIX && (s->fvalue == add || s->fvalue == sub)) 
+    {
+    while (s->type == TOK_INFIX && (s->fvalue == add || s->fvalue == sub)) 
+      {
+      if (s->fvalue == sub) sign = -sign;
+      next_token (s);
+      }
+    if (sign < 0) fpush (PF_NEG);
+    return 1;
+    }
+
+  switch (TYPE_MASK (s->type)) 
+    {
+    case TOK_NUMBER:
+      e = new_expr (TE_CONSTANT, 0);
+      e->dvalue = s->dvalue;
+#ifdef LINUX
+      e->dlow = s->dlow;
+#endif
+      e->ivalue = s->ivalue;
+      e->rden = s->rden;
+      ppush (e, 1, 0);
+#ifdef LINUX
+      /* KB -- in BIG mode, a whole number keeps all its digits */
+      if (big_mode && s->lit && s->next - s->lit > 15)
+        {
+        char *p = s->lit;
+        while (p < s->next && isdigit (*p)) p++;
+        if (p == s->next)
+          {
+          e->big = big_atoi (s->lit, s->next);
+          big_keep (e->big);
+          }
+        }
+#endif
+      next_token (s);
+      *done = 1;
+      return 1;
+
+    case TOK_VARIABLE:
+      e = new_expr (TE_VARIABLE, 0);
+      e->bound = s->bound;
+      e->fvalue = s->fvalue;
+      ppush (e, 1, 0);
+      next_token (s);
+      *done = 1;
+      return 1;
+
+    case TOK_LBRACK:
+      f = fpush (PF_BRACK);
+      f->narg = nnums;
+      next_token (s);
+      return 1;
+
+    case TE_FUNC0:
+    case TE_CLO0:
+      e = new_expr (s->type, 0);
+      e->fvalue = s->fvalue;
+      if (IS_CLOSURE(s->type)) e->parameters[0] = s->context;
+      ppush (e, 1, 0);
+      next_token (s);
+      if (s->type == TOK_OPEN) 
+        {
+        next_token (s);
+        if (s->type != TOK_CLOSE) return 0;
+        next_token (s);
+        }
+      fold (e);
+      pkind (&pvs[npv - 1]);
+      *done = 1;
+      return 1;
+
+    case TE_FUNC1:
+    case TE_CLO1:
+      f = fpush (PF_FN1);
+      f->node = new_expr (s->type, 0);
+      f->node->fvalue = s->fvalue;
+      if (IS_CLOSURE(s->type) || (s->type & (TE_FLAG_RED | TE_FLAG_BLK))) 
+        f->node->parameters[1] = s->context;
+      next_token (s);
+      return 1;
+
+    case TE_FUNC2: case TE_FUNC3: case TE_FUNC4:
+    case TE_FUNC5: case TE_FUNC6: case TE_FUNC7:
+    case TE_CLO2: case TE_CLO3: case TE_CLO4:
+    case TE_CLO5: case TE_CLO6: case TE_CLO7:
+      if (s->type & TE_FLAG_LOOP) return ploop (s);
+      arity = ARITY(s->type);
+      f = fpush (PF_CALL);
+      f->node = new_expr (s->type, 0);
+      f->node->fvalue = s->fvalue;
+      if (IS_CLOSURE(s->type) || (s->type & TE_FLAG_RED)) 
+        f->node->parameters[arity] = s->context;
+      next_token (s);
+      if (s->type != TOK_OPEN) return 0;
+      next_token (s);
+      return 1;
+
+    case TOK_OPEN:
+      fpush (PF_PAREN);
+      next_token (s);
+      return 1;
+    }
+  return 0;
+  }
+
+/*
+    KB -- after an operand, read what follows it: an operator, or 
+    something that ends a bracket or an argument. Returns zero on a 
+    syntax error, otherwise sets *want if an operand should follow and 
+    *end if the expression is finished.
+*/
+static int pafter (s, want, end)
+state *s;
+int *want;
+int *end;
+  {
+  pf_ent *f;
+  te_expr *e;
+  te_vec *v;
+  te_variable *g;
+  int i, prec, kind;
+
+  *want = 0;
+  *end = 0;
+  kind = 0;
+  for (i = npf - 1; i >= 0 && pfs[i].kind == PF_INFIX; i--) ;
+  if (i >= 0) kind = pfs[i].kind;
+
+  if (s->type == TOK_INFIX 
+       || (s->type == TOK_SEP && (kind == 0 || kind == PF_PAREN)))
+    {
+    if (s->type == TOK_SEP)
+      prec = 1;
+    else if (s->fvalue == te_or)
+      prec = 2;
+    else if (s->fvalue == te_xor)
+      prec = 3;
+    else if (s->fvalue == te_and)
+      prec = 4;
+    else if (s->fvalue == te_shl || s->fvalue == te_shr)
+      prec = 5;
+    else if (s->fvalue == add || s->fvalue == sub)
+      prec = 6;
+    else if (s->fvalue == _pow)
+      prec = 8;
+    else
+      prec = 7;
+    pinfix (prec);
+    f = fpush (PF_INFIX);
+    f->prec = prec;
+    if (s->type == TOK_SEP)
+      f->f = comma;
+    else
+      f->f = s->fvalue;
+    next_token (s);
+    *want = 1;
+    return 1;
+    }
+
+  pinfix (1);
+  f = npf > 0 ? &pfs[npf - 1] : 0;
+  switch (kind)
+    {
+    case 0:
+      if (s->type != TOK_END) return 0;
+      *end = 1;
+      return 1;
+
+    case PF_PAREN:
+      if (s->type != TOK_CLOSE) return 0;
+      npf--;
+      next_token (s);
+      return 1;
+
+    case PF_CALL:
+    case PF_LARG:
+      if (s->type != TOK_SEP && s->type != TOK_CLOSE) return 0;
+      parg (f);
+      if (s->type == TOK_SEP)
+        {
+        if (f->narg >= ARITY(f->node->type)) return 0;
+        next_token (s);
+        *want = 1;
+        return 1;
+        }
+      if (f->narg != ARITY(f->node->type)) return 0;
+      next_token (s);
+      pcall (f);
+      return 1;
+
+    case PF_RED:
+      if (s->type != TOK_CLOSE) return 0;
+      parg (f);
+      next_token (s);
+      pcall (f);
+      return 1;
+
+    case PF_LOOP:
+      parg (f);
+      if (s->type == TOK_SEP) next_token (s);
+      if (s->type != TOK_VARIABLE || s->bound != f->local->address) 
+        return 0;
+      /* KB -- a formula (:=) in the expression that uses the variable 
+         of the same name would be worked out for that variable, not
+         for the call's, so it is refused */
+      g = find_lookup (s, f->local->name, f->local->len);
+      if (g && TYPE_MASK (g->type) == TE_VARIABLE && te_deps (s->lookup, 
+          s->lookup_len, f->node->parameters[0], g))
+        longjmp (err_jump, E_LOOPDEF);
+      next_token (s);
+      s->locals = f->local->prev;
+      free (f->local);
+      f->local = 0;
+      f->kind = PF_LARG;
+      if (s->type != TOK_SEP) return 0;
+      next_token (s);
+      *want = 1;
+      return 1;
+
+    case PF_BRACK:
+      if (s->type != TOK_SEP && s->type != TOK_RBRACK) return 0;
+      pnums = pgrow (pnums, nnums, &maxnums, sizeof (double));
+      pnums[nnums++] = te_eval (pvs[npv - 1].e);
+      te_free (pvs[--npv].e);
+      if (s->type == TOK_SEP)
+        {
+        next_token (s);
+        *want = 1;
+        return 1;
+        }
+      if ((v = te_vnew (nnums - f->narg)) == 0) longjmp (err_jump, E_NOMEM);
+      _memcpy (v->v, pnums + f->narg, v->n * sizeof (double));
+      nnums = f->narg;
+      npf--;
+      e = new_expr (TE_CONSTANT | TE_FLAG_VEC, 0);
+      e->fvalue = v;
+      ppush (e, 1, 0);
+      next_token (s);
+      return 1;
+    }
+  return 0;
+  }
+
+/*
+   Build the syntax tree.
+*/
+te_expr *te_compile (expression, variables, var_count, error) 
+char *expression;
+te_variable *variables;
+int var_count;
+int *error;
+  {
+  state s;
+  te_expr *root; 
+  int want = 1, done, end = 0;
+  pclear ();
+  s.start = s.next = expression;
+  s.lookup = variables;
+  s.lookup_len = var_count;
+  s.locals = 0;
+
+  next_token(&s);
+  while (!end)
+    {
+    if (want)
+      {
+      if (!pbase (&s, &done)) break;
+      if (!done) continue;
+      }
+    pprefix ();
+    if (!pafter (&s, &want, &end)) break;
+    }
+
+  if (!end) 
+    {
+    pclear ();
+    if (error) 
+      {
+      *error = (s.next - s.start);
+      if (*error == 0) *error = 1;
+      }
+    return 0;
+    } 
+  root = pvs[--npv].e;
+  pclear ();
+  if (error) *error = 0;
+  return root;
+  }
+
+/*
+   Evaluate a specific node in the syntax tree. 
+*/
+
+#define M(e) te_eval (n->parameters[e])
+
+double te_eval (n) 
+te_expr *n;
+  {
+  double a, b, r;
+  if (!n) return NAN; /* Should not happen */
+
+  /* KB -- a function like SUM gets its expression unevaluated, with the
+     address of the variable it is to vary, followed by its other 
+     arguments. A long chain of operators, and a polynomial, have code
+     of their own (tested for here to keep it off the common path). */
+  if (n->type & (TE_FLAG_LOOP | TE_FLAG_DEEP | TE_FLAG_POLY))
+    {
+    if (n->type & TE_FLAG_DEEP) return te_chain (n);
+    if (n->type & TE_FLAG_POLY) return te_horner (n);
+    a = M(1);
+    b = ARITY(n->type) > 2 ? M(2) : 0.0;
+    return ((te_funl)n->fvalue) (n->parameters[0], &n->dvalue, a, b);
+    }
+
+  switch (TYPE_MASK(n->type)) 
+    {
     /* KB -- I've removed some of the logic from the original tineyexpr
        here, that will not be used by KCalc-CPM. In particular, not
        function has more than two arguments. */
 
-    case TE_CONSTANT: return n->dvalue;
-    case TE_VARIABLE: return *n->bound;
+    case TE_CONSTANT: 
+      if (n->type & TE_FLAG_VEC) longjmp (err_jump, E_VECTOR);
+      return n->dvalue;
+    case TE_VARIABLE: 
+      if (n->fvalue && (((te_variable *)n->fvalue)->type & TE_FLAG_VEC))
+        longjmp (err_jump, E_VECTOR);
+      return *n->bound;
 
+    /* KB -- results of expensive functions may be cached */
     case TE_FUNC1:
-      return ((te_fun1)n->fvalue) (M(0));
+      a = M(0);
+      if ((n->type & TE_FLAG_MEMO) && memo_on)
+        {
+        if (memo_get (n->fvalue, a, 0.0, &r)) return r;
+        r = ((te_fun1)n->fvalue) (a);
+        memo_put (n->fvalue, a, 0.0, r);
+        return r;
+        }
+      return ((te_fun1)n->fvalue) (a);
 
     case TE_FUNC2:
-      return ((te_fun2)n->fvalue) (M(0), M(1));
+      a = M(0);
+      b = M(1);
+      if ((n->type & TE_FLAG_MEMO) && memo_on)
+        {
+        if (memo_get (n->fvalue, a, b, &r)) return r;
+        r = ((te_fun2)n->fvalue) (a, b);
+        memo_put (n->fvalue, a, b, r);
+        return r;
+        }
+      return ((te_fun2)n->fvalue) (a, b);
 
     default: return 42;
     }
@@ -630,47 +1653,1715 @@ te_expr *n;
   }
 
 /*
-    Parse the input express to a syntax tree, and evaluate it to
-    a number. 
-    KB -- I've added some error return codes here, so the caller
-    can format a slightly better error message. On exit, rt_error is
-    set if an error occured either when parsing or evaluating the
-    expression. 
+    KB -- evaluate a polynomial. One of low degree is evaluated by
+    Horner's rule. For higher degrees, the even and odd terms are each
+    evaluated by Horner's rule in x^2, and then added (the first step
+    of Estrin's scheme): half as many turns of the loop, and two chains
+    of multiplications that don't wait for each other.
 */
-double te_interp (expression, error_pos, rt_error, vars, nvars) 
+static double te_horner (n)
+te_expr *n;
+  {
+  te_vec *k = n->parameters[1];
+  double *c = k->v;
+  double x = M(0), x2, e, o;
+  int i = k->n - 1;
+  if (i < POLY_SPLIT)
+    {
+    e = c[i];
+    while (--i >= 0) e = e * x + c[i];
+    return e;
+    }
+  x2 = x * x;
+  if (i & 1)
+    {
+    o = c[i];
+    e = c[i - 1];
+    i -= 2;
+    }
+  else
+    {
+    e = c[i];
+    o = 0.0;
+    i--;
+    }
+  for (; i > 0; i -= 2)
+    {
+    o = o * x2 + c[i];
+    e = e * x2 + c[i - 1];
+    }
+  return e + x * o;
+  }
+
+/*
+    KB -- evaluate a long chain of operators, a link at a time: the 
+    bottom of the chain first, then each node's right-hand argument and
+    its operator, in the same order as te_eval() would
+*/
+static double te_chain (n)
+te_expr *n;
+  {
+  double a, b, r;
+  int top = nspine, i;
+  a = te_eval (climb (n));
+  for (i = nspine - 1; i >= top; i--)
+    {
+    n = spine[i];
+    b = M(1);
+    if ((n->type & TE_FLAG_MEMO) && memo_on)
+      {
+      if (!memo_get (n->fvalue, a, b, &r))
+        {
+        r = ((te_fun2)n->fvalue) (a, b);
+        memo_put (n->fvalue, a, b, r);
+        }
+      a = r;
+      }
+    else
+      a = ((te_fun2)n->fvalue) (a, b);
+    }
+  nspine = top;
+  return a;
+  }
+
+/*
+    KB -- compile an expression, trapping any error raised by longjmp()
+    during compilation (unknown identifiers, or errors in parts of the
+    expression that can be evaluated at compile time). Error codes are 
+    returned as for te_interp().
+*/
+te_expr *te_build (expression, error_pos, rt_error, vars, nvars) 
 char *expression;
 int *error_pos;
-te_variable *vars[];
-int nvars;
 int *rt_error;
+te_variable *vars;
+int nvars;
   {
-  double ret;
   te_expr *n;
   int rt_err = setjmp (err_jump);
- 
-  /* KB -- This is where we end up if any math function raises an exception
-     using longjmp(), as well as during normal execution. The return 
-     value from setjmp() allows us to separate these two cases. */
-
   if (rt_err != 0)
     {
+    pclear ();
+    nspine = 0;
     *error_pos = -1;
     *rt_error = rt_err;
-    return NAN;
+    return 0;
     }
   *error_pos = 0;
   *rt_error = 0;
+  rough = 0;
+  lost = 1.0;
   n = te_compile (expression, vars, nvars, error_pos);
+  if (!n) *rt_error = E_SYNTAX;
+  return n;
+  }
+
+/*
+    KB -- recompute any out-of-date definitions that an expression uses
+*/
+static void stale (n, vars, nvars)
+te_expr *n;
+te_variable *vars;
+int nvars;
+  {
+  int i;
+  for (i = 0; i < nvars; i++)
+    {
+    te_variable *v = &vars[i];
+    if (v->name && (v->type & TE_FLAG_DIRTY) && te_refs (n, v->address))
+      refresh (vars, nvars, v);
+    }
+  }
+
+/*
+    KB -- evaluate a compiled expression, returning an error code rather
+    than jumping out. Any defined variables that the expression uses 
+    and that are out of date are recomputed first -- when an expression 
+    is compiled once and evaluated many times, that can't be left to
+    the compiler. vars may be 0 if no recomputation is needed.
+    Like te_interp(), this sets err_jump, so it must not be called from
+    inside an evaluation.
+*/
+int te_try (n, vars, nvars, result) 
+te_expr *n;
+te_variable *vars;
+int nvars;
+double *result;
+  {
+  int rt_err = setjmp (err_jump);
+  if (rt_err != 0) 
+    {
+    nspine = 0;
+    return rt_err;
+    }
+  stale (n, vars, nvars);
+  *result = te_eval (n);
+  return 0;
+  }
+
+/*
+    Parse the input express to a syntax tree, and evaluate it to
+    a number. 
+    KB -- I've added some error return codes here, so the caller
+    can format a slightly better error message. On exit, rt_error is
+    set if an error occured either when parsing or evaluating the
+    expression. 
+*/
+double te_interp (expression, error_pos, rt_error, vars, nvars) 
+char *expression;
+int *error_pos;
+te_variable *vars;
+int nvars;
+int *rt_error;
+  {
+  double ret = NAN;
+  te_expr *n;
+
+  /* KB -- any math function can raise an exception using longjmp(); 
+     te_build() and te_try() turn these into error codes. */
+
+  n = te_build (expression, error_pos, rt_error, vars, nvars);
   if (n) 
     {
-    ret = te_eval(n);
+    *rt_error = te_try (n, 0, 0, &ret);
+    if (*rt_error) 
+      {
+      *error_pos = -1;
+      ret = NAN;
+      }
     te_free(n);
     } 
-  else 
+  return ret;
+  }
+
+/*
+    KB -- return non-zero if the expression reads the variable at the
+    given address. 
+*/
+static int te_refs (n, address) 
+te_expr *n;
+double *address;
+  {
+  int i, arity = 0;
+  for (; n; n = arity ? n->parameters[0] : 0)
     {
-    ret = NAN;
-    *rt_error = E_SYNTAX;
+    if (TYPE_MASK(n->type) == TE_VARIABLE) return n->bound == address;
+    arity = ARITY(n->type);
+    for (i = 1; i < arity; i++)
+      {
+      if (te_refs (n->parameters[i], address)) return 1;
+      }
     }
-  return ret;
+  return 0;
+  }
+
+/*
+    KB -- return non-zero if the expression depends on the variable,
+    either directly or through the definitions of other variables. 
+*/
+int te_deps (vars, nvars, n, var) 
+te_variable *vars;
+int nvars;
+te_expr *n;
+te_variable *var;
+  {
+  int i;
+  if (te_refs (n, var->address)) return 1;
+  for (i = 0; i < nvars; i++)
+    {
+    te_variable *v = &vars[i];
+    if (v != var && v->name && (v->type & TE_FLAG_DEFN)
+         && te_refs (n, v->address) && te_deps (vars, nvars, v->context, var))
+      return 1;
+    }
+  return 0;
+  }
+
+/*
+    KB -- return non-zero if the expression calls a function that gives
+    a different value every time, like UNIFORM. Such functions are the 
+    only ones that are neither pure nor make vectors.
+*/
+int te_random (n) 
+te_expr *n;
+  {
+  int i, arity = 0;
+  for (; n; n = arity ? n->parameters[0] : 0)
+    {
+    if (TYPE_MASK(n->type) == TE_VARIABLE) return 0;
+    arity = ARITY(n->type);
+    if ((n->type & TE_FUNC0) 
+         && !(n->type & (TE_FLAG_PURE | TE_FLAG_GEN))) return 1;
+    for (i = 1; i < arity; i++)
+      {
+      if (te_random (n->parameters[i])) return 1;
+      }
+    }
+  return 0;
   }
 
+/*
+    KB -- recompute a defined variable. Any of its inputs that are 
+    themselves out of date are recomputed first, so a chain of definitions
+    is evaluated in dependency order, and only those definitions
+    affected by a change are evaluated at all. Errors longjmp out in
+    the usual way, leaving the variable marked dirty.
+*/
+static void refresh (vars, nvars, var) 
+te_variable *vars;
+int nvars;
+te_variable *var;
+  {
+  int i, prec = fn_prec;
+  for (i = 0; i < nvars; i++)
+    {
+    te_variable *v = &vars[i];
+    if (v->name && (v->type & TE_FLAG_DIRTY) 
+         && te_refs (var->context, v->address))
+      refresh (vars, nvars, v);
+    }
+  /* KB -- a definition keeps its value, so it is worked out in full, 
+     however few digits the expression that uses it needs */
+  fn_prec = 0;
+#ifdef LINUX
+  var->lo = 0.0;
+  big_free (var->big);
+  var->big = 0;
+  if (big_mode && !te_isvec (var->context))
+    {
+    var->big = big_dup (be (var->context));
+    big_keep (var->big);
+    *(double *)var->address = big_dbl (var->big);
+    }
+  else
+  if (dd_mode && !te_isvec (var->context))
+    {
+    dd_real x;
+    dde (var->context, &x);
+    *(double *)var->address = x.hi;
+    var->lo = x.lo;
+    }
+  else
+#endif
+  if (int_mode && !te_isvec (var->context))
+    {
+    var->ival = ie (var->context);
+    *(double *)var->address = (double)var->ival;
+    }
+  else if (fix_mode && !te_isvec (var->context))
+    {
+    var->ival = fe (var->context);
+    var->rden = -fix_bits;
+    *(double *)var->address = fix_dbl (var->ival);
+    }
+  else if (base_mode == BM_FRAC && !te_isvec (var->context))
+    {
+    rat_num x;
+    re (var->context, &x);
+    *(double *)var->address = rat_dbl (&x);
+    var->ival = x.p;
+    var->rden = RAT_DEN (&x);
+    }
+  else
+  *(double *)var->address = te_isvec (var->context) 
+    ? vscalar (var->context) : te_eval (var->context);
+  var->type &= ~TE_FLAG_DIRTY;
+  fn_prec = prec;
+  }
+
+/*
+    KB -- mark every definition that depends on a variable as dirty. A
+    dirty variable's dependents are always dirty already, so there is no
+    need to follow the graph past one.
+*/
+void te_touch (vars, nvars, var) 
+te_variable *vars;
+int nvars;
+te_variable *var;
+  {
+  int i;
+  for (i = 0; i < nvars; i++)
+    {
+    te_variable *v = &vars[i];
+    if (v->name && (v->type & (TE_FLAG_DEFN | TE_FLAG_DIRTY)) == TE_FLAG_DEFN
+         && te_refs (v->context, var->address))
+      {
+      v->type |= TE_FLAG_DIRTY;
+      te_touch (vars, nvars, v);
+      }
+    }
+  }
+
+/*
+    KB -- compile an expression and attach it to a variable as its 
+    definition. The variable is not evaluated until it is next used. 
+    Error codes are returned as for te_interp().
+*/
+void te_define (expression, error_pos, rt_error, var, vars, nvars) 
+char *expression;
+int *error_pos;
+int *rt_error;
+te_variable *var;
+te_variable *vars;
+int nvars;
+  {
+  te_expr *n = te_build (expression, error_pos, rt_error, vars, nvars);
+  if (!n) return;
+  if (te_deps (vars, nvars, n, var))
+    {
+    te_free (n);
+    *error_pos = -1;
+    *rt_error = E_CYCLE;
+    return;
+    }
+  if (var->context) te_free (var->context);
+  var->context = n;
+  var->type = TE_VARIABLE | TE_FLAG_DEFN | TE_FLAG_DIRTY;
+  te_touch (vars, nvars, var);
+  }
+
+/*
+    KB -- writing an expression as C. Operators are written as C 
+    operators, except for / and %, which go to te_div() and te_mod() so
+    that they check for zero as kcalc does; functions are written as 
+    KC_name (...) macros (see kcode.h); a polynomial is written out by 
+    Horner's rule; and variables other than the parameters are written 
+    as their present values. Nothing is written if cout is zero, so that
+    the expression can be checked before anything is output. 
+*/
+static te_variable *cpars;
+static int ncpars;
+static te_variable *cvars;
+static int ncvars;
+static int cout;
+
+static void cputs (s)
+char *s;
+  {
+  if (cout) printf ("%s", s);
+  }
+
+static void cnum (x)
+double x;
+  {
+  char buff[32];
+  if (x - x != 0) longjmp (err_jump, E_NOCODE);
+  sprintf (buff, "%.17g", x);
+  /* A whole number must still be a double, since K&R functions get 
+     their arguments unconverted */
+  if (!_strchr (buff, '.') && !_strchr (buff, 'e')) strcat (buff, ".0");
+  cputs (buff);
+  }
+
+/* Write a name in lower case, as C programmers will expect */
+static void cname (s)
+char *s;
+  {
+  char c[2];
+  c[1] = 0;
+  while (*s)
+    {
+    c[0] = tolower (*s++);
+    cputs (c);
+    }
+  }
+
+static void cemit (); 
+
+/* The function for a bitwise operator, or 0 if f is not one */
+static char *cbits (f)
+void *f;
+  {
+  if (f == te_and) return "te_and";
+  if (f == te_or) return "te_or";
+  if (f == te_xor) return "te_xor";
+  if (f == te_shl) return "te_shl";
+  if (f == te_shr) return "te_shr";
+  return 0;
+  }
+
+/* The start, middle and end of a two-argument operator or function */
+static void cpre (n)
+te_expr *n;
+  {
+  char *s;
+  int i;
+  if (n->fvalue == add || n->fvalue == sub || n->fvalue == mul 
+       || n->fvalue == comma) 
+    {
+    cputs ("(");
+    return;
+    }
+  if (n->fvalue == divide) 
+    {
+    cputs ("te_div (");
+    return;
+    }
+  if (n->fvalue == fmod) 
+    {
+    cputs ("te_mod (");
+    return;
+    }
+  if ((s = cbits (n->fvalue)) != 0)
+    {
+    cputs (s);
+    cputs (" (");
+    return;
+    }
+  for (i = 0; i < ncvars; i++)
+    if (cvars[i].name && cvars[i].address == n->fvalue
+         && TYPE_MASK (cvars[i].type) == TYPE_MASK (n->type))
+      {
+      cputs ("KC_");
+      cputs (cvars[i].name);
+      cputs (" (");
+      return;
+      }
+  longjmp (err_jump, E_NOCODE);
+  }
+
+static char *cmid (n)
+te_expr *n;
+  {
+  if (n->fvalue == add) return " + ";
+  if (n->fvalue == sub) return " - ";
+  if (n->fvalue == mul) return " * ";
+  return ", ";
+  }
+
+static void cpoly (n)
+te_expr *n;
+  {
+  te_vec *k = n->parameters[1];
+  int i;
+  for (i = 1; i < k->n; i++) cputs ("(");
+  cnum (k->v[k->n - 1]);
+  for (i = k->n - 2; i >= 0; i--)
+    {
+    cputs (" * ");
+    cemit (n->parameters[0]);
+    if (k->v[i] != 0)
+      {
+      cputs (" + ");
+      cnum (k->v[i]);
+      }
+    cputs (")");
+    }
+  }
+
+/* A chain of two-argument operators is written a link at a time, as 
+   te_chain() evaluates it, so that a long one doesn't use up the stack */
+static void cemit (n)
+te_expr *n;
+  {
+  int top, i;
+  if (n->type & (TE_FLAG_LOOP | TE_FLAG_RED)) longjmp (err_jump, E_NOCODE);
+  if (n->type & TE_FLAG_POLY)
+    {
+    cpoly (n);
+    return;
+    }
+  switch (TYPE_MASK(n->type))
+    {
+    case TE_CONSTANT:
+      if (n->type & TE_FLAG_VEC) longjmp (err_jump, E_VECTOR);
+      cnum (n->dvalue);
+      return;
+    case TE_VARIABLE:
+      for (i = 0; i < ncpars; i++)
+        if (n->bound == cpars[i].address)
+          {
+          cname (cpars[i].name);
+          return;
+          }
+      if (n->fvalue && (((te_variable *)n->fvalue)->type & TE_FLAG_VEC))
+        longjmp (err_jump, E_VECTOR);
+      cnum (*n->bound);
+      return;
+    case TE_FUNC1:
+      if (n->fvalue == negate)
+        cputs ("(- ");
+      else
+        cpre (n);
+      cemit (n->parameters[0]);
+      cputs (")");
+      return;
+    case TE_FUNC2:
+      top = nspine;
+      n = climb (n);
+      for (i = top; i < nspine; i++) cpre (spine[i]);
+      cemit (n);
+      for (i = nspine - 1; i >= top; i--)
+        {
+        cputs (cmid (spine[i]));
+        cemit (spine[i]->parameters[1]);
+        cputs (")");
+        }
+      nspine = top;
+      return;
+    }
+  longjmp (err_jump, E_NOCODE);
+  }
+
+/*
+    KB -- write a compiled expression as a C expression, if it can be 
+    written at all, recomputing any out-of-date definitions first. 
+    params are the variables that are the C function's parameters; other
+    variables are written as their values. Returns an error code, as 
+    te_try() does.
+*/
+int te_code (n, vars, nvars, params, nparams, out)
+te_expr *n;
+te_variable *vars;
+int nvars;
+te_variable *params;
+int nparams;
+int out;
+  {
+  int rt_err = setjmp (err_jump);
+  if (rt_err != 0) 
+    {
+    nspine = 0;
+    return rt_err;
+    }
+  stale (n, vars, nvars);
+  cpars = params;
+  ncpars = nparams;
+  cvars = vars;
+  ncvars = nvars;
+  cout = out;
+  cemit (n);
+  return 0;
+  }
+
+/*
+    KB -- evaluating in integers (INT mode). This follows te_eval(), with 
+    a te_int in place of a double. Arithmetic is done unsigned, so that 
+    it wraps around rather than overflowing, and division truncates 
+    towards zero, as C's does. A constant or a variable has its value as
+    an integer as well as a double, and the integer is used unless the
+    double has been changed since it was set. Functions with no integer 
+    version, and vectors, are errors.
+*/
+static te_int iget (i, d)
+te_int i;
+double d;
+  {
+  return (double)i == d ? i : te_toint (d);
+  }
+
+/* a to the power b, or 0 if that is less than 1 in magnitude */
+static te_int ipow (a, b)
+te_int a;
+te_int b;
+  {
+  te_uint r = 1, x = a;
+  if (b < 0)
+    {
+    if (a == 0) longjmp (err_jump, E_DIVZ);
+    if (a == 1) return 1;
+    if (a == -1) return (b & 1) ? -1 : 1;
+    return 0;
+    }
+  for (; b; b >>= 1)
+    {
+    if (b & 1) r *= x;
+    x *= x;
+    }
+  return (te_int)r;
+  }
+
+static te_int iop (n, a, b)
+te_expr *n;
+te_int a;
+te_int b;
+  {
+  void *f = n->fvalue;
+  if (f == add) return (te_int)((te_uint)a + (te_uint)b);
+  if (f == sub) return (te_int)((te_uint)a - (te_uint)b);
+  if (f == mul) return (te_int)((te_uint)a * (te_uint)b);
+  if (f == divide || f == fmod)
+    {
+    if (b == 0) longjmp (err_jump, E_DIVZ); 
+    /* TE_IMIN / -1 overflows */
+    if (b == -1) return f == fmod ? 0 : (te_int)(0 - (te_uint)a);
+    return f == fmod ? a % b : a / b;
+    }
+  if (f == negate) return (te_int)(0 - (te_uint)a);
+  if (f == comma) return b;
+  if (f == te_and) return a & b;
+  if (f == te_or) return a | b;
+  if (f == te_xor) return a ^ b;
+  if (f == te_shl) return ishift (a, b, 1);
+  if (f == te_shr) return ishift (a, b, 0);
+  if (f == _pow) return ipow (a, b);
+  if (f == fabs) return a < 0 ? (te_int)(0 - (te_uint)a) : a;
+  if (f == floor || f == ceil) return a;
+  longjmp (err_jump, E_NOINT);
+  return 0;
+  }
+
+static te_int ie (n)
+te_expr *n;
+  {
+  te_variable *v;
+  te_vec *k;
+  te_int a, x;
+  int top, i;
+
+  if (n->type & (TE_FLAG_LOOP | TE_FLAG_RED)) longjmp (err_jump, E_NOINT);
+  if (n->type & TE_FLAG_POLY)
+    {
+    /* Made before INT mode was turned on */
+    k = n->parameters[1];
+    x = ie (n->parameters[0]);
+    a = te_toint (k->v[k->n - 1]);
+    for (i = k->n - 2; i >= 0; i--)
+      a = (te_int)((te_uint)a * (te_uint)x + (te_uint)te_toint (k->v[i]));
+    return a;
+    }
+
+  switch (TYPE_MASK(n->type))
+    {
+    case TE_CONSTANT:
+      if (n->type & TE_FLAG_VEC) longjmp (err_jump, E_VECTOR);
+      return iget (n->ivalue, n->dvalue);
+    case TE_VARIABLE:
+      v = n->fvalue;
+      if (v && (v->type & TE_FLAG_VEC)) longjmp (err_jump, E_VECTOR);
+      return v ? iget (v->ival, *n->bound) : te_toint (*n->bound);
+    case TE_FUNC1:
+      a = ie (n->parameters[0]);
+      return iop (n, a, a);
+    case TE_FUNC2:
+      top = nspine;
+      a = ie (climb (n));
+      for (i = nspine - 1; i >= top; i--)
+        a = iop (spine[i], a, ie (spine[i]->parameters[1]));
+      nspine = top;
+      return a;
+    }
+  longjmp (err_jump, E_NOINT);
+  return 0;
+  }
+
+/*
+    KB -- evaluate a compiled expression in integers, as te_try() does
+*/
+int te_itry (n, vars, nvars, result)
+te_expr *n;
+te_variable *vars;
+int nvars;
+te_int *result;
+  {
+  int rt_err = setjmp (err_jump);
+  if (rt_err != 0) 
+    {
+    nspine = 0;
+    return rt_err;
+    }
+  stale (n, vars, nvars);
+  *result = ie (n);
+  return 0;
+  }
+
+/*
+    KB -- evaluating in fractions (FRAC mode, see rat.c). This follows 
+    te_eval(), with a rat_num in place of a double. A constant or a
+    variable has its value as a fraction, as well as a double, and the
+    fraction is used unless the double has been changed since it was 
+    set. One that was worked out in FRAC mode and wasn't a fraction 
+    stays a double. Anything that can't be done in fractions -- 
+    functions like SIN, sums, and results too big for a fraction -- is
+    done in floating point, and the result is then just a double; 
+    vectors are errors.
+*/
+static void rget (p, q, d, r)
+te_int p;
+te_int q;
+double d;
+rat_num *r;
+  {
+  if (q > 0 && (double)p / (double)q == d)
+    {
+    r->p = p;
+    r->q = q;
+    }
+  else if (q == RAT_INEX)
+    {
+    r->q = 0;
+    r->d = d;
+    }
+  else
+    rat_of (d, r);
+  }
+
+/* r = floor (a) or ceil (a), for a fraction */
+static void rfloor (a, up, r)
+rat_num *a;
+int up;
+rat_num *r;
+  {
+  te_int f = a->p / a->q;
+  if (f * a->q != a->p && (a->p < 0) != up) f += up ? 1 : -1;
+  r->p = f;
+  r->q = 1;
+  }
+
+static void rop (n, a, b, r)
+te_expr *n;
+rat_num *a;
+rat_num *b;
+rat_num *r;
+  {
+  void *f = n->fvalue;
+  if (f == add) rat_add (a, b, r);
+  else if (f == sub) rat_sub (a, b, r);
+  else if (f == mul) rat_mul (a, b, r);
+  else if (f == divide) rat_div (a, b, r);
+  else if (f == fmod) rat_mod (a, b, r);
+  else if (f == _pow) rat_pow (a, b, r);
+  else if (f == comma) *r = *b;
+  else if (f == negate && a->q && a->p != TE_IMIN)
+    {
+    r->p = -a->p;
+    r->q = a->q;
+    }
+  else if (f == fabs && a->q && a->p != TE_IMIN)
+    {
+    r->p = a->p < 0 ? -a->p : a->p;
+    r->q = a->q;
+    }
+  else if ((f == floor || f == ceil) && a->q)
+    rfloor (a, f == ceil, r);
+  else if (a->q == 1 && b->q == 1 && (f == te_and || f == te_or 
+       || f == te_xor || f == te_shl || f == te_shr))
+    {
+    r->p = iop (n, a->p, b->p);
+    r->q = 1;
+    }
+  else
+    {
+    r->d = ARITY (n->type) == 1 ? ((te_fun1)f) (rat_dbl (a))
+      : ((te_fun2)f) (rat_dbl (a), rat_dbl (b));
+    r->q = 0;
+    }
+  }
+
+static void re (n, r)
+te_expr *n;
+rat_num *r;
+  {
+  te_variable *v;
+  te_vec *k;
+  rat_num a, b;
+  int top, i;
+
+  /* Sums and the like are worked out by te_eval(), as are other nodes
+     that aren't arithmetic, at the end */
+  if (n->type & (TE_FLAG_LOOP | TE_FLAG_RED)) 
+    {
+    r->d = te_eval (n);
+    r->q = 0;
+    return;
+    }
+  if (n->type & TE_FLAG_POLY)
+    {
+    /* Made before FRAC mode was turned on */
+    k = n->parameters[1];
+    re (n->parameters[0], &a);
+    rat_of (k->v[k->n - 1], r);
+    for (i = k->n - 2; i >= 0; i--)
+      {
+      rat_mul (r, &a, r);
+      rat_of (k->v[i], &b);
+      rat_add (r, &b, r);
+      }
+    return;
+    }
+
+  switch (TYPE_MASK(n->type))
+    {
+    case TE_CONSTANT:
+      if (n->type & TE_FLAG_VEC) longjmp (err_jump, E_VECTOR);
+      rget (n->ivalue, n->rden, n->dvalue, r);
+      return;
+    case TE_VARIABLE:
+      v = n->fvalue;
+      if (v && (v->type & TE_FLAG_VEC)) longjmp (err_jump, E_VECTOR);
+      if (v)
+        rget (v->ival, v->rden, *n->bound, r);
+      else
+        rat_of (*n->bound, r);
+      return;
+    case TE_FUNC1:
+      re (n->parameters[0], &a);
+      rop (n, &a, &a, r);
+      return;
+    case TE_FUNC2:
+      top = nspine;
+      re (climb (n), &a);
+      for (i = nspine - 1; i >= top; i--)
+        {
+        re (spine[i]->parameters[1], &b);
+        rop (spine[i], &a, &b, &a);
+        }
+      nspine = top;
+      *r = a;
+      return;
+    }
+  r->d = te_eval (n);
+  r->q = 0;
+  }
+
+/*
+    KB -- evaluate a compiled expression in fractions, as te_try() does
+*/
+int te_rtry (n, vars, nvars, result)
+te_expr *n;
+te_variable *vars;
+int nvars;
+rat_num *result;
+  {
+  int rt_err = setjmp (err_jump);
+  if (rt_err != 0) 
+    {
+    nspine = 0;
+    return rt_err;
+    }
+  stale (n, vars, nvars);
+  re (n, result);
+  return 0;
+  }
+
+/*
+    KB -- evaluating in fixed point (FIXED mode, see fix.c). This follows
+    ie(), with fix.c's arithmetic in place of the integer kind. A 
+    constant or variable whose fixed-point value is held with the 
+    current number of fraction bits, and hasn't been changed since, has
+    that value used; anything else is converted from its double. 
+    Functions with no fixed-point version, sums and the like, and 
+    vectors, are errors.
+*/
+static te_int fget (i, q, d)
+te_int i;
+te_int q;
+double d;
+  {
+  te_int r;
+  if (q == -fix_bits && fix_dbl (i) == d) return i;
+  if (!fix_of (d, &r)) longjmp (err_jump, E_FIXBIG);
+  return r;
+  }
+
+static te_int fop (n, a, b)
+te_expr *n;
+te_int a;
+te_int b;
+  {
+  void *f = n->fvalue;
+  fix_fun k;
+  if (f == add) return fix_add (a, b);
+  if (f == sub) return fix_sub (a, b);
+  if (f == mul) return fix_mul (a, b);
+  if (f == divide) return fix_div (a, b);
+  if (f == fmod) return fix_mod (a, b);
+  if (f == negate) return fix_sub (0, a);
+  if (f == comma) return b;
+  if ((k = fix_kern (f)) != 0) return (*k) (a, b);
+  longjmp (err_jump, E_NOFIX);
+  return 0;
+  }
+
+static te_int fe (n)
+te_expr *n;
+  {
+  te_variable *v;
+  te_vec *k;
+  te_int a, x;
+  int top, i;
+
+  if (n->type & (TE_FLAG_LOOP | TE_FLAG_RED)) longjmp (err_jump, E_NOFIX);
+  if (n->type & TE_FLAG_POLY)
+    {
+    /* Made before FIXED mode was turned on */
+    k = n->parameters[1];
+    x = fe (n->parameters[0]);
+    a = fget (0, 0, k->v[k->n - 1]);
+    for (i = k->n - 2; i >= 0; i--)
+      a = fix_add (fix_mul (a, x), fget (0, 0, k->v[i]));
+    return a;
+    }
+
+  switch (TYPE_MASK(n->type))
+    {
+    case TE_CONSTANT:
+      if (n->type & TE_FLAG_VEC) longjmp (err_jump, E_VECTOR);
+      return fget (n->ivalue, n->rden, n->dvalue);
+    case TE_VARIABLE:
+      v = n->fvalue;
+      if (v && (v->type & TE_FLAG_VEC)) longjmp (err_jump, E_VECTOR);
+      return v ? fget (v->ival, v->rden, *n->bound) 
+        : fget (0, 0, *n->bound);
+    case TE_FUNC1:
+      a = fe (n->parameters[0]);
+      return fop (n, a, a);
+    case TE_FUNC2:
+      top = nspine;
+      a = fe (climb (n));
+      for (i = nspine - 1; i >= top; i--)
+        a = fop (spine[i], a, fe (spine[i]->parameters[1]));
+      nspine = top;
+      return a;
+    }
+  longjmp (err_jump, E_NOFIX);
+  return 0;
+  }
+
+/*
+    KB -- evaluate a compiled expression in fixed point, as te_try() 
+    does
+*/
+int te_ftry (n, vars, nvars, result)
+te_expr *n;
+te_variable *vars;
+int nvars;
+te_int *result;
+  {
+  int rt_err = setjmp (err_jump);
+  if (rt_err != 0) 
+    {
+    nspine = 0;
+    return rt_err;
+    }
+  stale (n, vars, nvars);
+  *result = fe (n);
+  return 0;
+  }
+
+#ifdef LINUX
+/*
+    KB -- evaluating in double-double arithmetic (DD mode, see dd.c). 
+    This follows te_eval(), with a value of two doubles in place of one;
+    the low part of a constant is kept in its node, and that of a 
+    variable in its te_variable. Functions without a double-double 
+    version, and vectors, are errors rather than being quietly worked 
+    out to double precision.
+*/
+static void ddop (n, a, b, r)
+te_expr *n;
+dd_real *a;
+dd_real *b;
+dd_real *r;
+  {
+  void *f = n->fvalue;
+  dd_fun k;
+  if (f == add) dd_add (a, b, r);
+  else if (f == sub) dd_sub (a, b, r);
+  else if (f == mul) dd_mul (a, b, r);
+  else if (f == divide)
+    {
+    if (b->hi == 0) longjmp (err_jump, E_DIVZ); 
+    dd_div (a, b, r);
+    }
+  else if (f == negate)
+    {
+    r->hi = -a->hi;
+    r->lo = -a->lo;
+    }
+  else if (f == comma) *r = *b;
+  else if (f == fmod) dd_mod (a, b, r);
+  else if ((k = dd_kern (f)) != 0) k (a, b, r);
+  else longjmp (err_jump, E_NODD);
+  }
+
+static void dde (n, r)
+te_expr *n;
+dd_real *r;
+  {
+  te_variable *v;
+  te_vec *k;
+  dd_real a, b;
+  int top, i;
+
+  if (n->type & (TE_FLAG_LOOP | TE_FLAG_RED)) longjmp (err_jump, E_NODD);
+  if (n->type & TE_FLAG_POLY)
+    {
+    /* Made before DD mode was turned on */
+    k = n->parameters[1];
+    dde (n->parameters[0], &a);
+    r->hi = k->v[k->n - 1];
+    r->lo = 0.0;
+    for (i = k->n - 2; i >= 0; i--)
+      {
+      dd_mul (r, &a, r);
+      b.hi = k->v[i];
+      b.lo = 0.0;
+      dd_add (r, &b, r);
+      }
+    return;
+    }
+
+  switch (TYPE_MASK(n->type))
+    {
+    case TE_CONSTANT:
+      if (n->type & TE_FLAG_VEC) longjmp (err_jump, E_VECTOR);
+      r->hi = n->dvalue;
+      r->lo = n->dlow;
+      return;
+    case TE_VARIABLE:
+      v = n->fvalue;
+      if (v && (v->type & TE_FLAG_VEC)) longjmp (err_jump, E_VECTOR);
+      r->hi = *n->bound;
+      r->lo = v ? v->lo : 0.0;
+      return;
+    case TE_FUNC1:
+      dde (n->parameters[0], &a);
+      ddop (n, &a, &a, r);
+      return;
+    case TE_FUNC2:
+      top = nspine;
+      dde (climb (n), &a);
+      for (i = nspine - 1; i >= top; i--)
+        {
+        dde (spine[i]->parameters[1], &b);
+        ddop (spine[i], &a, &b, &a);
+        }
+      nspine = top;
+      *r = a;
+      return;
+    }
+  longjmp (err_jump, E_NODD);
+  }
+
+/*
+    KB -- evaluate a compiled expression in double-double arithmetic,
+    as te_try() does
+*/
+int te_ddtry (n, vars, nvars, result)
+te_expr *n;
+te_variable *vars;
+int nvars;
+dd_real *result;
+  {
+  int rt_err = setjmp (err_jump);
+  if (rt_err != 0) 
+    {
+    nspine = 0;
+    return rt_err;
+    }
+  stale (n, vars, nvars);
+  dde (n, result);
+  return 0;
+  }
+
+/*
+    KB -- evaluating in big integers (BIG mode, see big.c). This follows
+    ie(), with a big_num in place of a te_int. A long constant has its 
+    digits in its node, and a variable set in BIG mode in its 
+    te_variable, which is used unless the double has been changed since;
+    anything else is a double, and truncated. The numbers made along the
+    way are freed all at once when the evaluation is over.
+*/
+static big_num *bop (n, a, b)
+te_expr *n;
+big_num *a;
+big_num *b;
+  {
+  void *f = n->fvalue;
+  big_fun k;
+  if (f == add) return big_add (a, b);
+  if (f == sub) return big_sub (a, b);
+  if (f == mul) return big_mul (a, b);
+  if (f == divide) return big_div (a, b);
+  if (f == fmod) return big_mod (a, b);
+  if (f == negate) return big_neg (a);
+  if (f == comma) return b;
+  if ((k = big_kern (f)) != 0) return k (a, b);
+  longjmp (err_jump, E_NOBIG);
+  return 0;
+  }
+
+static big_num *be (n)
+te_expr *n;
+  {
+  te_variable *v;
+  te_vec *k;
+  big_num *a, *x;
+  int top, i;
+
+  if (n->type & (TE_FLAG_LOOP | TE_FLAG_RED)) longjmp (err_jump, E_NOBIG);
+  if (n->type & TE_FLAG_POLY)
+    {
+    /* Made before BIG mode was turned on */
+    k = n->parameters[1];
+    x = be (n->parameters[0]);
+    a = big_fromd (k->v[k->n - 1]);
+    for (i = k->n - 2; i >= 0; i--)
+      a = big_add (big_mul (a, x), big_fromd (k->v[i]));
+    return a;
+    }
+
+  switch (TYPE_MASK(n->type))
+    {
+    case TE_CONSTANT:
+      if (n->type & TE_FLAG_VEC) longjmp (err_jump, E_VECTOR);
+      return n->big ? n->big : big_fromd (n->dvalue);
+    case TE_VARIABLE:
+      v = n->fvalue;
+      if (v && (v->type & TE_FLAG_VEC)) longjmp (err_jump, E_VECTOR);
+      if (v && v->big && big_dbl (v->big) == *n->bound) return v->big;
+      return big_fromd (*n->bound);
+    case TE_FUNC1:
+      a = be (n->parameters[0]);
+      return bop (n, a, a);
+    case TE_FUNC2:
+      top = nspine;
+      a = be (climb (n));
+      for (i = nspine - 1; i >= top; i--)
+        a = bop (spine[i], a, be (spine[i]->parameters[1]));
+      nspine = top;
+      return a;
+    }
+  longjmp (err_jump, E_NOBIG);
+  return 0;
+  }
+
+/*
+    KB -- evaluate a compiled expression in big integers, as te_try() 
+    does
+*/
+int te_btry (n, vars, nvars, result)
+te_expr *n;
+te_variable *vars;
+int nvars;
+big_num **result;
+  {
+  int rt_err = setjmp (err_jump);
+  if (rt_err != 0) 
+    {
+    nspine = 0;
+    big_release ();
+    return rt_err;
+    }
+  stale (n, vars, nvars);
+  /* The result may be a constant's or a variable's own */
+  *result = big_dup (be (n));
+  big_keep (*result);
+  big_release ();
+  return 0;
+  }
+#endif
+
+/*
+    KB -- vectors. A vector is a variable (whose te_variable is kept in 
+    its node, so that it can be a vector at one time and a number at 
+    another), a literal list [a, b, ...], or the result of a function 
+    like LINSPACE(). Its
+    elements are stored contiguously, and an expression that uses it
+    is evaluated a block of VEC_BLOCK elements at a time, each operator
+    or function being applied to the whole block in a tight loop. 
+    Reductions, like SUM(v), are computed before the rest of the 
+    expression, and then behave as numbers.
+*/
+
+te_vec *te_vnew (n)
+int n;
+  {
+  te_vec *v;
+  if (n < 1 || n > VEC_MAX) return 0;
+  if ((v = malloc (sizeof (te_vec))) == 0) return 0;
+  if ((v->v = malloc (n * sizeof (double))) == 0)
+    {
+    free (v);
+    return 0;
+    }
+  v->n = n;
+  return v;
+  }
+
+void te_vfree (v)
+te_vec *v;
+  {
+  if (!v) return;
+  free (v->v);
+  free (v);
+  }
+
+double te_ident (x)
+double x;
+  {
+  return x;
+  }
+
+/*
+    KB -- the vector that a node stands for, or 0 if it is not a vector
+*/
+static te_vec *vec_of (n)
+te_expr *n;
+  {
+  te_variable *var;
+  if (TYPE_MASK (n->type) == TE_CONSTANT)
+    return (n->type & TE_FLAG_VEC) ? n->fvalue : 0;
+  if (TYPE_MASK (n->type) == TE_VARIABLE && (var = n->fvalue) != 0
+       && (var->type & TE_FLAG_VEC))
+    return var->context;
+  return 0;
+  }
+
+/*
+    KB -- call a function that makes a vector, like LINSPACE(a, b, n), and
+    turn its node into a vector constant
+*/
+static te_expr *vgen (n)
+te_expr *n;
+  {
+  double a[3];
+  te_vec *v;
+  int i, arity = ARITY (n->type);
+  for (i = 0; i < 3; i++)
+    a[i] = i < arity ? te_eval (n->parameters[i]) : 0.0;
+  v = ((te_fung)n->fvalue) (a[0], a[1], a[2]);
+  te_fp (n);
+  n->type = TE_CONSTANT | TE_FLAG_VEC;
+  n->fvalue = v;
+  return n;
+  }
+
+/*
+    KB -- return non-zero if the expression uses a vector anywhere
+*/
+int te_isvec (n)
+te_expr *n;
+  {
+  int i, arity = 0;
+  for (; n; n = arity ? n->parameters[0] : 0)
+    {
+    if (vec_of (n)) return 1;
+    arity = ARITY (n->type);
+    for (i = 1; i < arity; i++)
+      if (te_isvec (n->parameters[i])) return 1;
+    }
+  return 0;
+  }
+
+/*
+    KB -- the length of the vectors in an expression, not counting those 
+    inside reductions, or 0 if there are none. All must be the same 
+    length.
+*/
+static int vlen (n)
+te_expr *n;
+  {
+  te_vec *v;
+  int i, l, arity = 0, len = 0;
+  for (; n; n = arity ? n->parameters[0] : 0)
+    {
+    if ((v = vec_of (n)) != 0) 
+      l = v->n;
+    else if (n->type & (TE_FLAG_RED | TE_FLAG_LOOP)) 
+      l = 0;
+    else
+      {
+      arity = ARITY (n->type);
+      for (i = 1; i < arity; i++)
+        {
+        if ((l = vlen (n->parameters[i])) != 0)
+          {
+          if (len && l != len) longjmp (err_jump, E_VLEN);
+          len = l;
+          }
+        }
+      continue;
+      }
+    if (len && l && l != len) longjmp (err_jump, E_VLEN);
+    return l ? l : len;
+    }
+  return len;
+  }
+
+/*
+    KB -- in masked evaluation, the error code of each element of the 
+    block being evaluated, or zero; otherwise 0
+*/
+static char *lanes = 0;
+static int nfail;
+
+#ifdef LINUX
+/*
+    KB -- the stack where evaluating a vector started. Each level of 
+    veval() has blocks of its own, so the depth of an expression doesn't
+    bound the stack it uses: that is checked as it goes.
+*/
+static char *vbase;
+#endif
+
+/*
+    KB -- element i of the block can't be calculated. In masked evaluation,
+    record why (unless an earlier error already has); otherwise jump out
+*/
+static void vfail (i, code)
+int i;
+int code;
+  {
+  if (!lanes) longjmp (err_jump, code);
+  if (!lanes[i]) lanes[i] = code;
+  nfail++;
+  }
+
+/*
+    KB -- in masked evaluation, apply a function that reports errors with
+    longjmp() to a block of elements. An element that fails is given NAN,
+    and the loop carries on from the next.
+*/
+static int lane;
+
+static void vapply (n, a, b, out, cnt)
+te_expr *n;
+double *a;
+double *b;
+double *out;
+int cnt;
+  {
+  jmp_buf save;
+  te_fun1 f1 = n->fvalue;
+  te_fun2 f2 = n->fvalue;
+  int code;
+  _memcpy (save, err_jump, sizeof (jmp_buf));
+  lane = 0;
+  code = setjmp (err_jump);
+  if (code)
+    {
+    vfail (lane, code);
+    out[lane++] = NAN;
+    }
+  if (ARITY (n->type) == 1)
+    for (; lane < cnt; lane++) out[lane] = f1 (a[lane]);
+  else
+    for (; lane < cnt; lane++) out[lane] = f2 (a[lane], b[lane]);
+  _memcpy (err_jump, save, sizeof (jmp_buf));
+  }
+
+/*
+    KB -- apply a binary operator or function to a block of elements
+*/
+static void vbin (n, a, b, out, cnt)
+te_expr *n;
+double *a;
+double *b;
+double *out;
+int cnt;
+  {
+  te_fun2 f2 = n->fvalue;
+  int i;
+  if (f2 == add)
+    for (i = 0; i < cnt; i++) out[i] = a[i] + b[i];
+  else if (f2 == sub)
+    for (i = 0; i < cnt; i++) out[i] = a[i] - b[i];
+  else if (f2 == mul)
+    for (i = 0; i < cnt; i++) out[i] = a[i] * b[i];
+  else if (f2 == divide)
+    {
+    for (i = 0; i < cnt; i++) 
+      {
+      if (b[i] != 0) 
+        out[i] = a[i] / b[i];
+      else
+        {
+        vfail (i, E_DIVZ);
+        out[i] = NAN;
+        }
+      }
+    }
+  else if (lanes)
+    vapply (n, a, b, out, cnt);
+  else
+    for (i = 0; i < cnt; i++) out[i] = f2 (a[i], b[i]);
+  }
+
+/*
+    KB -- evaluate a polynomial for a block of elements, x, by Horner's
+    rule, a coefficient at a time so that the inner loop is over the
+    elements
+*/
+static void vhorner (n, x, out, cnt)
+te_expr *n;
+double *x;
+double *out;
+int cnt;
+  {
+  te_vec *k = n->parameters[1];
+  double c;
+  int i, j = k->n - 1;
+  c = k->v[j];
+  for (i = 0; i < cnt; i++) out[i] = c;
+  while (--j >= 0)
+    {
+    c = k->v[j];
+    for (i = 0; i < cnt; i++) out[i] = out[i] * x[i] + c;
+    }
+  }
+
+/*
+    KB -- evaluate a block of elements of a long chain of operators, a
+    link at a time, as te_chain() does
+*/
+static double *vchain (n, base, cnt, out)
+te_expr *n;
+int base;
+int cnt;
+double *out;
+  {
+  double tmp[VEC_BLOCK];
+  double *a;
+  int top = nspine, i;
+  a = veval (climb (n), base, cnt, out);
+  if (a != out)
+    for (i = 0; i < cnt; i++) out[i] = a[i];
+  for (i = nspine - 1; i >= top; i--)
+    {
+    n = spine[i];
+    vbin (n, out, veval (n->parameters[1], base, cnt, tmp), out, cnt);
+    }
+  nspine = top;
+  return out;
+  }
+
+/*
+    KB -- evaluate elements base to base + cnt - 1 of an expression,
+    cnt being at most VEC_BLOCK. Returns a pointer to the results, which
+    are either in out, or in the vector itself if the expression is 
+    just a vector. A part of the expression that is a number is the
+    same for every element. The arithmetic operators have loops of their
+    own, which a compiler can unroll or vectorize, and functions with 
+    block versions are called once for the whole block; other functions
+    are called once per element. In masked evaluation, an element that 
+    can't be calculated becomes NAN, and the error is recorded in lanes.
+*/
+static double *veval (n, base, cnt, out)
+te_expr *n;
+int base;
+int cnt;
+double *out;
+  {
+  double tmp[VEC_BLOCK];
+  char err[VEC_BLOCK];
+  double *a, *b, x;
+  te_vec *v;
+  te_fun1 f1;
+  te_funb fb;
+  int i;
+
+#ifdef LINUX
+  if (vbase - (char *)&v > VEC_STACK) longjmp (err_jump, E_DEEP);
+#endif
+  if ((v = vec_of (n)) != 0) return v->v + base;
+  if (n->type & TE_FLAG_RED) 
+    x = n->dvalue;
+  else if ((n->type & TE_FLAG_LOOP) || ARITY (n->type) == 0) 
+    x = te_eval (n);
+  else if (n->type & TE_FLAG_POLY)
+    {
+    vhorner (n, veval (n->parameters[0], base, cnt, tmp), out, cnt);
+    return out;
+    }
+  else if (ARITY (n->type) == 1)
+    {
+    a = veval (n->parameters[0], base, cnt, out);
+    f1 = n->fvalue;
+    if (f1 == negate)
+      for (i = 0; i < cnt; i++) out[i] = -a[i];
+    else if (n->type & TE_FLAG_BLK)
+      {
+      fb = n->parameters[1];
+      if (fb (a, out, cnt, err))
+        for (i = 0; i < cnt; i++)
+          if (err[i]) 
+            {
+            vfail (i, err[i]);
+            out[i] = NAN;
+            }
+      }
+    else if (lanes)
+      vapply (n, a, 0, out, cnt);
+    else
+      for (i = 0; i < cnt; i++) out[i] = f1 (a[i]);
+    return out;
+    }
+  else if (n->type & TE_FLAG_DEEP)
+    return vchain (n, base, cnt, out);
+  else
+    {
+    a = veval (n->parameters[0], base, cnt, out);
+    b = veval (n->parameters[1], base, cnt, tmp);
+    vbin (n, a, b, out, cnt);
+    return out;
+    }
+
+  for (i = 0; i < cnt; i++) out[i] = x;
+  return out;
+  }
+
+/*
+    KB -- compute a reduction, leaving the result in the node. Each
+    element (or pair of elements, for a two-argument reduction like 
+    DOT(u, v)) has the node's function applied, and the results are 
+    combined, left to right, by the function in the node's context. 
+*/
+static void vreduce (n)
+te_expr *n;
+  {
+  double buf[VEC_BLOCK], tmp[VEC_BLOCK];
+  double *a, *b, acc = 0.0;
+  int arity = ARITY (n->type);
+  te_fun2 fold = n->parameters[arity];
+  te_fun1 f1 = n->fvalue;
+  te_fun2 f2 = n->fvalue;
+  int len = 0, base, cnt, i, l;
+
+  for (i = 0; i < arity; i++)
+    {
+    if ((l = vlen (n->parameters[i])) != 0)
+      {
+      if (len && l != len) longjmp (err_jump, E_VLEN);
+      len = l;
+      }
+    }
+  if (len == 0) len = 1;
+  for (base = 0; base < len; base += VEC_BLOCK)
+    {
+    cnt = len - base < VEC_BLOCK ? len - base : VEC_BLOCK;
+    a = veval (n->parameters[0], base, cnt, buf);
+    if (arity > 1)
+      {
+      b = veval (n->parameters[1], base, cnt, tmp);
+      for (i = 0; i < cnt; i++) buf[i] = f2 (a[i], b[i]);
+      a = buf;
+      }
+    else if (f1 != te_ident)
+      {
+      for (i = 0; i < cnt; i++) buf[i] = f1 (a[i]);
+      a = buf;
+      }
+    i = 0;
+    if (base == 0) acc = a[i++];
+    for (; i < cnt; i++) acc = fold (acc, a[i]);
+    }
+  n->dvalue = acc;
+  }
+
+/*
+    KB -- compute every reduction in an expression, innermost first
+*/
+static void vprep (n)
+te_expr *n;
+  {
+  int top, i;
+  if (n->type & TE_FLAG_LOOP) return;
+  if (n->type & TE_FLAG_DEEP)
+    {
+    top = nspine;
+    vprep (climb (n));
+    for (i = nspine - 1; i >= top; i--) 
+      vprep (spine[i]->parameters[1]);
+    nspine = top;
+    return;
+    }
+  for (i = 0; i < ARITY (n->type); i++) 
+    vprep (n->parameters[i]);
+  if (n->type & TE_FLAG_RED) vreduce (n);
+  }
+
+/*
+    KB -- evaluate an expression that uses vectors, but only in reductions,
+    so that its value is a number: a definition like x := SUM(v)
+*/
+static double vscalar (n)
+te_expr *n;
+  {
+  double buf[1];
+#ifdef LINUX
+  vbase = (char *)buf;
+#endif
+  vprep (n);
+  if (vlen (n)) longjmp (err_jump, E_VECTOR);
+  return *veval (n, 0, 1, buf);
+  }
+
+/*
+    KB -- evaluate an expression that uses vectors. Errors are returned as
+    for te_try(), which has the same restriction on nesting. If errs is
+    not 0, the evaluation is masked: errors in single elements are 
+    collected in *errs rather than returned.
+*/
+int te_vtry (n, vars, nvars, result, vec, errs)
+te_expr *n;
+te_variable *vars;
+int nvars;
+double *result;
+te_vec **vec;
+char **errs;
+  {
+  double buf[VEC_BLOCK];
+  char mask[VEC_BLOCK];
+  double *a, *out;
+  int len, base, cnt, i;
+  int rt_err;
+
+  *vec = 0;
+  if (errs) *errs = 0;
+  lanes = 0;
+  rt_err = setjmp (err_jump);
+  if (rt_err != 0)
+    {
+    lanes = 0;
+    nspine = 0;
+    te_vfree (*vec);
+    *vec = 0;
+    if (errs && *errs)
+      {
+      free (*errs);
+      *errs = 0;
+      }
+    return rt_err;
+    }
+  stale (n, vars, nvars);
+#ifdef LINUX
+  vbase = (char *)buf;
+#endif
+  vprep (n);
+  len = vlen (n);
+  if (len == 0)
+    {
+    *result = *veval (n, 0, 1, buf);
+    return 0;
+    }
+  if ((*vec = te_vnew (len)) == 0) return E_NOMEM;
+  for (base = 0; base < len; base += VEC_BLOCK)
+    {
+    cnt = len - base < VEC_BLOCK ? len - base : VEC_BLOCK;
+    out = (*vec)->v + base;
+    if (errs)
+      {
+      _memset (mask, 0, cnt);
+      lanes = mask;
+      nfail = 0;
+      }
+    a = veval (n, base, cnt, out);
+    lanes = 0;
+    if (a != out)
+      for (i = 0; i < cnt; i++) out[i] = a[i];
+    if (errs && nfail)
+      for (i = 0; i < cnt; i++)
+        {
+        if (!mask[i]) continue;
+        if (!*errs)
+          {
+          if ((*errs = malloc (len)) == 0) longjmp (err_jump, E_NOMEM);
+          _memset (*errs, 0, len);
+          }
+        (*errs)[base + i] = mask[i];
+        }
+    }
+  return 0;
+  }
@@ -29,6 +29,39 @@
 #define E_NOEXPR  8
 /* No expression found where one expected */
 #define E_MSYMS   9
+/* Definition refers to itself, directly or indirectly */
+#define E_CYCLE   10
+/* Range (from, to, step) that can't be stepped through */
+#define E_RANGE   11
+/* Iterative method (e.g., SOLVE) did not converge */
+#define E_NOCONV  12
+/* Vectors of different lengths in the same expression */
+#define E_VLEN    13
+/* Vector used where only a number will do */
+#define E_VECTOR  14
+/* Not enough memory (e.g., for a vector) */
+#define E_NOMEM   15
+/* Expression nested more deeply than EXPR_DEPTH */
+#define E_DEEP    16
+/* Expression that has no equivalent in C (e.g., one using SUM) */
+#define E_NOCODE  17
+/* Expression that can't be evaluated in DD mode (e.g., one using SUM) */
+#define E_NODD    18
+/* Expression that can't be evaluated in INT mode (e.g., one using SIN) */
+#define E_NOINT   19
+/* Argument that must be a whole number (e.g., to FAC) isn't one */
+#define E_WHOLE   20
+/* Expression that can't be evaluated in BIG mode (e.g., one using SIN) */
+#define E_NOBIG   21
+/* Expression that can't be evaluated in FIXED mode (e.g., one using SUM) */
+#define E_NOFIX   22
+/* Result too big for a fixed-point number, in FIXED mode */
+#define E_FIXBIG  23
+/* Formula in the expression of a function like SUM uses a variable with
+   the same name as the function's own */
+#define E_LOOPDEF 24
+/* Negative number raised to a power that isn't a whole number */
+#define E_NEGPOW  25
 
 /* TinyExpr variable/token types. */
 #define TE_VARIABLE 0
@@ -50,9 +83,55 @@
 #define TE_CLO6 22
 #define TE_CLO7 23
 #define TE_FLAG_PURE 32
+/* KB -- variable is defined by a formula (x := ...), held in its context */
+#define TE_FLAG_DEFN 64
+/* KB -- defined variable whose inputs have changed since it was computed */
+#define TE_FLAG_DIRTY 128
+/* KB -- function is expensive enough to be worth caching (see memo.c) */
+#define TE_FLAG_MEMO 256
+/* KB -- function takes an expression and a variable to vary (see funcs.c) */
+#define TE_FLAG_LOOP 512
+/* KB -- variable holds a vector, a te_vec in its context (also marks
+   vector constants in a compiled expression) */
+#define TE_FLAG_VEC 1024
+/* KB -- function reduces vectors to a number: it is applied to each 
+   element, and the results combined by the two-argument function in 
+   its context (see te_vtry()) */
+#define TE_FLAG_RED 2048
+/* KB -- function returns a new te_vec, made from its arguments when the
+   expression is compiled */
+#define TE_FLAG_GEN 4096
+/* KB -- one-argument function has a version in its context that works
+   on a block of arguments at once (see vmath.h), for evaluating vectors */
+#define TE_FLAG_BLK 8192
+/* KB -- node is the top of a long chain of operators, like a+b+c+..., 
+   that is evaluated a link at a time rather than by recursion */
+#define TE_FLAG_DEEP 16384
+/* KB -- node is a polynomial in the variable that is its argument, its
+   coefficients in a te_vec after the argument (this is the top bit of
+   a 16-bit int) */
+#define TE_FLAG_POLY 0x8000
 
 #define TYPE_MASK(TYPE) ((TYPE)&0x0000001F)
 
+/* KB -- the integers of INT mode: 64 bits where the compiler has them,
+   and the 32 of a long on CP/M. Arithmetic wraps around, as it does in 
+   a register. */
+#ifdef LINUX
+typedef long long te_int;
+typedef unsigned long long te_uint;
+#define TE_IBITS 64
+#define TE_IMAX 0x7fffffffffffffffLL
+#define TE_IFMT "%lld"
+#else
+typedef long te_int;
+typedef unsigned long te_uint;
+#define TE_IBITS 32
+#define TE_IMAX 0x7fffffffL
+#define TE_IFMT "%ld"
+#endif
+#define TE_IMIN (-TE_IMAX - 1)
+
 typedef struct te_variable 
   {
   char *name;
@@ -60,6 +139,16 @@ typedef struct te_variable
   int type;
   void *context;
   double num; /* KB -- added to support variables created at runtime */
+#ifdef LINUX
+  double lo; /* KB -- the low part of the value, in DD mode (see dd.h) */
+  struct big_num *big; /* KB -- the value in full, if it was set in BIG
+                          mode and hasn't changed since (see big.h) */
+#endif
+  te_int ival; /* KB -- the value as an integer, in INT mode */
+  te_int rden; /* KB -- and ival over this, as a fraction in FRAC mode; 
+                  0 if it isn't one. If it is negative, ival is instead
+                  a fixed-point number with -rden fraction bits, in
+                  FIXED mode (see fix.h) */
   } te_variable;
 
 typedef int AngleMode;
@@ -74,8 +163,140 @@ extern BaseMode base_mode;
 #define BM_DEC  0
 #define BM_HEX  1
 #define BM_FRAC 2 
+#define BM_BIN  3
+#define BM_OCT  4
+
+/* Non-zero if expressions are evaluated in integers (INT mode) */
+extern int int_mode;
+
+typedef struct te_expr te_expr;
+
+/* KB -- a vector value: n numbers, stored contiguously */
+typedef struct te_vec
+  {
+  int n;
+  double *v;
+  } te_vec;
 
 double te_interp ();
+te_expr *te_compile ();
+
+/* Compile an expression, with errors reported as for te_interp().
+   args: char *expression, int *error_pos, int *rt_error, te_variable *vars,
+   int nvars. ret: the compiled expression, or 0 on error */
+te_expr *te_build ();
+
+/* Evaluate a compiled expression without jumping out on error, 
+   recomputing any out-of-date definitions it uses first. args: te_expr *n,
+   te_variable *vars, int nvars, double *result. ret: zero or error code */
+int te_try ();
+
+double te_eval ();
+void te_free ();
+
+/* Attach a formula to a variable. args: char *expression, int *error_pos,
+   int *rt_error, te_variable *var, te_variable *vars, int nvars */
+void te_define ();
+
+/* Find whether a compiled expression depends on a variable, directly or
+   through the definitions of other variables. args: te_variable *vars, 
+   int nvars, te_expr *n, te_variable *var. ret: non-zero if it does */
+int te_deps ();
+
+/* Find whether a compiled expression calls a function that gives random
+   numbers. args: te_expr *n. ret: non-zero if it does */
+int te_random ();
+
+/* Mark everything defined in terms of a variable as needing 
+   recomputation. args: te_variable *vars, int nvars, te_variable *var */
+void te_touch ();
+
+/* Allocate a vector of n elements. args: int n. ret: the vector, or 0 if 
+   there is not enough memory */
+te_vec *te_vnew ();
+
+/* Free a vector. args: te_vec *v */
+void te_vfree ();
+
+/* The identity function, used for reductions like MIN(v) that combine 
+   the elements themselves. args: double x */
+double te_ident ();
+
+/* Find whether an expression uses any vectors. args: te_expr *n. 
+   ret: non-zero if it does */
+int te_isvec ();
+
+/* Evaluate an expression that uses vectors, as te_try() does. If the 
+   result is a vector, *vec is set to a new vector that the caller must
+   free; otherwise *vec is 0, and the result is in *result. If errs is 
+   not 0, an element of a vector result that can't be calculated is NAN,
+   and doesn't stop the evaluation; *errs is then set to an array, which
+   the caller must free, of each element's error code (or zero), or to 0 
+   if there were no such errors. args: te_expr *n, te_variable *vars, 
+   int nvars, double *result, te_vec **vec, char **errs. 
+   ret: zero or error code */
+int te_vtry ();
+
+#ifdef LINUX
+/* Evaluate a compiled expression in double-double arithmetic, as te_try()
+   does. args: te_expr *n, te_variable *vars, int nvars, dd_real *result.
+   ret: zero or error code */
+int te_ddtry ();
+
+/* Evaluate a compiled expression in big integers, as te_try() does. The
+   result is a new number, that the caller must free with big_free().
+   args: te_expr *n, te_variable *vars, int nvars, big_num **result.
+   ret: zero or error code */
+int te_btry ();
+#endif
+
+/* Evaluate a compiled expression in integer arithmetic, as te_try() 
+   does. args: te_expr *n, te_variable *vars, int nvars, te_int *result.
+   ret: zero or error code */
+int te_itry ();
+
+/* Evaluate a compiled expression in fractions, as te_try() does. 
+   args: te_expr *n, te_variable *vars, int nvars, rat_num *result.
+   ret: zero or error code */
+int te_rtry ();
+
+/* Evaluate a compiled expression in fixed point, as te_try() does. The
+   result has fix_bits fraction bits (see fix.h). args: te_expr *n, 
+   te_variable *vars, int nvars, te_int *result. ret: zero or error code */
+int te_ftry ();
+
+/* Non-zero if an expression is made only of arithmetic and functions,
+   like SIN, whose results change only a little when their arguments do
+   (see smooth1() in tinyexpr.c), and if nothing that has been worked
+   out since it was built by te_build(), with fn_prec set, has lost too 
+   many digits to cancellation. args: te_expr *n */
+int te_smooth ();
+
+/* A number as an integer: truncated towards zero, and limited to the 
+   range of te_int. args: double x */
+te_int te_toint ();
+
+/* Write a compiled expression as a C expression, to standard output, for
+   the body of a C function whose parameters are the variables in params
+   (see kcode.h). If out is zero, the expression is only checked. 
+   args: te_expr *n, te_variable *vars, int nvars, te_variable *params, 
+   int nparams, int out. ret: zero or error code */
+int te_code ();
+
+/* Division and remainder, with the check for zero that the / and % 
+   operators make, for C written by te_code(). args: double a, double b */
+double te_div ();
+double te_mod ();
+
+/* The bitwise operators &, |, XOR, << and >>, on numbers that are not 
+   integers: each argument is converted by te_toint(). A negative shift 
+   is a shift the other way, and >> copies the sign bit. 
+   args: double a, double b */
+double te_and ();
+double te_or ();
+double te_xor ();
+double te_shl ();
+double te_shr ();
 
 #endif
 
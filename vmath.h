@@ -0,0 +1,32 @@
+/*===========================================================================
+
+  vmath.h
+
+  Block versions of the math functions, for evaluating expressions over
+  vectors (see TE_FLAG_BLK).
+
+  Kevin Boone, May 2021, GPL v3.0
+
+===========================================================================*/
+#ifndef __VMATH_H
+#define __VMATH_H
+
+#ifdef LINUX
+/* Non-zero to use polynomials rather than the C library in _bsin and
+   _bcos (see vmath.c for their accuracy), and in the scalar functions
+   at low SIGFIG (see fn_prec in funcs.h) */
+extern int fast_math;
+#endif
+
+/* Each function is applied to n values in x, and the results put in y,
+   which may be the same array. Domain errors set the lane's entry in err
+   to the error code. args: double *x, double *y, int n, char *err.
+   ret: the number of lanes in error; err is only set if this is
+   non-zero */
+int _bcos ();
+int _bexp ();
+int _blog ();
+int _bsin ();
+int _bsqrt ();
+
+#endif